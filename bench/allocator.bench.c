@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "allocator.h"
+#include "logger.h"
+
+#ifndef ALLOCATOR_THREAD_SAFE
+#error "allocator.bench.c measures the thread safe allocator, build it with -DALLOCATOR_THREAD_SAFE"
+#endif // !ALLOCATOR_THREAD_SAFE
+
+/// Multi-threaded alloc/free throughput of a_allocate/a_free against malloc/free.
+/// Each thread keeps a window of live blocks and replaces a random one per
+///   operation, a quarter of blocks are handed over to the next thread and
+///   freed there. Sizes are small (cached), large (shared Vsa under
+///   g_vsa_lock) or mixed.
+
+LogSeverity g_log_severity = LOG_WARNING;
+
+#define OPS_PER_THREAD 1000000
+#define WINDOW_SIZE 256
+#define HANDOFF_SIZE 1024
+#define RUNS_COUNT 3
+#define MAX_THREADS 64
+
+typedef enum { SIZES_SMALL, SIZES_LARGE, SIZES_MIXED } SizesKind;
+
+typedef struct {
+  pthread_mutex_t lock;
+  void *blocks[HANDOFF_SIZE];
+  size_t count;
+} Handoff;
+
+typedef struct {
+  size_t index;
+  size_t threads_count;
+  SizesKind sizes;
+  bool is_malloc;
+  Handoff *handoffs;
+} BenchCtx;
+
+static double now_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static size_t next_random(size_t *p_state) {
+  *p_state ^= *p_state << 13;
+  *p_state ^= *p_state >> 7;
+  *p_state ^= *p_state << 17;
+  return *p_state;
+}
+
+static size_t next_size(size_t *p_state, SizesKind sizes) {
+  size_t r = next_random(p_state);
+  switch (sizes) {
+  case SIZES_SMALL: return 8 + r % 249;
+  case SIZES_LARGE: return 257 + r % 4096;
+  default: return 0 == r % 8 ? 257 + r % 4096 : 8 + r % 249;
+  }
+}
+
+static void *bench_thread(void *arg) {
+  BenchCtx *p_ctx = arg;
+  Handoff *p_own = &p_ctx->handoffs[p_ctx->index];
+  Handoff *p_next = &p_ctx->handoffs[(p_ctx->index + 1) % p_ctx->threads_count];
+  size_t state = 0x9E3779B97F4A7C15ull * (p_ctx->index + 1);
+  void *window[WINDOW_SIZE] = { 0 };
+
+  for (size_t op = 0; op < OPS_PER_THREAD; ++op) {
+    size_t i = next_random(&state) % WINDOW_SIZE;
+    void *block = window[i];
+    if (NULL != block) {
+      if (0 == op % 4 && p_ctx->threads_count > 1) {
+        pthread_mutex_lock(&p_next->lock);
+        if (p_next->count < HANDOFF_SIZE) {
+          p_next->blocks[p_next->count++] = block;
+          block = NULL;
+        }
+        pthread_mutex_unlock(&p_next->lock);
+      }
+      if (NULL != block) p_ctx->is_malloc ? free(block) : a_free(block);
+    }
+    size_t size = next_size(&state, p_ctx->sizes);
+    window[i] = p_ctx->is_malloc ? malloc(size) : a_allocate(size);
+    if (NULL == window[i]) logf_fatal("BENCH", 137, "allocation of %lu bytes failed!", size);
+    *(char*)window[i] = (char)op;
+
+    if (0 == op % 64) {
+      pthread_mutex_lock(&p_own->lock);
+      for (size_t j = 0; j < p_own->count; ++j) {
+        p_ctx->is_malloc ? free(p_own->blocks[j]) : a_free(p_own->blocks[j]);
+      }
+      p_own->count = 0;
+      pthread_mutex_unlock(&p_own->lock);
+    }
+  }
+
+  for (size_t i = 0; i < WINDOW_SIZE; ++i) {
+    if (NULL != window[i]) p_ctx->is_malloc ? free(window[i]) : a_free(window[i]);
+  }
+  return NULL;
+}
+
+/// @return double, nanoseconds per alloc/free pair on one thread, best of RUNS_COUNT
+static double bench(size_t threads_count, SizesKind sizes, bool is_malloc) {
+  static Handoff handoffs[MAX_THREADS];
+  BenchCtx ctxs[MAX_THREADS];
+  pthread_t threads[MAX_THREADS];
+  double best = 0;
+
+  for (size_t run = 0; run < RUNS_COUNT; ++run) {
+    for (size_t i = 0; i < threads_count; ++i) {
+      pthread_mutex_init(&handoffs[i].lock, NULL);
+      handoffs[i].count = 0;
+      ctxs[i] = (BenchCtx){ i, threads_count, sizes, is_malloc, handoffs };
+    }
+    double start = now_seconds();
+    for (size_t i = 0; i < threads_count; ++i) {
+      pthread_create(&threads[i], NULL, bench_thread, &ctxs[i]);
+    }
+    for (size_t i = 0; i < threads_count; ++i) pthread_join(threads[i], NULL);
+    double elapsed = now_seconds() - start;
+
+    for (size_t i = 0; i < threads_count; ++i) {
+      for (size_t j = 0; j < handoffs[i].count; ++j) {
+        is_malloc ? free(handoffs[i].blocks[j]) : a_free(handoffs[i].blocks[j]);
+      }
+      pthread_mutex_destroy(&handoffs[i].lock);
+    }
+    double ns = elapsed * 1e9 / OPS_PER_THREAD;
+    if (0 == run || ns < best) best = ns;
+  }
+  return best;
+}
+
+int main(int argc, char **argv) {
+  size_t max_threads = argc > 1 ? strtoul(argv[1], NULL, 10) : 8;
+  if (0 == max_threads || max_threads > MAX_THREADS) max_threads = 8;
+
+  if (!allocator_init(1024lu * 1024lu * 1024lu)) abort();
+  atexit(allocator_finalize);
+
+  static const char *sizes_names[] = { "small", "large", "mixed" };
+  printf("wall ns per alloc/free pair, %d pairs on each thread, flat rows scale linearly\n",
+         OPS_PER_THREAD);
+  printf("%-8s %8s %12s %12s\n", "sizes", "threads", "a_allocate", "malloc");
+  for (SizesKind sizes = SIZES_SMALL; sizes <= SIZES_MIXED; ++sizes) {
+    for (size_t threads_count = 1; threads_count <= max_threads; threads_count *= 2) {
+      double allocator_ns = bench(threads_count, sizes, false);
+      double malloc_ns = bench(threads_count, sizes, true);
+      printf("%-8s %8lu %12.1f %12.1f\n", sizes_names[sizes], threads_count,
+             allocator_ns, malloc_ns);
+    }
+  }
+
+  return 0;
+}
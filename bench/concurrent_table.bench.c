@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "concurrent_table.h"
+#include "allocator.h"
+#include "logger.h"
+
+/// Lookups of ConcurrentTable against Table on one thread, then lookup
+///   throughput of 1..N reader threads while one writer inserts and deletes
+///   new keys, so arrays are replaced and deleted pairs are reclaimed
+///   all the time. Bytes in use at the end show whether reclamation keeps up.
+
+LogSeverity g_log_severity = LOG_WARNING;
+
+#define KEYS_COUNT 50000
+#define LOOKUP_ROUNDS 20
+#define CHURN_WINDOW 1000
+#define RUN_SECONDS 0.5
+#define MAX_THREADS 64
+
+static char g_keys[KEYS_COUNT][24];
+static ConcurrentTable g_table;
+static bool g_is_running;
+
+static bool key_cmp_cstr(const void *lhs, const void *rhs) {
+  return 0 == strcmp(lhs, rhs);
+}
+
+static void free_key(const void *key, void *value) {
+  (void)value;
+  a_free((void*)key);
+}
+
+static double now_seconds() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static void *reader_run(void *arg) {
+  size_t *p_ops_count = arg;
+  size_t index = (size_t)p_ops_count * 7919 % KEYS_COUNT;
+  size_t ops_count = 0;
+  while (__atomic_load_n(&g_is_running, __ATOMIC_RELAXED)) {
+    for (size_t i = 0; i < 1024; ++i) {
+      void *value = NULL;
+      if (!concurrent_table_get(&g_table, g_keys[index], &value)) abort();
+      index = index + 1 < KEYS_COUNT ? index + 1 : 0;
+    }
+    ops_count += 1024;
+  }
+  *p_ops_count = ops_count;
+  return NULL;
+}
+
+static void *writer_run(void *arg) {
+  size_t *p_ops_count = arg;
+  size_t inserted_count = 0;
+  char key[32];
+  while (__atomic_load_n(&g_is_running, __ATOMIC_RELAXED)) {
+    char *new_key = a_allocate(32);
+    snprintf(new_key, 32, "churn:%zu", inserted_count);
+    concurrent_table_set(&g_table, new_key, (void*)16);
+    if (++inserted_count > CHURN_WINDOW) {
+      snprintf(key, sizeof(key), "churn:%zu", inserted_count - CHURN_WINDOW - 1);
+      concurrent_table_delete(&g_table, key);
+    }
+  }
+  *p_ops_count = inserted_count;
+  return NULL;
+}
+
+static void bench_single_thread() {
+  Table table;
+  table_init(&table, hash_cstr_default, key_cmp_cstr, NULL);
+  ConcurrentTable concurrent;
+  concurrent_table_init(&concurrent, hash_cstr_default, key_cmp_cstr, NULL);
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    table_set(&table, g_keys[i], (void*)16);
+    concurrent_table_set(&concurrent, g_keys[i], (void*)16);
+  }
+
+  void *value = NULL;
+  size_t found_count = 0;
+  double start = now_seconds();
+  for (size_t round = 0; round < LOOKUP_ROUNDS; ++round) {
+    for (size_t i = 0; i < KEYS_COUNT; ++i) found_count += table_get(&table, g_keys[i], &value);
+  }
+  double table_ns = (now_seconds() - start) * 1e9 / (LOOKUP_ROUNDS * KEYS_COUNT);
+
+  start = now_seconds();
+  for (size_t round = 0; round < LOOKUP_ROUNDS; ++round) {
+    for (size_t i = 0; i < KEYS_COUNT; ++i) {
+      found_count += concurrent_table_get(&concurrent, g_keys[i], &value);
+    }
+  }
+  double concurrent_ns = (now_seconds() - start) * 1e9 / (LOOKUP_ROUNDS * KEYS_COUNT);
+  if (2 * LOOKUP_ROUNDS * KEYS_COUNT != found_count) abort();
+
+  printf("one thread get: table %.1f ns, concurrent_table %.1f ns\n", table_ns, concurrent_ns);
+  table_free(&table);
+  concurrent_table_free(&concurrent);
+}
+
+static void bench_readers(size_t readers_count) {
+  concurrent_table_init(&g_table, hash_cstr_default, key_cmp_cstr, free_key);
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    char *key = a_allocate(sizeof(g_keys[i]));
+    memcpy(key, g_keys[i], sizeof(g_keys[i]));
+    concurrent_table_set(&g_table, key, (void*)16);
+  }
+  AllocatorStats before, after;
+  allocator_get_stats(&before);
+
+  static size_t ops_counts[MAX_THREADS + 1];
+  pthread_t threads[MAX_THREADS + 1];
+  __atomic_store_n(&g_is_running, true, __ATOMIC_RELAXED);
+  double start = now_seconds();
+  pthread_create(&threads[0], NULL, writer_run, &ops_counts[0]);
+  for (size_t i = 1; i <= readers_count; ++i) {
+    pthread_create(&threads[i], NULL, reader_run, &ops_counts[i]);
+  }
+  while (now_seconds() - start < RUN_SECONDS) {
+    struct timespec pause = { 0, 10 * 1000 * 1000 };
+    nanosleep(&pause, NULL);
+  }
+  __atomic_store_n(&g_is_running, false, __ATOMIC_RELAXED);
+  for (size_t i = 0; i <= readers_count; ++i) pthread_join(threads[i], NULL);
+  double elapsed = now_seconds() - start;
+  allocator_get_stats(&after);
+
+  size_t reads_count = 0;
+  for (size_t i = 1; i <= readers_count; ++i) reads_count += ops_counts[i];
+  printf("%8lu %14.1f %14.1f %12lu %16ld\n", readers_count,
+         reads_count / elapsed / 1e6, ops_counts[0] / elapsed / 1e6, ops_counts[0],
+         (long)after.bytes_in_use - (long)before.bytes_in_use);
+  concurrent_table_free(&g_table);
+}
+
+int main(int argc, char **argv) {
+  size_t max_threads = argc > 1 ? strtoul(argv[1], NULL, 10) : 8;
+  if (0 == max_threads || max_threads > MAX_THREADS) max_threads = 8;
+
+  if (!allocator_init(256lu * 1024lu * 1024lu)) abort();
+  atexit(allocator_finalize);
+  for (size_t i = 0; i < KEYS_COUNT; ++i) snprintf(g_keys[i], sizeof(g_keys[i]), "route:%zu", i * 31);
+
+  bench_single_thread();
+
+  printf("one writer inserting and deleting keys, %d keys live\n", CHURN_WINDOW);
+  printf("%8s %14s %14s %12s %16s\n", "readers", "M gets/s", "M writes/s", "inserted",
+         "bytes in use +");
+  for (size_t readers_count = 1; readers_count <= max_threads; readers_count *= 2) {
+    bench_readers(readers_count);
+  }
+
+  return 0;
+}
@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "table.h"
+#include "allocator.h"
+#include "logger.h"
+
+/// Time per key of the string hashes for keys of several lengths:
+///   FNV-1a the table used before, hash_cstr_seeded in one pass
+///   and hash_bytes_seeded after strlen, as hash_cstr_default does.
+
+LogSeverity g_log_severity = LOG_WARNING;
+
+#define KEYS_COUNT 64
+#define MAX_KEY_LENGTH 1024
+#define BYTES_PER_RUN (200lu * 1000lu * 1000lu)
+
+static char g_keys[KEYS_COUNT][MAX_KEY_LENGTH + 1];
+
+static size_t hash_fnv1a(const char *str, size_t len) {
+  size_t hash = 2166136261lu;
+  for (size_t i = 0; i < len; ++i) {
+    hash ^= (uint8_t)str[i];
+    hash *= 16777619;
+  }
+  return hash;
+}
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+int main() {
+  if (!allocator_init(4lu * 1024lu * 1024lu)) abort();
+  atexit(allocator_finalize);
+
+  for (size_t k = 0; k < KEYS_COUNT; ++k) {
+    for (size_t i = 0; i < MAX_KEY_LENGTH; ++i) g_keys[k][i] = (char)('a' + (i * 7 + k) % 26);
+  }
+
+  static const size_t lengths[] = { 4, 8, 16, 32, 64, 128, 1024 };
+  volatile size_t sink = 0;
+  printf("ns per key\n%8s %14s %14s %14s\n", "length", "fnv1a+strlen", "cstr", "strlen+bytes");
+  for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); ++l) {
+    size_t len = lengths[l];
+    for (size_t k = 0; k < KEYS_COUNT; ++k) g_keys[k][len] = '\0';
+    size_t iterations = BYTES_PER_RUN / (len + 16);
+
+    double start = now_ns();
+    for (size_t i = 0; i < iterations; ++i) {
+      const char *key = g_keys[i % KEYS_COUNT];
+      sink += hash_fnv1a(key, strlen(key));
+    }
+    double fnv_ns = (now_ns() - start) / iterations;
+
+    start = now_ns();
+    for (size_t i = 0; i < iterations; ++i) sink += hash_cstr_seeded(g_keys[i % KEYS_COUNT], 1);
+    double cstr_ns = (now_ns() - start) / iterations;
+
+    start = now_ns();
+    for (size_t i = 0; i < iterations; ++i) {
+      const char *key = g_keys[i % KEYS_COUNT];
+      sink += hash_bytes_seeded(key, strlen(key), 1);
+    }
+    double bytes_ns = (now_ns() - start) / iterations;
+
+    printf("%8lu %14.2f %14.2f %14.2f\n", len, fnv_ns, cstr_ns, bytes_ns);
+    for (size_t k = 0; k < KEYS_COUNT; ++k) g_keys[k][len] = 'x';
+  }
+
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "pool.h"
+#include "allocator.h"
+#include "logger.h"
+
+/// Churn of LIVE_COUNT live objects of OBJECT_SIZE bytes: a random object
+///   is freed and a new one allocated in its place, through pool_alloc
+///   and pool_free against a_allocate and a_free of the global Vsa.
+
+LogSeverity g_log_severity = LOG_WARNING;
+
+#define LIVE_COUNT 100000
+#define OBJECT_SIZE 48
+#define SLOTS_PER_CHUNK 1024
+#define CHURN_COUNT 10000000
+#define RUNS_COUNT 5
+
+static void *g_objects[LIVE_COUNT];
+static unsigned g_indices[CHURN_COUNT];
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static double churn_pool(Pool *p_pool) {
+  double start = now_ns();
+  for (size_t i = 0; i < CHURN_COUNT; ++i) {
+    unsigned index = g_indices[i];
+    pool_free(p_pool, g_objects[index]);
+    g_objects[index] = pool_alloc(p_pool);
+    memset(g_objects[index], (int)i, sizeof(size_t));
+  }
+  return (now_ns() - start) / CHURN_COUNT;
+}
+
+static double churn_vsa() {
+  double start = now_ns();
+  for (size_t i = 0; i < CHURN_COUNT; ++i) {
+    unsigned index = g_indices[i];
+    a_free(g_objects[index]);
+    g_objects[index] = a_allocate(OBJECT_SIZE);
+    memset(g_objects[index], (int)i, sizeof(size_t));
+  }
+  return (now_ns() - start) / CHURN_COUNT;
+}
+
+int main() {
+  if (!allocator_init(64lu * 1024lu * 1024lu)) abort();
+  atexit(allocator_finalize);
+
+  // indices are drawn up front, so the timed loops do not pay for them
+  size_t random_state = 1;
+  for (size_t i = 0; i < CHURN_COUNT; ++i) {
+    random_state = random_state * 6364136223846793005ull + 1442695040888963407ull;
+    g_indices[i] = (unsigned)((random_state >> 17) % LIVE_COUNT);
+  }
+
+  double pool_ns = 1e18, vsa_ns = 1e18;
+  for (size_t run = 0; run < RUNS_COUNT; ++run) {
+    Pool pool;
+    pool_init(&pool, OBJECT_SIZE, SLOTS_PER_CHUNK);
+    for (size_t i = 0; i < LIVE_COUNT; ++i) g_objects[i] = pool_alloc(&pool);
+    double ns = churn_pool(&pool);
+    if (ns < pool_ns) pool_ns = ns;
+    pool_finalize(&pool);
+
+    for (size_t i = 0; i < LIVE_COUNT; ++i) g_objects[i] = a_allocate(OBJECT_SIZE);
+    ns = churn_vsa();
+    if (ns < vsa_ns) vsa_ns = ns;
+    for (size_t i = 0; i < LIVE_COUNT; ++i) a_free(g_objects[i]);
+  }
+
+  printf("free+alloc churn of %d live %d byte objects, ns per op, best of %d runs\n",
+         LIVE_COUNT, OBJECT_SIZE, RUNS_COUNT);
+  printf("  pool_alloc/pool_free   %6.1f\n", pool_ns);
+  printf("  a_allocate/a_free      %6.1f\n", vsa_ns);
+
+  return 0;
+}
@@ -0,0 +1,186 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+
+#include "ring.h"
+#include "allocator.h"
+#include "logger.h"
+
+/// Throughput of the ring kinds with producer and consumer threads:
+///   spsc_ring with one of each, mpmc_ring and a single thread ring
+///   behind a mutex with 1..N of each, for single elements and batches.
+///   Then a push and a pop on one thread without contention.
+
+LogSeverity g_log_severity = LOG_WARNING;
+
+#define ITEMS_COUNT 2000000
+#define RING_CAPACITY 1024
+#define MAX_BATCH_SIZE 64
+#define MAX_THREADS 64
+
+typedef enum {
+  KIND_SPSC, KIND_MPMC, KIND_LOCKED
+} Kind;
+
+typedef struct {
+  size_t *ring;
+  Kind kind;
+  size_t batch_size;
+  size_t items_count;
+} ThreadCtx;
+
+static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
+static size_t g_consumed_count;
+static size_t g_consumers_goal;
+
+static double now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec * 1e-6;
+}
+
+static size_t push_many(const ThreadCtx *p_ctx, const size_t *items, size_t count) {
+  switch (p_ctx->kind) {
+    case KIND_SPSC: return spsc_ring_push_many(p_ctx->ring, items, count);
+    case KIND_MPMC: return mpmc_ring_push_many(p_ctx->ring, items, count);
+    case KIND_LOCKED: break;
+  }
+  pthread_mutex_lock(&g_lock);
+  size_t pushed = ring_push_many(p_ctx->ring, items, count);
+  pthread_mutex_unlock(&g_lock);
+  return pushed;
+}
+
+static size_t pop_many(const ThreadCtx *p_ctx, size_t *out, size_t count) {
+  switch (p_ctx->kind) {
+    case KIND_SPSC: return spsc_ring_pop_many(p_ctx->ring, out, count);
+    case KIND_MPMC: return mpmc_ring_pop_many(p_ctx->ring, out, count);
+    case KIND_LOCKED: break;
+  }
+  pthread_mutex_lock(&g_lock);
+  size_t popped = ring_pop_many(p_ctx->ring, out, count);
+  pthread_mutex_unlock(&g_lock);
+  return popped;
+}
+
+static void *producer_run(void *arg) {
+  const ThreadCtx *p_ctx = arg;
+  size_t batch[MAX_BATCH_SIZE];
+  for (size_t i = 0; i < MAX_BATCH_SIZE; ++i) batch[i] = i;
+  for (size_t done = 0; done < p_ctx->items_count;) {
+    size_t count = p_ctx->items_count - done < p_ctx->batch_size ? p_ctx->items_count - done
+                                                                   : p_ctx->batch_size;
+    for (size_t pushed = 0; pushed < count;) {
+      size_t n = push_many(p_ctx, batch + pushed, count - pushed);
+      if (0 == n) sched_yield();
+      pushed += n;
+    }
+    done += count;
+  }
+  return NULL;
+}
+
+static void *consumer_run(void *arg) {
+  const ThreadCtx *p_ctx = arg;
+  size_t batch[MAX_BATCH_SIZE];
+  while (__atomic_load_n(&g_consumed_count, __ATOMIC_RELAXED) < g_consumers_goal) {
+    size_t n = pop_many(p_ctx, batch, p_ctx->batch_size);
+    if (0 == n) {
+      sched_yield();
+      continue;
+    }
+    __atomic_fetch_add(&g_consumed_count, n, __ATOMIC_RELAXED);
+  }
+  return NULL;
+}
+
+static void bench_threads(Kind kind, size_t threads_count, size_t batch_size) {
+  size_t *ring;
+  switch (kind) {
+    case KIND_SPSC: spsc_ring_alloc(ring, RING_CAPACITY); break;
+    case KIND_MPMC: mpmc_ring_alloc(ring, RING_CAPACITY); break;
+    case KIND_LOCKED: ring_alloc(ring, RING_CAPACITY); break;
+  }
+  g_consumed_count = 0;
+  g_consumers_goal = ITEMS_COUNT / threads_count * threads_count;
+
+  static ThreadCtx producers[MAX_THREADS], consumers[MAX_THREADS];
+  pthread_t producer_threads[MAX_THREADS], consumer_threads[MAX_THREADS];
+  double start = now_ms();
+  for (size_t i = 0; i < threads_count; ++i) {
+    consumers[i] = (ThreadCtx){ ring, kind, batch_size, 0 };
+    pthread_create(&consumer_threads[i], NULL, consumer_run, &consumers[i]);
+  }
+  for (size_t i = 0; i < threads_count; ++i) {
+    producers[i] = (ThreadCtx){ ring, kind, batch_size, ITEMS_COUNT / threads_count };
+    pthread_create(&producer_threads[i], NULL, producer_run, &producers[i]);
+  }
+  for (size_t i = 0; i < threads_count; ++i) pthread_join(producer_threads[i], NULL);
+  for (size_t i = 0; i < threads_count; ++i) pthread_join(consumer_threads[i], NULL);
+  double elapsed = now_ms() - start;
+
+  static const char *kind_names[] = { "spsc", "mpmc", "mutex+ring" };
+  printf("%-12s %2luP/%2luC batch %2lu: %6.1f M items/s\n", kind_names[kind], threads_count,
+         threads_count, batch_size, g_consumers_goal / elapsed * 1e-3);
+  ring_free(ring);
+}
+
+static void bench_uncontended() {
+  size_t item = 1, out;
+  size_t *ring;
+  mpmc_ring_alloc(ring, RING_CAPACITY);
+  double start = now_ms();
+  for (size_t i = 0; i < ITEMS_COUNT; ++i) {
+    mpmc_ring_push(ring, &item);
+    mpmc_ring_pop(ring, &out);
+  }
+  double mpmc_ns = (now_ms() - start) * 1e6 / ITEMS_COUNT;
+  ring_free(ring);
+
+  spsc_ring_alloc(ring, RING_CAPACITY);
+  start = now_ms();
+  for (size_t i = 0; i < ITEMS_COUNT; ++i) {
+    spsc_ring_push(ring, &item);
+    spsc_ring_pop(ring, &out);
+  }
+  double spsc_ns = (now_ms() - start) * 1e6 / ITEMS_COUNT;
+  ring_free(ring);
+
+  ring_alloc(ring, RING_CAPACITY);
+  start = now_ms();
+  for (size_t i = 0; i < ITEMS_COUNT; ++i) {
+    pthread_mutex_lock(&g_lock);
+    ring_push(ring, &item);
+    pthread_mutex_unlock(&g_lock);
+    pthread_mutex_lock(&g_lock);
+    ring_pop(ring, &out);
+    pthread_mutex_unlock(&g_lock);
+  }
+  double locked_ns = (now_ms() - start) * 1e6 / ITEMS_COUNT;
+  ring_free(ring);
+
+  printf("one thread push+pop: spsc %.1f ns, mpmc %.1f ns, mutex+ring %.1f ns\n",
+         spsc_ns, mpmc_ns, locked_ns);
+}
+
+int main(int argc, char **argv) {
+  size_t max_threads = argc > 1 ? strtoul(argv[1], NULL, 10) : 4;
+  if (0 == max_threads || max_threads > MAX_THREADS) max_threads = 4;
+
+  if (!allocator_init(16lu * 1024lu * 1024lu)) abort();
+  atexit(allocator_finalize);
+
+  static const size_t batch_sizes[] = { 1, 32 };
+  for (size_t b = 0; b < sizeof(batch_sizes) / sizeof(batch_sizes[0]); ++b) {
+    bench_threads(KIND_SPSC, 1, batch_sizes[b]);
+    for (size_t threads_count = 1; threads_count <= max_threads; threads_count *= 2) {
+      bench_threads(KIND_MPMC, threads_count, batch_sizes[b]);
+      bench_threads(KIND_LOCKED, threads_count, batch_sizes[b]);
+    }
+  }
+  bench_uncontended();
+
+  return 0;
+}
@@ -0,0 +1,61 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "vec.h"
+#include "small_vec.h"
+#include "allocator.h"
+#include "logger.h"
+
+/// Short lived vectors: init, n pushes, a sum over the elements and free,
+///   vec against a small_vec keeping 8 elements inline.
+///   At n = 16 the small_vec spills to the allocator.
+
+LogSeverity g_log_severity = LOG_WARNING;
+
+#define ITERATIONS 5000000
+
+SMALL_VEC_DEFINE(int_small_vec, int, 8)
+
+static volatile long g_sink;
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+int main() {
+  if (!allocator_init(64lu * 1024lu * 1024lu)) abort();
+  atexit(allocator_finalize);
+
+  printf("ns per vector\n%4s %10s %14s\n", "n", "vec", "small_vec<8>");
+  for (int n = 2; n <= 16; n *= 2) {
+    long sum = 0;
+    double start = now_ns();
+    for (int it = 0; it < ITERATIONS; ++it) {
+      vec(int) v;
+      vec_alloc(v);
+      for (int i = 0; i < n; ++i) vec_push(v, it + i);
+      for (int i = 0; i < n; ++i) sum += v[i];
+      vec_free(v);
+    }
+    double vec_ns = (now_ns() - start) / ITERATIONS;
+
+    start = now_ns();
+    for (int it = 0; it < ITERATIONS; ++it) {
+      int_small_vec v;
+      int_small_vec_init(&v);
+      for (int i = 0; i < n; ++i) int_small_vec_push(&v, it + i);
+      const int *items = int_small_vec_data(&v);
+      for (int i = 0; i < n; ++i) sum += items[i];
+      int_small_vec_free(&v);
+    }
+    double small_vec_ns = (now_ns() - start) / ITERATIONS;
+    g_sink = sum;
+
+    printf("%4d %10.1f %14.1f\n", n, vec_ns, small_vec_ns);
+  }
+
+  return 0;
+}
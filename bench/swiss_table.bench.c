@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "swiss_table.h"
+#include "table.h"
+#include "allocator.h"
+#include "logger.h"
+
+/// Hits and misses of C string keys in SwissTable against Table,
+///   both with hash_cstr_default and strcmp. 98303 keys fill both tables
+///   to 0.75 of 131072 slots, 114000 keys fill SwissTable to 0.87
+///   while Table has grown to twice the slots.
+
+LogSeverity g_log_severity = LOG_WARNING;
+
+#define QUERIES_COUNT 2000000
+#define RUNS_COUNT 5
+#define KEY_SIZE 32
+
+static bool key_cmp_cstr(const void *lhs, const void *rhs) {
+  return 0 == strcmp(lhs, rhs);
+}
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static char g_hits[QUERIES_COUNT][KEY_SIZE];
+static char g_misses[QUERIES_COUNT][KEY_SIZE];
+
+static void bench_size(size_t keys_count) {
+  char (*keys)[KEY_SIZE] = malloc(keys_count * KEY_SIZE);
+  if (NULL == keys) abort();
+  for (size_t i = 0; i < keys_count; ++i) snprintf(keys[i], KEY_SIZE, "key:%zu", i * 7919);
+
+  // looked up by copies, so the stored key is not in cache from the query
+  size_t random_state = 1;
+  for (size_t i = 0; i < QUERIES_COUNT; ++i) {
+    random_state = random_state * 6364136223846793005ull + 1442695040888963407ull;
+    size_t index = (random_state >> 17) % keys_count;
+    memcpy(g_hits[i], keys[index], KEY_SIZE);
+    snprintf(g_misses[i], KEY_SIZE, "miss:%zu", index * 7919);
+  }
+
+  Table table;
+  table_init(&table, hash_cstr_default, key_cmp_cstr, NULL);
+  SwissTable swiss;
+  swiss_table_init(&swiss, hash_cstr_default, key_cmp_cstr, NULL);
+  for (size_t i = 0; i < keys_count; ++i) {
+    table_set(&table, keys[i], (void*)(i + 1));
+    swiss_table_set(&swiss, keys[i], (void*)(i + 1));
+  }
+
+  double table_hit_ns = 1e18, table_miss_ns = 1e18, swiss_hit_ns = 1e18, swiss_miss_ns = 1e18;
+  size_t found_count = 0;
+  void *value;
+  for (size_t run = 0; run < RUNS_COUNT; ++run) {
+    double start = now_ns();
+    for (size_t i = 0; i < QUERIES_COUNT; ++i) found_count += table_get(&table, g_hits[i], &value);
+    double ns = (now_ns() - start) / QUERIES_COUNT;
+    if (ns < table_hit_ns) table_hit_ns = ns;
+
+    start = now_ns();
+    for (size_t i = 0; i < QUERIES_COUNT; ++i) found_count += table_get(&table, g_misses[i], &value);
+    ns = (now_ns() - start) / QUERIES_COUNT;
+    if (ns < table_miss_ns) table_miss_ns = ns;
+
+    start = now_ns();
+    for (size_t i = 0; i < QUERIES_COUNT; ++i) {
+      found_count += swiss_table_get(&swiss, g_hits[i], &value);
+    }
+    ns = (now_ns() - start) / QUERIES_COUNT;
+    if (ns < swiss_hit_ns) swiss_hit_ns = ns;
+
+    start = now_ns();
+    for (size_t i = 0; i < QUERIES_COUNT; ++i) {
+      found_count += swiss_table_get(&swiss, g_misses[i], &value);
+    }
+    ns = (now_ns() - start) / QUERIES_COUNT;
+    if (ns < swiss_miss_ns) swiss_miss_ns = ns;
+  }
+  if (2 * RUNS_COUNT * QUERIES_COUNT != found_count) abort();
+
+  printf("%lu keys\n", keys_count);
+  printf("  Table       load %.2f  hit %6.1f ns  miss %6.1f ns\n",
+         (double)table.count / (table.capacity + 1), table_hit_ns, table_miss_ns);
+  printf("  SwissTable  load %.2f  hit %6.1f ns  miss %6.1f ns\n",
+         (double)swiss.count / swiss.capacity, swiss_hit_ns, swiss_miss_ns);
+
+  table_free(&table);
+  swiss_table_free(&swiss);
+  free(keys);
+}
+
+int main() {
+  if (!allocator_init(64lu * 1024lu * 1024lu)) abort();
+  atexit(allocator_finalize);
+
+  printf("best of %d runs of %d lookups\n", RUNS_COUNT, QUERIES_COUNT);
+  bench_size(98303);
+  bench_size(114000);
+
+  return 0;
+}
@@ -0,0 +1,117 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "table.h"
+#include "allocator.h"
+#include "logger.h"
+
+/// table_get and table_set one key at a time against table_get_many
+///   and table_set_many, for tables that fit in cache and tables that do not.
+/// Keys are C strings allocated one by one and looked up by copies,
+///   so a lookup misses on the bucket and on the stored key it compares.
+
+LogSeverity g_log_severity = LOG_WARNING;
+
+#define QUERIES_COUNT 1000000
+#define CALL_KEYS_COUNT 256
+#define RUNS_COUNT 5
+#define KEY_SIZE 32
+
+static bool key_cmp_cstr(const void *lhs, const void *rhs) {
+  return 0 == strcmp(lhs, rhs);
+}
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static size_t min_size(size_t lhs, size_t rhs) {
+  return lhs < rhs ? lhs : rhs;
+}
+
+static size_t next_random(size_t *p_state) {
+  *p_state = *p_state * 6364136223846793005ull + 1442695040888963407ull;
+  return *p_state >> 17;
+}
+
+static void bench_size(size_t keys_count) {
+  // keys are allocated in a shuffled order, so neighbours in the table
+  // are not neighbours in memory
+  char **keys = malloc(keys_count * sizeof(char*));
+  if (NULL == keys) abort();
+  size_t random_state = keys_count;
+  for (size_t i = 0; i < keys_count; ++i) keys[i] = NULL;
+  for (size_t i = 0; i < keys_count; ++i) {
+    size_t index = next_random(&random_state) % keys_count;
+    while (NULL != keys[index]) index = index + 1 < keys_count ? index + 1 : 0;
+    keys[index] = a_allocate(KEY_SIZE);
+    snprintf(keys[index], KEY_SIZE, "user:%zu:name", index);
+  }
+
+  Table table;
+  table_init(&table, hash_cstr_default, key_cmp_cstr, NULL);
+  table_set_many(&table, (const void *const *)keys, (void *const *)keys, keys_count);
+
+  static char query_keys[QUERIES_COUNT][KEY_SIZE];
+  static const void *queries[QUERIES_COUNT];
+  static void *values[QUERIES_COUNT];
+  for (size_t i = 0; i < QUERIES_COUNT; ++i) {
+    memcpy(query_keys[i], keys[next_random(&random_state) % keys_count], KEY_SIZE);
+    queries[i] = query_keys[i];
+  }
+
+  double get_ns = 1e18, get_many_ns = 1e18, set_ns = 1e18, set_many_ns = 1e18;
+  size_t found_count = 0;
+  for (size_t run = 0; run < RUNS_COUNT; ++run) {
+    double start = now_ns();
+    for (size_t i = 0; i < QUERIES_COUNT; ++i) found_count += table_get(&table, queries[i], values + i);
+    double end = now_ns();
+    if (end - start < get_ns) get_ns = end - start;
+
+    start = now_ns();
+    for (size_t i = 0; i < QUERIES_COUNT; i += CALL_KEYS_COUNT) {
+      found_count += table_get_many(&table, queries + i, min_size(CALL_KEYS_COUNT, QUERIES_COUNT - i),
+                                    values + i, NULL);
+    }
+    end = now_ns();
+    if (end - start < get_many_ns) get_many_ns = end - start;
+
+    // keys are present, so sets override values and the table keeps its size
+    start = now_ns();
+    for (size_t i = 0; i < QUERIES_COUNT; ++i) table_set(&table, queries[i], values[i]);
+    end = now_ns();
+    if (end - start < set_ns) set_ns = end - start;
+
+    start = now_ns();
+    for (size_t i = 0; i < QUERIES_COUNT; i += CALL_KEYS_COUNT) {
+      table_set_many(&table, queries + i, (void *const *)values + i,
+                     min_size(CALL_KEYS_COUNT, QUERIES_COUNT - i));
+    }
+    end = now_ns();
+    if (end - start < set_many_ns) set_many_ns = end - start;
+  }
+  if (2 * RUNS_COUNT * QUERIES_COUNT != found_count) abort();
+
+  printf("%10lu %10.1f %10.1f %10.1f %10.1f\n", keys_count, get_ns / QUERIES_COUNT,
+         get_many_ns / QUERIES_COUNT, set_ns / QUERIES_COUNT, set_many_ns / QUERIES_COUNT);
+
+  table_free(&table);
+  for (size_t i = 0; i < keys_count; ++i) a_free(keys[i]);
+  free(keys);
+}
+
+int main() {
+  if (!allocator_init(512lu * 1024lu * 1024lu)) abort();
+  atexit(allocator_finalize);
+
+  printf("ns per key, %d keys per *_many call\n", CALL_KEYS_COUNT);
+  printf("%10s %10s %10s %10s %10s\n", "keys", "get", "get_many", "set", "set_many");
+  static const size_t sizes[] = { 10000, 100000, 1000000, 4000000 };
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) bench_size(sizes[s]);
+
+  return 0;
+}
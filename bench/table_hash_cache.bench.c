@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "table.h"
+#include "allocator.h"
+#include "logger.h"
+
+/// What caching the key hash in Table entries buys for C string keys
+///   with hash_cstr_default and strcmp: growing a table from empty
+///   to KEYS_COUNT keys, where resizes place entries by the cached hash,
+///   and misses at 0.75 load, where probed entries of another hash
+///   are skipped without a strcmp.
+
+LogSeverity g_log_severity = LOG_WARNING;
+
+// 0.75 of 131072 entries, the most keys before the table grows again
+#define KEYS_COUNT 98303
+#define QUERIES_COUNT 2000000
+#define RUNS_COUNT 5
+#define KEY_SIZE 32
+
+static size_t g_hash_count;
+static size_t g_cmp_count;
+
+static size_t hash_cstr_counted(const void *key) {
+  ++g_hash_count;
+  return hash_cstr_default(key);
+}
+
+static bool key_cmp_cstr(const void *lhs, const void *rhs) {
+  return 0 == strcmp(lhs, rhs);
+}
+
+static bool key_cmp_cstr_counted(const void *lhs, const void *rhs) {
+  ++g_cmp_count;
+  return 0 == strcmp(lhs, rhs);
+}
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static char g_keys[KEYS_COUNT][KEY_SIZE];
+static char g_misses[QUERIES_COUNT][KEY_SIZE];
+
+int main() {
+  if (!allocator_init(64lu * 1024lu * 1024lu)) abort();
+  atexit(allocator_finalize);
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    snprintf(g_keys[i], KEY_SIZE, "table_hash_cache:%zu", i * 7919);
+  }
+  size_t random_state = 1;
+  for (size_t i = 0; i < QUERIES_COUNT; ++i) {
+    random_state = random_state * 6364136223846793005ull + 1442695040888963407ull;
+    snprintf(g_misses[i], KEY_SIZE, "table_hash_cache:%zu",
+             (random_state >> 17) % KEYS_COUNT * 7919 + 1);
+  }
+
+  double grow_ns = 1e18, miss_ns = 1e18;
+  size_t found_count = 0;
+  void *value;
+  for (size_t run = 0; run < RUNS_COUNT; ++run) {
+    Table table;
+    table_init(&table, hash_cstr_default, key_cmp_cstr, NULL);
+    double start = now_ns();
+    for (size_t i = 0; i < KEYS_COUNT; ++i) table_set(&table, g_keys[i], (void*)(i + 1));
+    double ns = now_ns() - start;
+    if (ns < grow_ns) grow_ns = ns;
+
+    start = now_ns();
+    for (size_t i = 0; i < QUERIES_COUNT; ++i) found_count += table_get(&table, g_misses[i], &value);
+    ns = (now_ns() - start) / QUERIES_COUNT;
+    if (ns < miss_ns) miss_ns = ns;
+    table_free(&table);
+  }
+  if (0 != found_count) abort();
+
+  // untimed, counting calls shows that resizes do not hash and misses do not compare
+  Table table;
+  table_init(&table, hash_cstr_counted, key_cmp_cstr_counted, NULL);
+  for (size_t i = 0; i < KEYS_COUNT; ++i) table_set(&table, g_keys[i], (void*)(i + 1));
+  double load = (double)table.count / (table.capacity + 1);
+  size_t grow_hash_count = g_hash_count;
+  g_cmp_count = 0;
+  for (size_t i = 0; i < QUERIES_COUNT; ++i) table_get(&table, g_misses[i], &value);
+  size_t miss_cmp_count = g_cmp_count;
+  table_free(&table);
+
+  printf("%d C string keys, best of %d runs\n", KEYS_COUNT, RUNS_COUNT);
+  printf("  growing from empty    %8.2f ms  %6.1f ns per key  %lu hash_func calls\n",
+         grow_ns * 1e-6, grow_ns / KEYS_COUNT, grow_hash_count);
+  printf("  miss at %.2f load     %8.1f ns            %.3f key_cmp calls per miss\n",
+         load, miss_ns, (double)miss_cmp_count / QUERIES_COUNT);
+
+  return 0;
+}
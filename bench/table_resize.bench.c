@@ -0,0 +1,73 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "table.h"
+#include "allocator.h"
+#include "logger.h"
+
+/// Latency of single table_set calls while a table grows to KEYS_COUNT keys,
+///   with and without incremental resize. The tail shows what one call
+///   can cost when the table grows: the mean hides it.
+
+LogSeverity g_log_severity = LOG_WARNING;
+
+#define KEYS_COUNT 4000000
+
+static size_t hash_size(const void *key) {
+  size_t x = (size_t)key;
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdull;
+  x ^= x >> 33;
+  return x;
+}
+
+static int latency_cmp(const void *lhs, const void *rhs) {
+  double l = *(const double*)lhs, r = *(const double*)rhs;
+  return l < r ? -1 : l > r;
+}
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void bench_set(double *latencies, bool is_incremental) {
+  Table table;
+  table_init(&table, hash_size, key_cmp_default, NULL);
+  table_set_resize_incremental(&table, is_incremental);
+
+  double total = 0;
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    double start = now_ns();
+    table_set(&table, (void*)(i + 1), (void*)1);
+    latencies[i] = now_ns() - start;
+    total += latencies[i];
+  }
+  table_free(&table);
+
+  qsort(latencies, KEYS_COUNT, sizeof(double), latency_cmp);
+  printf("%12s %8.0f %8.0f %8.0f %8.0f %10.0f %12.0f\n",
+         is_incremental ? "incremental" : "at once", total / KEYS_COUNT,
+         latencies[KEYS_COUNT / 2], latencies[KEYS_COUNT / 100 * 99],
+         latencies[KEYS_COUNT / 1000 * 999], latencies[KEYS_COUNT / 10000 * 9999],
+         latencies[KEYS_COUNT - 1]);
+}
+
+int main() {
+  if (!allocator_init(1024lu * 1024lu * 1024lu)) abort();
+  atexit(allocator_finalize);
+
+  double *latencies = malloc(KEYS_COUNT * sizeof(double));
+  if (NULL == latencies) abort();
+
+  printf("table_set latency over %d keys, ns\n", KEYS_COUNT);
+  printf("%12s %8s %8s %8s %8s %10s %12s\n", "resize", "mean", "p50", "p99", "p999",
+         "p9999", "max");
+  bench_set(latencies, false);
+  bench_set(latencies, true);
+
+  free(latencies);
+  return 0;
+}
@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "typed_table.h"
+#include "allocator.h"
+#include "logger.h"
+
+/// Tables from TABLE_DEFINE against Table holding the same keys:
+///   u64 keys boxed behind pointers, u64 keys cast to void* and StringView
+///   keys behind pointers. Set includes growth from an empty table,
+///   get looks up random existing keys.
+
+LogSeverity g_log_severity = LOG_WARNING;
+
+#define QUERIES_COUNT 4000000
+#define RUNS_COUNT 5
+#define KEY_SIZE 40
+
+TABLE_DEFINE(u64_table, uint64_t, uint64_t, typed_table_hash_u64, typed_table_eq_u64)
+TABLE_DEFINE(sv_table, StringView, size_t, typed_table_hash_string_view, typed_table_eq_string_view)
+
+static size_t hash_boxed_u64(const void *key) {
+  return typed_table_hash_u64(*(const uint64_t*)key);
+}
+
+static bool eq_boxed_u64(const void *lhs, const void *rhs) {
+  return *(const uint64_t*)lhs == *(const uint64_t*)rhs;
+}
+
+static size_t hash_u64_in_pointer(const void *key) {
+  return typed_table_hash_u64((uint64_t)key);
+}
+
+static bool eq_string_view(const void *lhs, const void *rhs) {
+  return typed_table_eq_string_view(*(const StringView*)lhs, *(const StringView*)rhs);
+}
+
+static double now_ns() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+typedef enum {
+  U64_TYPED, U64_BOXED, U64_IN_POINTER, SV_TYPED, SV_TABLE, KINDS_COUNT
+} Kind;
+
+static const char *g_kind_names[KINDS_COUNT] = {
+  "u64 TABLE_DEFINE", "u64 boxed in Table", "u64 as void* key",
+  "sv  TABLE_DEFINE", "sv  Table"
+};
+
+static void bench_size(size_t keys_count) {
+  uint64_t *keys = malloc(keys_count * sizeof(uint64_t));
+  char (*strings)[KEY_SIZE] = malloc(keys_count * KEY_SIZE);
+  StringView *views = malloc(keys_count * sizeof(StringView));
+  size_t *queries = malloc(QUERIES_COUNT * sizeof(size_t));
+  if (NULL == keys || NULL == strings || NULL == views || NULL == queries) abort();
+
+  for (size_t i = 0; i < keys_count; ++i) {
+    keys[i] = i * 2654435761u + 7;
+    snprintf(strings[i], KEY_SIZE, "/api/v1/users/%zu/profile", i * 7919);
+    views[i] = string_view_from_cstr(strings[i]);
+  }
+  size_t random_state = 1;
+  for (size_t i = 0; i < QUERIES_COUNT; ++i) {
+    random_state = random_state * 6364136223846793005ull + 1442695040888963407ull;
+    queries[i] = (random_state >> 17) % keys_count;
+  }
+
+  double set_ns[KINDS_COUNT], get_ns[KINDS_COUNT];
+  for (size_t k = 0; k < KINDS_COUNT; ++k) set_ns[k] = get_ns[k] = 1e18;
+  size_t sum = 0;
+  for (size_t run = 0; run < RUNS_COUNT; ++run) {
+    double times[2 * KINDS_COUNT + 1];
+
+    times[0] = now_ns();
+    u64_table typed;
+    u64_table_init(&typed);
+    for (size_t i = 0; i < keys_count; ++i) u64_table_set(&typed, keys[i], i);
+    times[1] = now_ns();
+    for (size_t i = 0; i < QUERIES_COUNT; ++i) {
+      uint64_t value;
+      if (u64_table_get(&typed, keys[queries[i]], &value)) sum += value;
+    }
+    times[2] = now_ns();
+
+    Table boxed;
+    table_init(&boxed, hash_boxed_u64, eq_boxed_u64, NULL);
+    for (size_t i = 0; i < keys_count; ++i) table_set(&boxed, keys + i, (void*)i);
+    times[3] = now_ns();
+    for (size_t i = 0; i < QUERIES_COUNT; ++i) {
+      void *value;
+      uint64_t key = keys[queries[i]];
+      if (table_get(&boxed, &key, &value)) sum += (size_t)value;
+    }
+    times[4] = now_ns();
+
+    Table in_pointer;
+    table_init(&in_pointer, hash_u64_in_pointer, key_cmp_default, NULL);
+    for (size_t i = 0; i < keys_count; ++i) table_set(&in_pointer, (void*)keys[i], (void*)i);
+    times[5] = now_ns();
+    for (size_t i = 0; i < QUERIES_COUNT; ++i) {
+      void *value;
+      if (table_get(&in_pointer, (void*)keys[queries[i]], &value)) sum += (size_t)value;
+    }
+    times[6] = now_ns();
+
+    sv_table typed_views;
+    sv_table_init(&typed_views);
+    for (size_t i = 0; i < keys_count; ++i) sv_table_set(&typed_views, views[i], i);
+    times[7] = now_ns();
+    for (size_t i = 0; i < QUERIES_COUNT; ++i) {
+      size_t value;
+      if (sv_table_get(&typed_views, views[queries[i]], &value)) sum += value;
+    }
+    times[8] = now_ns();
+
+    Table table_views;
+    table_init(&table_views, hash_string_view_default, eq_string_view, NULL);
+    for (size_t i = 0; i < keys_count; ++i) table_set(&table_views, views + i, (void*)i);
+    times[9] = now_ns();
+    for (size_t i = 0; i < QUERIES_COUNT; ++i) {
+      void *value;
+      StringView key = views[queries[i]];
+      if (table_get(&table_views, &key, &value)) sum += (size_t)value;
+    }
+    times[10] = now_ns();
+
+    for (size_t k = 0; k < KINDS_COUNT; ++k) {
+      double set = (times[2 * k + 1] - times[2 * k]) / keys_count;
+      double get = (times[2 * k + 2] - times[2 * k + 1]) / QUERIES_COUNT;
+      if (set < set_ns[k]) set_ns[k] = set;
+      if (get < get_ns[k]) get_ns[k] = get;
+    }
+
+    u64_table_free(&typed);
+    table_free(&boxed);
+    table_free(&in_pointer);
+    sv_table_free(&typed_views);
+    table_free(&table_views);
+  }
+
+  printf("%lu keys (checksum %lu)\n", keys_count, sum & 0xff);
+  for (size_t k = 0; k < KINDS_COUNT; ++k) {
+    printf("  %-20s set %7.1f get %7.1f\n", g_kind_names[k], set_ns[k], get_ns[k]);
+  }
+
+  free(keys);
+  free(strings);
+  free(views);
+  free(queries);
+}
+
+int main() {
+  if (!allocator_init(1024lu * 1024lu * 1024lu)) abort();
+  atexit(allocator_finalize);
+
+  printf("ns per operation, best of %d runs\n", RUNS_COUNT);
+  bench_size(100000);
+  bench_size(2000000);
+
+  return 0;
+}
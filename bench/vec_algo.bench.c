@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "vec_algo.h"
+#include "thread_pool.h"
+#include "allocator.h"
+#include "logger.h"
+
+/// Sorting random ints: qsort, name##_sort, name##_radix_sort
+///   and name##_parallel_sort on pools of 1..N threads.
+/// A pool of one thread runs parallel_sort serially and shows its overhead.
+/// Sizes go from 1M ints by tens up to the second argument, 10M by default,
+///   100000000 adds the 100M run, which needs about 800 MB and minutes.
+
+LogSeverity g_log_severity = LOG_WARNING;
+
+#define RUNS_COUNT 3
+#define MAX_THREADS 64
+
+VEC_ALGO_DEFINE(int_algo, int, vec_algo_less_int)
+VEC_RADIX_SORT_DEFINE(int_radix, int, vec_algo_key_int)
+
+static int int_cmp(const void *lhs, const void *rhs) {
+  int l = *(const int*)lhs, r = *(const int*)rhs;
+  return (l > r) - (l < r);
+}
+
+static double now_ms() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec * 1e-6;
+}
+
+typedef enum {
+  SORT_QSORT, SORT_INTROSORT, SORT_RADIX, SORT_PARALLEL
+} SortKind;
+
+/// Best time of RUNS_COUNT sorts of a copy of @source
+static double time_sort(SortKind kind, ThreadPool *pool, const int *source, int *items,
+                        size_t count) {
+  double best = 1e18;
+  for (size_t run = 0; run < RUNS_COUNT; ++run) {
+    memcpy(items, source, count * sizeof(int));
+    double start = now_ms();
+    switch (kind) {
+      case SORT_QSORT: qsort(items, count, sizeof(int), int_cmp); break;
+      case SORT_INTROSORT: int_algo_sort(items, count); break;
+      case SORT_RADIX: int_radix_radix_sort(items, count, NULL); break;
+      case SORT_PARALLEL: int_algo_parallel_sort(pool, items, count, NULL); break;
+    }
+    double elapsed = now_ms() - start;
+    if (!int_algo_is_sorted(items, count)) abort();
+    if (elapsed < best) best = elapsed;
+  }
+  return best;
+}
+
+static void bench_size(size_t count, size_t max_threads) {
+  int *source = malloc(count * sizeof(int));
+  int *items = malloc(count * sizeof(int));
+  if (NULL == source || NULL == items) abort();
+  uint64_t state = 88172645463325252ull;
+  for (size_t i = 0; i < count; ++i) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    source[i] = (int)state;
+  }
+
+  printf("%lu ints: qsort %.1f ms, sort %.1f ms, radix_sort %.1f ms\n", count,
+         time_sort(SORT_QSORT, NULL, source, items, count),
+         time_sort(SORT_INTROSORT, NULL, source, items, count),
+         time_sort(SORT_RADIX, NULL, source, items, count));
+  for (size_t threads_count = 1; threads_count <= max_threads; threads_count *= 2) {
+    ThreadPool pool;
+    if (!thread_pool_init(&pool, threads_count - 1)) abort();
+    printf("  parallel_sort, %2lu threads: %.1f ms\n", threads_count,
+           time_sort(SORT_PARALLEL, &pool, source, items, count));
+    thread_pool_free(&pool);
+  }
+
+  free(source);
+  free(items);
+}
+
+int main(int argc, char **argv) {
+  size_t max_threads = argc > 1 ? strtoul(argv[1], NULL, 10) : 8;
+  if (0 == max_threads || max_threads > MAX_THREADS) max_threads = 8;
+  size_t max_count = argc > 2 ? strtoul(argv[2], NULL, 10) : 10000000;
+
+  if (!allocator_init(64lu * 1024lu * 1024lu)) abort();
+  atexit(allocator_finalize);
+
+  for (size_t count = 1000000; count <= max_count; count *= 10) bench_size(count, max_threads);
+
+  return 0;
+}
@@ -1,18 +1,543 @@
 #include <assert.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include "vsa.h"
+#include "arena.h"
 #include "allocator.h"
 #include "logger.h"
 
 static void *g_memory;
+static size_t g_memory_size;
+static Vsa g_vsa;
 static Vsa *gp_vsa;
 
-#ifdef ALLOCATOR_DUMP_MEMORY_ON_FINALIZE
-static size_t g_number_of_allocs;
-static size_t g_number_of_frees;
-#endif // !ALLOCATOR_DUMP_MEMORY_ON_FINALIZE
+/// Counters of allocator_get_stats bumped on every call
+typedef struct {
+  size_t allocs[ALLOCATOR_STATS_CLASS_COUNT];
+  size_t frees[ALLOCATOR_STATS_CLASS_COUNT];
+  size_t reallocs[ALLOCATOR_STATS_CLASS_COUNT];
+  size_t realloc_copy_bytes;
+} StatsCounters;
+
+#ifdef ALLOCATOR_THREAD_SAFE
+#include <pthread.h>
+
+/// Blocks up to this size are served from thread local caches
+#define CACHE_MAX_BLOCK_SIZE 256
+#define CACHE_CLASS_COUNT (CACHE_MAX_BLOCK_SIZE / sizeof(size_t) + 1)
+
+/// Number of blocks moved between a thread cache and the global Vsa at once
+#define CACHE_BATCH_SIZE 32
+
+/// A class holding more blocks than this returns a batch to the global Vsa
+#define CACHE_CLASS_MAX_COUNT (CACHE_BATCH_SIZE * 2)
+
+/// Bytes in use a thread may add or remove before it updates the shared total
+#define STATS_IN_USE_BATCH (64 * 1024)
+
+/// Per thread lists of free small blocks, indexed by block size in words.
+/// Blocks in the lists are taken in the global Vsa
+///   and are linked through their first word.
+/// Every block belongs to the global Vsa, so a block freed by another thread
+///   than the one that allocated it simply joins the freeing thread's cache
+///   and goes back to the Vsa with the next batch.
+///
+/// The cache also keeps statistics of the thread, so allocations do not
+///   write shared cache lines. Only the owning thread writes them, by relaxed
+///   atomic stores, allocator_get_stats sums them over registered caches
+///   and they are folded into g_stats when the thread exits.
+typedef struct ThreadCache {
+  void *heads[CACHE_CLASS_COUNT];
+  size_t counts[CACHE_CLASS_COUNT];
+  bool is_registered;
+
+  StatsCounters counters;
+  /// Bytes in use added by the thread since it last updated g_stats,
+  ///   negative when it freed more than it allocated
+  ptrdiff_t in_use_delta;
+  /// Highest in_use_delta since then, to estimate the peak
+  ptrdiff_t in_use_delta_peak;
+
+  /// Registered caches, under g_stats_lock
+  struct ThreadCache *p_prev;
+  struct ThreadCache *p_next;
+} ThreadCache;
+
+static pthread_mutex_t g_vsa_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t g_cache_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t g_cache_key;
+static _Thread_local ThreadCache t_cache;
+
+/// Guards the list of registered caches, bytes in use and its peak in g_stats
+static pthread_mutex_t g_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static ThreadCache *gp_caches;
+
+#define VSA_LOCK() pthread_mutex_lock(&g_vsa_lock)
+#define VSA_UNLOCK() pthread_mutex_unlock(&g_vsa_lock)
+#define THREAD_LOCAL _Thread_local
+// counters are shared by all threads, relaxed atomics keep them cheap
+#define COUNTER_ADD(counter, value) __atomic_add_fetch(&(counter), (value), __ATOMIC_RELAXED)
+#define COUNTER_SUB(counter, value) __atomic_sub_fetch(&(counter), (value), __ATOMIC_RELAXED)
+#define COUNTER_LOAD(counter) __atomic_load_n(&(counter), __ATOMIC_RELAXED)
+// a counter written by its thread only is bumped without a locked instruction
+#define THREAD_COUNTER_ADD(counter, value) \
+  __atomic_store_n(&(counter), (counter) + (value), __ATOMIC_RELAXED)
+
+static void cache_register(ThreadCache *p_cache);
+#else
+#define VSA_LOCK()
+#define VSA_UNLOCK()
+#define THREAD_LOCAL
+#define COUNTER_ADD(counter, value) ((counter) += (value))
+#define COUNTER_SUB(counter, value) ((counter) -= (value))
+#define COUNTER_LOAD(counter) (counter)
+#define THREAD_COUNTER_ADD(counter, value) ((counter) += (value))
+#endif // !ALLOCATOR_THREAD_SAFE
+
+/// Arena new allocations of the thread go to, see allocator_set_scratch
+static THREAD_LOCAL Arena *tp_scratch;
+
+/// Counters of allocator_get_stats, sizes are usable sizes of blocks.
+/// Allocations in the scratch arena are not counted.
+static struct {
+  size_t bytes_in_use;
+  size_t peak_bytes_in_use;
+  size_t mapped_bytes;
+  /// With ALLOCATOR_THREAD_SAFE counters of threads that exited
+  StatsCounters counters;
+} g_stats;
+
+
+static size_t stats_class_index(size_t size) {
+  if (size <= ALLOCATOR_STATS_CLASS_MIN_SIZE) return 0;
+
+  // ceil(log2(size)) - log2(ALLOCATOR_STATS_CLASS_MIN_SIZE)
+  size_t class_index = sizeof(size_t) * CHAR_BIT - __builtin_clzl(size - 1) 
+                       - __builtin_ctzl(ALLOCATOR_STATS_CLASS_MIN_SIZE);
+  return class_index < ALLOCATOR_STATS_CLASS_COUNT ? class_index : ALLOCATOR_STATS_CLASS_COUNT - 1;
+}
+
+#ifdef ALLOCATOR_THREAD_SAFE
+/// Adds @p_from to @p_to
+static void stats_counters_add(StatsCounters *p_to, const StatsCounters *p_from) {
+  for (size_t i = 0; i < ALLOCATOR_STATS_CLASS_COUNT; ++i) {
+    p_to->allocs[i] += COUNTER_LOAD(p_from->allocs[i]);
+    p_to->frees[i] += COUNTER_LOAD(p_from->frees[i]);
+    p_to->reallocs[i] += COUNTER_LOAD(p_from->reallocs[i]);
+  }
+  p_to->realloc_copy_bytes += COUNTER_LOAD(p_from->realloc_copy_bytes);
+}
+
+static ThreadCache *stats_get_cache(void) {
+  if (!t_cache.is_registered) cache_register(&t_cache);
+  return &t_cache;
+}
+
+static StatsCounters *stats_get_counters(void) {
+  return &stats_get_cache()->counters;
+}
+
+/// Adds bytes in use of the thread to g_stats, under g_stats_lock
+static void stats_flush_in_use(ThreadCache *p_cache) {
+  // the total is below zero for a while when the thread frees blocks
+  // of other threads that have not added them yet
+  ptrdiff_t in_use = (ptrdiff_t)g_stats.bytes_in_use;
+  ptrdiff_t peak = in_use + p_cache->in_use_delta_peak;
+  if (peak > (ptrdiff_t)g_stats.peak_bytes_in_use) g_stats.peak_bytes_in_use = peak;
+  g_stats.bytes_in_use = in_use + p_cache->in_use_delta;
+  __atomic_store_n(&p_cache->in_use_delta, 0, __ATOMIC_RELAXED);
+  __atomic_store_n(&p_cache->in_use_delta_peak, 0, __ATOMIC_RELAXED);
+}
+
+static void stats_change_in_use(ptrdiff_t delta) {
+  ThreadCache *p_cache = stats_get_cache();
+  ptrdiff_t in_use_delta = p_cache->in_use_delta + delta;
+  __atomic_store_n(&p_cache->in_use_delta, in_use_delta, __ATOMIC_RELAXED);
+  if (in_use_delta > p_cache->in_use_delta_peak) {
+    __atomic_store_n(&p_cache->in_use_delta_peak, in_use_delta, __ATOMIC_RELAXED);
+  }
+
+  if (in_use_delta > STATS_IN_USE_BATCH || in_use_delta < -STATS_IN_USE_BATCH) {
+    pthread_mutex_lock(&g_stats_lock);
+    stats_flush_in_use(p_cache);
+    pthread_mutex_unlock(&g_stats_lock);
+  }
+}
+#else
+static StatsCounters *stats_get_counters(void) {
+  return &g_stats.counters;
+}
+
+static void stats_change_in_use(ptrdiff_t delta) {
+  g_stats.bytes_in_use += delta;
+  if (g_stats.bytes_in_use > g_stats.peak_bytes_in_use) {
+    g_stats.peak_bytes_in_use = g_stats.bytes_in_use;
+  }
+}
+#endif // !ALLOCATOR_THREAD_SAFE
+
+static void stats_on_allocate(void *ptr) {
+  if (NULL == ptr) return;
+  size_t size = vsa_usable_size(ptr);
+  StatsCounters *p_counters = stats_get_counters();
+  THREAD_COUNTER_ADD(p_counters->allocs[stats_class_index(size)], 1);
+  stats_change_in_use((ptrdiff_t)size);
+}
+
+static void stats_on_free(size_t size) {
+  StatsCounters *p_counters = stats_get_counters();
+  THREAD_COUNTER_ADD(p_counters->frees[stats_class_index(size)], 1);
+  stats_change_in_use(-(ptrdiff_t)size);
+}
+
+/// @param old_size: usable size of @ptr before the reallocation, 0 if @ptr is NULL
+static void stats_on_reallocate(void *ptr, void *new_ptr, size_t old_size, size_t new_size) {
+  if (NULL == ptr) {
+    stats_on_allocate(new_ptr);
+    return;
+  }
+  if (0 == new_size) {
+    stats_on_free(old_size);
+    return;
+  }
+  if (NULL == new_ptr) return;
+
+  size_t size = vsa_usable_size(new_ptr);
+  StatsCounters *p_counters = stats_get_counters();
+  THREAD_COUNTER_ADD(p_counters->reallocs[stats_class_index(size)], 1);
+  if (new_ptr != ptr) THREAD_COUNTER_ADD(p_counters->realloc_copy_bytes, old_size);
+  stats_change_in_use((ptrdiff_t)size - (ptrdiff_t)old_size);
+}
+
+
+#ifdef ALLOCATOR_PROFILER
+/// Sampled allocations that are still live, keyed by pointer.
+/// Lookups on free do not lock: a slot is probed only within a short window
+///   and a removed pointer leaves a tombstone, so an empty slot ends the search.
+#define PROFILE_LIVE_COUNT 4096
+#define PROFILE_LIVE_PROBE_MAX 8
+#define PROFILE_TOMBSTONE ((void*)1)
+
+typedef struct {
+  void *ptr;
+  size_t site_index;
+  size_t estimated_bytes;
+} ProfileLive;
+
+static AllocatorProfileSite g_profile_sites[ALLOCATOR_PROFILE_SITE_COUNT];
+static ProfileLive g_profile_live[PROFILE_LIVE_COUNT];
+static size_t g_profile_sample_interval;
+static size_t g_profile_dropped_samples;
+
+static THREAD_LOCAL const char *tp_profile_tag;
+static THREAD_LOCAL size_t tp_profile_countdown;
+static THREAD_LOCAL size_t tp_profile_random;
+
+#ifdef ALLOCATOR_THREAD_SAFE
+static pthread_mutex_t g_profile_lock = PTHREAD_MUTEX_INITIALIZER;
+#define PROFILE_LOCK() pthread_mutex_lock(&g_profile_lock)
+#define PROFILE_UNLOCK() pthread_mutex_unlock(&g_profile_lock)
+#else
+#define PROFILE_LOCK()
+#define PROFILE_UNLOCK()
+#endif // !ALLOCATOR_THREAD_SAFE
+
+#define PROFILE_PTR_LOAD(slot) __atomic_load_n(&(slot), __ATOMIC_ACQUIRE)
+#define PROFILE_PTR_STORE(slot, value) __atomic_store_n(&(slot), (value), __ATOMIC_RELEASE)
+
+static size_t profile_hash(const void *ptr) {
+  size_t hash = (size_t)ptr * 0x9E3779B97F4A7C15ull;
+  return hash ^ (hash >> 29);
+}
+
+/// Bytes to allocate until the next sample, random around the interval
+///   so periodic allocation patterns are not sampled in lockstep
+static size_t profile_next_countdown(size_t interval) {
+  size_t x = tp_profile_random;
+  if (0 == x) x = profile_hash(&tp_profile_random) | 1;
+  x ^= x << 13;
+  x ^= x >> 7;
+  x ^= x << 17;
+  tp_profile_random = x;
+  return interval / 2 + x % interval;
+}
+
+static AllocatorProfileSite *profile_find_site(const char *tag, void *call_site) {
+  size_t mask = ALLOCATOR_PROFILE_SITE_COUNT - 1;
+  size_t index = profile_hash((char*)call_site + (size_t)tag) & mask;
+  for (size_t i = 0; i < ALLOCATOR_PROFILE_SITE_COUNT; ++i) {
+    AllocatorProfileSite *p_site = &g_profile_sites[(index + i) & mask];
+    if (0 == p_site->sampled_count) {
+      p_site->tag = tag;
+      p_site->call_site = call_site;
+      return p_site;
+    }
+    if (p_site->tag == tag && p_site->call_site == call_site) return p_site;
+  }
+  return NULL;
+}
+
+static void profile_sample(void *ptr, size_t size, void *call_site, size_t interval) {
+  // allocation stands for all bytes allocated since the previous sample
+  size_t estimated_bytes = size > interval ? size : interval;
+
+  PROFILE_LOCK();
+  AllocatorProfileSite *p_site = profile_find_site(tp_profile_tag, call_site);
+  if (NULL == p_site) {
+    ++g_profile_dropped_samples;
+    PROFILE_UNLOCK();
+    return;
+  }
+  ++p_site->sampled_count;
+  p_site->estimated_bytes += estimated_bytes;
+
+  size_t index = profile_hash(ptr);
+  for (size_t i = 0; i < PROFILE_LIVE_PROBE_MAX; ++i) {
+    ProfileLive *p_live = &g_profile_live[(index + i) % PROFILE_LIVE_COUNT];
+    void *slot_ptr = p_live->ptr;
+    if (NULL != slot_ptr && PROFILE_TOMBSTONE != slot_ptr) continue;
+
+    p_live->site_index = p_site - g_profile_sites;
+    p_live->estimated_bytes = estimated_bytes;
+    PROFILE_PTR_STORE(p_live->ptr, ptr);
+    p_site->estimated_live_bytes += estimated_bytes;
+    break;
+  }
+  PROFILE_UNLOCK();
+}
+
+static void profile_on_allocate(void *ptr, void *call_site) {
+  size_t interval = COUNTER_LOAD(g_profile_sample_interval);
+  if (0 == interval || NULL == ptr) return;
+
+  size_t size = vsa_usable_size(ptr);
+  if (tp_profile_countdown > size) {
+    tp_profile_countdown -= size;
+    return;
+  }
+  tp_profile_countdown = profile_next_countdown(interval);
+  profile_sample(ptr, size, call_site, interval);
+}
+
+static void profile_on_free(void *ptr) {
+  size_t index = profile_hash(ptr);
+  for (size_t i = 0; i < PROFILE_LIVE_PROBE_MAX; ++i) {
+    ProfileLive *p_live = &g_profile_live[(index + i) % PROFILE_LIVE_COUNT];
+    void *slot_ptr = PROFILE_PTR_LOAD(p_live->ptr);
+    if (NULL == slot_ptr) return;
+    if (ptr != slot_ptr) continue;
+
+    PROFILE_LOCK();
+    if (ptr == p_live->ptr) {
+      g_profile_sites[p_live->site_index].estimated_live_bytes -= p_live->estimated_bytes;
+      PROFILE_PTR_STORE(p_live->ptr, PROFILE_TOMBSTONE);
+    }
+    PROFILE_UNLOCK();
+    return;
+  }
+}
+
+static void profile_reset(void) {
+  PROFILE_LOCK();
+  memset(g_profile_sites, 0, sizeof(g_profile_sites));
+  memset(g_profile_live, 0, sizeof(g_profile_live));
+  g_profile_dropped_samples = 0;
+  PROFILE_UNLOCK();
+}
+
+#define PROFILE_ALLOCATE(ptr) profile_on_allocate((ptr), __builtin_return_address(0))
+#define PROFILE_FREE(ptr) profile_on_free(ptr)
+#define PROFILE_REALLOCATE(ptr, new_ptr, new_size)\
+  do {\
+    if ((ptr) != (new_ptr) && (NULL != (new_ptr) || 0 == (new_size))) {\
+      if (NULL != (ptr)) PROFILE_FREE(ptr);\
+      PROFILE_ALLOCATE(new_ptr);\
+    }\
+  } while (0)
+#else
+#define PROFILE_ALLOCATE(ptr)
+#define PROFILE_FREE(ptr)
+#define PROFILE_REALLOCATE(ptr, new_ptr, new_size)
+#endif // !ALLOCATOR_PROFILER
+
+#ifdef ALLOCATOR_THREAD_SAFE
+/// Returns cached blocks of the class back to the global Vsa
+static void cache_flush(ThreadCache *p_cache, size_t class_index, size_t count) {
+  VSA_LOCK();
+  while (count-- > 0 && NULL != p_cache->heads[class_index]) {
+    void *block = p_cache->heads[class_index];
+    p_cache->heads[class_index] = *(void**)block;
+    --p_cache->counts[class_index];
+    vsa_free(gp_vsa, block);
+  }
+  VSA_UNLOCK();
+}
+
+static void cache_flush_all(ThreadCache *p_cache) {
+  for (size_t i = 0; i < CACHE_CLASS_COUNT; ++i) {
+    cache_flush(p_cache, i, p_cache->counts[i]);
+  }
+}
+
+/// Flushes the cache and folds its statistics into g_stats,
+///   called when the thread exits
+static void cache_release(void *ptr) {
+  ThreadCache *p_cache = ptr;
+  cache_flush_all(p_cache);
+
+  pthread_mutex_lock(&g_stats_lock);
+  stats_counters_add(&g_stats.counters, &p_cache->counters);
+  stats_flush_in_use(p_cache);
+  if (NULL != p_cache->p_prev) p_cache->p_prev->p_next = p_cache->p_next;
+  else gp_caches = p_cache->p_next;
+  if (NULL != p_cache->p_next) p_cache->p_next->p_prev = p_cache->p_prev;
+  pthread_mutex_unlock(&g_stats_lock);
+
+  memset(p_cache, 0, sizeof(*p_cache));
+}
+
+static void cache_create_key(void) {
+  pthread_key_create(&g_cache_key, cache_release);
+}
+
+/// Makes sure the cache is released when the thread exits
+///   and its statistics are visible to allocator_get_stats
+static void cache_register(ThreadCache *p_cache) {
+  pthread_once(&g_cache_key_once, cache_create_key);
+  pthread_setspecific(g_cache_key, p_cache);
+
+  pthread_mutex_lock(&g_stats_lock);
+  p_cache->p_prev = NULL;
+  p_cache->p_next = gp_caches;
+  if (NULL != gp_caches) gp_caches->p_prev = p_cache;
+  gp_caches = p_cache;
+  pthread_mutex_unlock(&g_stats_lock);
+
+  p_cache->is_registered = true;
+}
+
+static size_t cache_block_size(size_t bytes) {
+  if (bytes < VSA_BLOCK_MIN_SIZE) return VSA_BLOCK_MIN_SIZE;
+  return (bytes + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1);
+}
+
+static void *cache_allocate(size_t block_size) {
+  size_t class_index = block_size / sizeof(size_t);
+  ThreadCache *p_cache = &t_cache;
+
+  if (NULL == p_cache->heads[class_index]) {
+    if (!p_cache->is_registered) cache_register(p_cache);
+
+    VSA_LOCK();
+    for (size_t i = 0; i < CACHE_BATCH_SIZE; ++i) {
+      void *block = vsa_alloc(gp_vsa, block_size);
+      if (NULL == block) break;
+      *(void**)block = p_cache->heads[class_index];
+      p_cache->heads[class_index] = block;
+      ++p_cache->counts[class_index];
+    }
+    VSA_UNLOCK();
+
+    if (NULL == p_cache->heads[class_index]) return NULL;
+  }
+
+  void *block = p_cache->heads[class_index];
+  p_cache->heads[class_index] = *(void**)block;
+  --p_cache->counts[class_index];
+  return block;
+}
+
+static void cache_free(void *ptr, size_t block_size) {
+  size_t class_index = block_size / sizeof(size_t);
+  ThreadCache *p_cache = &t_cache;
+
+  if (!p_cache->is_registered) cache_register(p_cache);
+
+  *(void**)ptr = p_cache->heads[class_index];
+  p_cache->heads[class_index] = ptr;
+
+  if (++p_cache->counts[class_index] > CACHE_CLASS_MAX_COUNT) {
+    cache_flush(p_cache, class_index, CACHE_BATCH_SIZE);
+  }
+}
+#endif // !ALLOCATOR_THREAD_SAFE
+
+
+// Arena takes its chunks from the global allocator,
+// so routing to the scratch arena is suspended while the arena is called
+
+static void *scratch_allocate(size_t bytes, size_t alignment) {
+  Arena *p_arena = tp_scratch;
+  tp_scratch = NULL;
+  void *ptr = arena_alloc_aligned(p_arena, bytes, alignment);
+  tp_scratch = p_arena;
+  return ptr;
+}
+
+static void *scratch_reallocate(void *ptr, size_t old_size, size_t new_size,
+                                size_t alignment) {
+  Arena *p_arena = tp_scratch;
+  tp_scratch = NULL;
+  void *new_ptr = arena_realloc_aligned(p_arena, ptr, old_size, new_size, alignment);
+  tp_scratch = p_arena;
+  return new_ptr;
+}
+
+
+static size_t page_align(size_t size) {
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  return (size + page_size - 1) & ~(page_size - 1);
+}
+
+/// Maps zeroed pages from the system,
+///   with ALLOCATOR_HUGE_PAGES defined transparent huge pages are requested for them
+static void *memory_map(size_t size) {
+  void *mem = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (MAP_FAILED == mem) return NULL;
+#if defined(ALLOCATOR_HUGE_PAGES) && defined(MADV_HUGEPAGE)
+  madvise(mem, size, MADV_HUGEPAGE);
+#endif // !ALLOCATOR_HUGE_PAGES
+  return mem;
+}
+
+// Vsa grows by regions of at least the initial size,
+// so a workload that outgrows it does not map on every allocation
+
+static void *vsa_map_func(void *ctx, size_t min_size, size_t *p_size) {
+  (void)ctx;
+  size_t size = page_align(min_size > g_memory_size ? min_size : g_memory_size);
+  void *mem = memory_map(size);
+  if (NULL == mem) {
+    logf_error("ALLOCATOR", "cannot map region of size %lu\n", size);
+    return NULL;
+  }
+
+  *p_size = size;
+  COUNTER_ADD(g_stats.mapped_bytes, size);
+  return mem;
+}
+
+static void vsa_unmap_func(void *ctx, void *mem, size_t size) {
+  (void)ctx;
+  munmap(mem, size);
+  COUNTER_SUB(g_stats.mapped_bytes, size);
+}
+
+static void vsa_trim_func(void *ctx, void *mem, size_t size) {
+  size_t page_size = (size_t)sysconf(_SC_PAGESIZE);
+  char *begin = (char*)(((size_t)mem + page_size - 1) & ~(page_size - 1));
+  char *end = (char*)(((size_t)mem + size) & ~(page_size - 1));
+  if (begin >= end) return;
+
+  madvise(begin, end - begin, MADV_DONTNEED);
+  *(size_t*)ctx += end - begin;
+}
+
 
 bool allocator_init(size_t size) {
   if (NULL != g_memory) {
@@ -20,60 +545,387 @@ bool allocator_init(size_t size) {
     return false;
   }
 
-  g_memory = calloc(sizeof(char), size);
+  size = page_align(size);
+  g_memory = memory_map(size);
   if (NULL == g_memory) {
     logf_error("ALLOCATOR", "cannot initialize with size of memory %lu\n", size);
     return false;
   }
+  g_memory_size = size;
+  memset(&g_stats, 0, sizeof(g_stats));
+  g_stats.mapped_bytes = size;
 
-  gp_vsa = vsa_init(g_memory, size);
+  vsa_init(&g_vsa, g_memory, size);
+  vsa_set_region_funcs(&g_vsa, vsa_map_func, vsa_unmap_func, NULL);
+  gp_vsa = &g_vsa;
 
   return true;
 }
 
 void allocator_finalize(void) {
+#ifdef ALLOCATOR_THREAD_SAFE
+  if (t_cache.is_registered) {
+    pthread_setspecific(g_cache_key, NULL);
+    cache_release(&t_cache);
+  }
+#endif // !ALLOCATOR_THREAD_SAFE
 #ifdef ALLOCATOR_DUMP_MEMORY_ON_FINALIZE
   vsa_dump(gp_vsa, logf_trace, "VSA_ALLOCATOR");
-  logf_trace("ALLOCATOR", "Number of frees/allocations: %lu / %lu\n", 
-             g_number_of_frees, g_number_of_allocs);
+  AllocatorStats stats;
+  allocator_get_stats(&stats);
+  allocator_log_stats(&stats, logf_trace);
 #endif // !ALLOCATOR_DUMP_MEMORY_ON_FINALIZE
-  free(g_memory);
+#ifdef ALLOCATOR_PROFILER
+  profile_reset();
+#endif // !ALLOCATOR_PROFILER
+  vsa_finalize(gp_vsa);
+  munmap(g_memory, g_memory_size);
   g_memory = NULL;
+  g_memory_size = 0;
+  gp_vsa = NULL;
+}
+
+/// Allocates in the global Vsa, through the thread cache if the block is small
+static void *global_allocate(size_t bytes) {
+#ifdef ALLOCATOR_THREAD_SAFE
+  size_t block_size = cache_block_size(bytes);
+  if (block_size <= CACHE_MAX_BLOCK_SIZE) return cache_allocate(block_size);
+#endif // !ALLOCATOR_THREAD_SAFE
+  VSA_LOCK();
+  void *ptr = vsa_alloc(gp_vsa, bytes);
+  VSA_UNLOCK();
+  return ptr;
 }
 
 void *a_allocate(size_t bytes) {
   assert(NULL != gp_vsa);
-#ifdef ALLOCATOR_DUMP_MEMORY_ON_FINALIZE
-  ++g_number_of_allocs;
-#endif // !ALLOCATOR_DUMP_MEMORY_ON_FINALIZE
-  return vsa_alloc(gp_vsa, bytes);
+  if (NULL != tp_scratch) return scratch_allocate(bytes, sizeof(size_t));
+
+  void *ptr = global_allocate(bytes);
+  stats_on_allocate(ptr);
+  PROFILE_ALLOCATE(ptr);
+  return ptr;
 }
 
 void *a_reallocate(void *ptr, size_t old_size, size_t new_size) {
   assert(NULL != gp_vsa);
-  (void)old_size;
+  if (NULL != tp_scratch && (NULL == ptr || arena_owns(tp_scratch, ptr))) {
+    return scratch_reallocate(ptr, old_size, new_size, sizeof(size_t));
+  }
+  size_t old_block_size = NULL == ptr ? 0 : vsa_usable_size(ptr);
+  VSA_LOCK();
   void *new_ptr = vsa_realloc(gp_vsa, ptr, new_size);
-#ifdef ALLOCATOR_DUMP_MEMORY_ON_FINALIZE
-  bool is_new_memory = new_ptr != ptr;
-  g_number_of_allocs += is_new_memory;
-  g_number_of_frees += is_new_memory;
-#endif // !ALLOCATOR_DUMP_MEMORY_ON_FINALIZE
+  VSA_UNLOCK();
+  stats_on_reallocate(ptr, new_ptr, old_block_size, new_size);
+  PROFILE_REALLOCATE(ptr, new_ptr, new_size);
+  return new_ptr;
+}
+
+void *a_allocate_aligned(size_t bytes, size_t alignment) {
+  assert(NULL != gp_vsa);
+  if (NULL != tp_scratch) return scratch_allocate(bytes, alignment);
+
+  VSA_LOCK();
+  void *ptr = vsa_alloc_aligned(gp_vsa, bytes, alignment);
+  VSA_UNLOCK();
+  stats_on_allocate(ptr);
+  PROFILE_ALLOCATE(ptr);
+  return ptr;
+}
+
+void *a_reallocate_aligned(void *ptr, size_t old_size, size_t new_size, size_t alignment) {
+  assert(NULL != gp_vsa);
+  if (NULL != tp_scratch && (NULL == ptr || arena_owns(tp_scratch, ptr))) {
+    return scratch_reallocate(ptr, old_size, new_size, alignment);
+  }
+  size_t old_block_size = NULL == ptr ? 0 : vsa_usable_size(ptr);
+  VSA_LOCK();
+  void *new_ptr = vsa_realloc_aligned(gp_vsa, ptr, new_size, alignment);
+  VSA_UNLOCK();
+  stats_on_reallocate(ptr, new_ptr, old_block_size, new_size);
+  PROFILE_REALLOCATE(ptr, new_ptr, new_size);
   return new_ptr;
 }
 
 void *a_callocate(size_t nmemb, size_t memb_size) {
   assert(NULL != gp_vsa);
-#ifdef ALLOCATOR_DUMP_MEMORY_ON_FINALIZE
-  ++g_number_of_allocs;
-#endif // !ALLOCATOR_DUMP_MEMORY_ON_FINALIZE
-  return vsa_calloc(gp_vsa, nmemb, memb_size);
+  if (0 != memb_size && nmemb > (size_t)-1 / memb_size) return NULL;
+
+  size_t bytes = nmemb * memb_size;
+  void *ptr = NULL;
+  if (NULL != tp_scratch) {
+    ptr = scratch_allocate(bytes, sizeof(size_t));
+  } else {
+    ptr = global_allocate(bytes);
+    stats_on_allocate(ptr);
+    PROFILE_ALLOCATE(ptr);
+  }
+
+  if (NULL != ptr) memset(ptr, 0, bytes);
+  return ptr;
 }
 
 void a_free(void *ptr) {
   assert(NULL != gp_vsa);
-  vsa_free(ptr);
-#ifdef ALLOCATOR_DUMP_MEMORY_ON_FINALIZE
-  g_number_of_frees += ptr != NULL;
-#endif // !ALLOCATOR_DUMP_MEMORY_ON_FINALIZE
+  if (NULL != tp_scratch && arena_owns(tp_scratch, ptr)) {
+    arena_free(tp_scratch, ptr);
+    return;
+  }
+  if (NULL == ptr) return;
+
+  size_t block_size = vsa_usable_size(ptr);
+  stats_on_free(block_size);
+  PROFILE_FREE(ptr);
+#ifdef ALLOCATOR_THREAD_SAFE
+  if (block_size <= CACHE_MAX_BLOCK_SIZE) {
+    cache_free(ptr, block_size);
+    return;
+  }
+#endif // !ALLOCATOR_THREAD_SAFE
+  VSA_LOCK();
+  vsa_free(gp_vsa, ptr);
+  VSA_UNLOCK();
+}
+
+
+Arena *allocator_set_scratch(Arena *p_arena) {
+  Arena *p_prev = tp_scratch;
+  tp_scratch = p_arena;
+  return p_prev;
+}
+
+
+static void *vsa_allocate_func(void *ctx, size_t bytes) {
+  return vsa_alloc(ctx, bytes);
+}
+
+static void *vsa_reallocate_func(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+  (void)old_size;
+  return vsa_realloc(ctx, ptr, new_size);
+}
+
+static void *vsa_allocate_aligned_func(void *ctx, size_t bytes, size_t alignment) {
+  return vsa_alloc_aligned(ctx, bytes, alignment);
+}
+
+static void vsa_free_func(void *ctx, void *ptr) {
+  vsa_free(ctx, ptr);
+}
+
+Allocator allocator_from_vsa(Vsa *p_vsa) {
+  assert(NULL != p_vsa);
+  return (Allocator){ 
+    .ctx = p_vsa, 
+    .allocate = vsa_allocate_func, 
+    .allocate_aligned = vsa_allocate_aligned_func, 
+    .reallocate = vsa_reallocate_func, 
+    .free = vsa_free_func 
+  };
+}
+
+static void *arena_allocate_func(void *ctx, size_t bytes) {
+  return arena_alloc(ctx, bytes);
+}
+
+static void *arena_reallocate_func(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+  return arena_realloc(ctx, ptr, old_size, new_size);
+}
+
+static void *arena_allocate_aligned_func(void *ctx, size_t bytes, size_t alignment) {
+  return arena_alloc_aligned(ctx, bytes, alignment);
+}
+
+static void arena_free_func(void *ctx, void *ptr) {
+  arena_free(ctx, ptr);
+}
+
+Allocator allocator_from_arena(Arena *p_arena) {
+  assert(NULL != p_arena);
+  return (Allocator){ 
+    .ctx = p_arena, 
+    .allocate = arena_allocate_func, 
+    .allocate_aligned = arena_allocate_aligned_func, 
+    .reallocate = arena_reallocate_func, 
+    .free = arena_free_func 
+  };
+}
+
+static void *pool_allocate_func(void *ctx, size_t bytes) {
+  if (bytes > ((Pool*)ctx)->slot_size) return NULL;
+  return pool_alloc(ctx);
+}
+
+static void *pool_allocate_aligned_func(void *ctx, size_t bytes, size_t alignment) {
+  // slots are only word alligned
+  if (alignment > sizeof(size_t)) return NULL;
+  return pool_allocate_func(ctx, bytes);
+}
+
+static void *pool_reallocate_func(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+  (void)old_size;
+  if (0 == new_size) {
+    pool_free(ctx, ptr);
+    return NULL;
+  }
+  if (new_size > ((Pool*)ctx)->slot_size) return NULL;
+  return NULL == ptr ? pool_alloc(ctx) : ptr;
+}
+
+static void pool_free_func(void *ctx, void *ptr) {
+  pool_free(ctx, ptr);
 }
 
+Allocator allocator_from_pool(Pool *p_pool) {
+  assert(NULL != p_pool);
+  return (Allocator){ 
+    .ctx = p_pool, 
+    .allocate = pool_allocate_func, 
+    .allocate_aligned = pool_allocate_aligned_func, 
+    .reallocate = pool_reallocate_func, 
+    .free = pool_free_func 
+  };
+}
+
+
+void allocator_get_fragmentation(VsaFragmentation *p_frag) {
+  assert(NULL != gp_vsa);
+  VSA_LOCK();
+  vsa_get_fragmentation(gp_vsa, p_frag);
+  VSA_UNLOCK();
+}
+
+void allocator_get_realloc_counts(size_t *p_in_place, size_t *p_moved) {
+  assert(NULL != gp_vsa);
+  VSA_LOCK();
+  *p_in_place = gp_vsa->reallocs_in_place;
+  *p_moved = gp_vsa->reallocs_moved;
+  VSA_UNLOCK();
+}
+
+size_t allocator_trim(void) {
+  assert(NULL != gp_vsa);
+  size_t released = 0;
+#ifdef ALLOCATOR_THREAD_SAFE
+  cache_flush_all(&t_cache);
+#endif // !ALLOCATOR_THREAD_SAFE
+  VSA_LOCK();
+  vsa_walk_free_blocks(gp_vsa, vsa_trim_func, &released);
+  VSA_UNLOCK();
+  return released;
+}
+
+
+size_t allocator_stats_class_max_size(size_t class_index) {
+  assert(class_index < ALLOCATOR_STATS_CLASS_COUNT);
+  if (ALLOCATOR_STATS_CLASS_COUNT - 1 == class_index) return (size_t)-1;
+  return (size_t)ALLOCATOR_STATS_CLASS_MIN_SIZE << class_index;
+}
+
+void allocator_get_stats(AllocatorStats *p_stats) {
+  assert(NULL != gp_vsa);
+  assert(NULL != p_stats);
+
+#ifdef ALLOCATOR_THREAD_SAFE
+  // running threads hold bytes in use they have not added to g_stats yet,
+  // the one furthest below its recent high adds that distance to the peak
+  pthread_mutex_lock(&g_stats_lock);
+  StatsCounters counters = g_stats.counters;
+  ptrdiff_t in_use_delta = 0;
+  ptrdiff_t peak_distance = 0;
+  for (ThreadCache *p_cache = gp_caches; NULL != p_cache; p_cache = p_cache->p_next) {
+    stats_counters_add(&counters, &p_cache->counters);
+    ptrdiff_t delta = __atomic_load_n(&p_cache->in_use_delta, __ATOMIC_RELAXED);
+    ptrdiff_t delta_peak = __atomic_load_n(&p_cache->in_use_delta_peak, __ATOMIC_RELAXED);
+    in_use_delta += delta;
+    if (delta_peak - delta > peak_distance) peak_distance = delta_peak - delta;
+  }
+  ptrdiff_t in_use = (ptrdiff_t)g_stats.bytes_in_use + in_use_delta;
+  if (in_use < 0) in_use = 0;
+  if (in_use + peak_distance > (ptrdiff_t)g_stats.peak_bytes_in_use) {
+    g_stats.peak_bytes_in_use = in_use + peak_distance;
+  }
+  p_stats->bytes_in_use = in_use;
+  p_stats->peak_bytes_in_use = g_stats.peak_bytes_in_use;
+  pthread_mutex_unlock(&g_stats_lock);
+#else
+  StatsCounters counters = g_stats.counters;
+  p_stats->bytes_in_use = g_stats.bytes_in_use;
+  p_stats->peak_bytes_in_use = g_stats.peak_bytes_in_use;
+#endif // !ALLOCATOR_THREAD_SAFE
+
+  p_stats->allocs_count = 0;
+  p_stats->frees_count = 0;
+  p_stats->reallocs_count = 0;
+  for (size_t i = 0; i < ALLOCATOR_STATS_CLASS_COUNT; ++i) {
+    p_stats->allocs[i] = counters.allocs[i];
+    p_stats->frees[i] = counters.frees[i];
+    p_stats->reallocs[i] = counters.reallocs[i];
+    p_stats->allocs_count += p_stats->allocs[i];
+    p_stats->frees_count += p_stats->frees[i];
+    p_stats->reallocs_count += p_stats->reallocs[i];
+  }
+  p_stats->realloc_copy_bytes = counters.realloc_copy_bytes;
+
+  VSA_LOCK();
+  p_stats->mapped_bytes = g_stats.mapped_bytes;
+  vsa_get_fragmentation(gp_vsa, &p_stats->fragmentation);
+  p_stats->reallocs_in_place = gp_vsa->reallocs_in_place;
+  p_stats->reallocs_moved = gp_vsa->reallocs_moved;
+  VSA_UNLOCK();
+}
+
+void allocator_log_stats(const AllocatorStats *p_stats, DumpPrinter printer) {
+  assert(NULL != p_stats);
+  assert(NULL != printer);
+
+  printer("ALLOCATOR", "in use: %lu, peak: %lu, mapped: %lu\n",
+          p_stats->bytes_in_use, p_stats->peak_bytes_in_use, p_stats->mapped_bytes);
+  printer("ALLOCATOR", "free: %lu in %lu blocks, largest: %lu\n",
+          p_stats->fragmentation.free_bytes, p_stats->fragmentation.free_blocks_count,
+          p_stats->fragmentation.largest_free_block);
+  printer("ALLOCATOR", "Number of frees/allocations: %lu / %lu\n",
+          p_stats->frees_count, p_stats->allocs_count);
+  printer("ALLOCATOR", "Number of in place/moved reallocations: %lu / %lu, copied bytes: %lu\n",
+          p_stats->reallocs_in_place, p_stats->reallocs_moved, p_stats->realloc_copy_bytes);
+
+  for (size_t i = 0; i < ALLOCATOR_STATS_CLASS_COUNT; ++i) {
+    if (0 == p_stats->allocs[i] && 0 == p_stats->reallocs[i]) continue;
+    printer("ALLOCATOR", "class <= %lu: allocs %lu, frees %lu, reallocs %lu\n",
+            allocator_stats_class_max_size(i), 
+            p_stats->allocs[i], p_stats->frees[i], p_stats->reallocs[i]);
+  }
+}
+
+
+#ifdef ALLOCATOR_PROFILER
+void allocator_profiler_set_sample_interval(size_t bytes) {
+  __atomic_store_n(&g_profile_sample_interval, bytes, __ATOMIC_RELAXED);
+}
+
+const char *allocator_profiler_set_tag(const char *tag) {
+  const char *prev_tag = tp_profile_tag;
+  tp_profile_tag = tag;
+  return prev_tag;
+}
+
+size_t allocator_profiler_get_sites(AllocatorProfileSite *p_sites, size_t count,
+                                    size_t *p_dropped_samples) {
+  assert(NULL != p_sites || 0 == count);
+
+  size_t sites_count = 0;
+  PROFILE_LOCK();
+  for (size_t i = 0; i < ALLOCATOR_PROFILE_SITE_COUNT; ++i) {
+    if (0 == g_profile_sites[i].sampled_count) continue;
+    if (sites_count < count) p_sites[sites_count] = g_profile_sites[i];
+    ++sites_count;
+  }
+  if (NULL != p_dropped_samples) *p_dropped_samples = g_profile_dropped_samples;
+  PROFILE_UNLOCK();
+
+  return sites_count;
+}
+
+void allocator_profiler_reset(void) {
+  profile_reset();
+}
+#endif // !ALLOCATOR_PROFILER
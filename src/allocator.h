@@ -4,6 +4,26 @@
 #include <stddef.h>
 #include <stdbool.h>
 
+#include "vsa.h"
+#include "arena.h"
+#include "pool.h"
+
+/// Global allocator on top of a Vsa.
+///
+/// Build with ALLOCATOR_THREAD_SAFE defined to use it from several threads:
+///   blocks up to 256 bytes are then served from per thread caches
+///   that exchange blocks with the shared Vsa in batches under a lock,
+///   bigger blocks go to the shared Vsa directly.
+///   All allocations and frees over 256 bytes, all a_reallocate calls and
+///   aligned allocations still take the single Vsa lock, so they serialize
+///   across threads; bench/allocator.bench.c measures how it scales.
+///   A block may be freed by any thread. allocator_finalize has to be called
+///   after all other threads using the allocator have exited.
+///
+/// Memory is mapped from the system. When the initial size is exhausted
+///   the Vsa grows by mapping more regions, regions that become free are unmapped.
+///   Build with ALLOCATOR_HUGE_PAGES defined to request transparent huge pages.
+
 bool allocator_init(size_t size);
 void allocator_finalize(void);
 void *a_allocate(size_t bytes);
@@ -11,4 +31,178 @@ void *a_reallocate(void *ptr, size_t old_size, size_t new_size);
 void *a_callocate(size_t nmemb, size_t memb_size);
 void a_free(void *ptr);
 
+/// Allocates @bytes at an address that is a multiple of @alignment,
+///   @alignment has to be a power of two. The memory is freed by a_free.
+void *a_allocate_aligned(size_t bytes, size_t alignment);
+
+/// Reallocates memory from a_allocate_aligned keeping its @alignment
+void *a_reallocate_aligned(void *ptr, size_t old_size, size_t new_size, size_t alignment);
+
+/// Routes allocations of the calling thread to @p_arena
+///   until it is called again with another arena or NULL.
+/// While an arena is set, a_allocate and a_callocate allocate in the arena,
+///   a_reallocate and a_free work on the arena if it owns the pointer
+///   and on the global Vsa otherwise, so containers created in the scope
+///   land in the arena and are released with it by arena_reset,
+///   while containers created before keep living in the Vsa.
+/// Memory of the arena must not be passed to a_* after it is unset.
+///
+/// @param p_arena: arena to allocate from or NULL to use the global Vsa again
+/// @return Arena*, previously set arena (NULL if none) to restore nested scopes
+Arena *allocator_set_scratch(Arena *p_arena);
+
+typedef void *(*AllocateFunc)(void *ctx, size_t bytes);
+typedef void *(*AllocateAlignedFunc)(void *ctx, size_t bytes, size_t alignment);
+typedef void *(*ReallocateFunc)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+typedef void (*FreeFunc)(void *ctx, void *ptr);
+
+/// Allocator handle containers can carry to allocate somewhere else
+///   than the global allocator.
+/// Containers keep a pointer to the handle, so it has to outlive them.
+/// NULL handle stands for the global allocator and is dispatched
+///   to a_* directly, without an indirect call.
+typedef struct {
+  /// Allocator state passed to the functions, e.g. Vsa*, Arena*, Pool*
+  void *ctx;
+
+  AllocateFunc allocate;
+  AllocateAlignedFunc allocate_aligned;
+  ReallocateFunc reallocate;
+  FreeFunc free;
+} Allocator;
+
+static inline void *allocator_allocate(const Allocator *p_allocator, size_t bytes) {
+  if (NULL == p_allocator) return a_allocate(bytes);
+  return p_allocator->allocate(p_allocator->ctx, bytes);
+}
+
+/// Memory is freed by allocator_free
+static inline void *allocator_allocate_aligned(const Allocator *p_allocator, 
+                                               size_t bytes, size_t alignment) {
+  if (NULL == p_allocator) return a_allocate_aligned(bytes, alignment);
+  return p_allocator->allocate_aligned(p_allocator->ctx, bytes, alignment);
+}
+
+static inline void *allocator_reallocate(const Allocator *p_allocator, void *ptr,
+                                         size_t old_size, size_t new_size) {
+  if (NULL == p_allocator) return a_reallocate(ptr, old_size, new_size);
+  return p_allocator->reallocate(p_allocator->ctx, ptr, old_size, new_size);
+}
+
+static inline void allocator_free(const Allocator *p_allocator, void *ptr) {
+  if (NULL == p_allocator) {
+    a_free(ptr);
+    return;
+  }
+  p_allocator->free(p_allocator->ctx, ptr);
+}
+
+/// Handle for a Vsa of its own, e.g. for long lived data
+Allocator allocator_from_vsa(Vsa *p_vsa);
+
+/// Handle for an arena, memory is released by arena_reset
+Allocator allocator_from_arena(Arena *p_arena);
+
+/// Handle for a pool, allocations must fit in the slot size of the pool
+Allocator allocator_from_pool(Pool *p_pool);
+
+/// Reports how fragmented free memory of the global allocator is
+void allocator_get_fragmentation(VsaFragmentation *p_frag);
+
+/// Reports how many reallocations of the global allocator were done in place
+///   and how many had to move data to a new block
+void allocator_get_realloc_counts(size_t *p_in_place, size_t *p_moved);
+
+/// Size classes of AllocatorStats: class 0 holds blocks up to 16 bytes,
+///   every next class doubles the size, the last one holds all bigger blocks
+#define ALLOCATOR_STATS_CLASS_COUNT 16
+#define ALLOCATOR_STATS_CLASS_MIN_SIZE 16
+
+/// Snapshot of the global allocator.
+/// Sizes are usable sizes of blocks, allocations routed to the scratch arena
+///   are not counted. Counters are updated on every call, so they can be
+///   read periodically while the program runs.
+/// With ALLOCATOR_THREAD_SAFE every thread counts in its own cache and
+///   adds bytes in use to the shared total in steps of up to 64 KiB,
+///   so the peak of several threads is an estimate within 64 KiB per thread.
+typedef struct {
+  size_t bytes_in_use;
+  size_t peak_bytes_in_use;
+
+  /// Memory mapped from the system, including free blocks
+  size_t mapped_bytes;
+
+  VsaFragmentation fragmentation;
+
+  size_t allocs_count;
+  size_t frees_count;
+  size_t reallocs_count;
+
+  /// Counts by size class of the block, see allocator_stats_class_max_size
+  size_t allocs[ALLOCATOR_STATS_CLASS_COUNT];
+  size_t frees[ALLOCATOR_STATS_CLASS_COUNT];
+  size_t reallocs[ALLOCATOR_STATS_CLASS_COUNT];
+
+  size_t reallocs_in_place;
+  size_t reallocs_moved;
+
+  /// Bytes copied by reallocations that moved the data
+  size_t realloc_copy_bytes;
+} AllocatorStats;
+
+/// Returns the biggest block size counted in the class, SIZE_MAX for the last one
+size_t allocator_stats_class_max_size(size_t class_index);
+
+/// Takes a snapshot of statistics of the global allocator
+void allocator_get_stats(AllocatorStats *p_stats);
+
+/// Prints @p_stats by @printer, e.g. logf_info
+void allocator_log_stats(const AllocatorStats *p_stats, DumpPrinter printer);
+
+#ifdef ALLOCATOR_PROFILER
+/// Maximum number of distinct (tag, call site) pairs the profiler records
+#define ALLOCATOR_PROFILE_SITE_COUNT 256
+
+/// Allocations sampled at one call site with one tag
+typedef struct {
+  /// Tag set by allocator_profiler_set_tag when the allocation was sampled
+  const char *tag;
+
+  /// Return address of the a_* call
+  void *call_site;
+
+  size_t sampled_count;
+
+  /// Bytes allocated at the site estimated from samples
+  size_t estimated_bytes;
+
+  /// Part of estimated_bytes that is not freed yet
+  size_t estimated_live_bytes;
+} AllocatorProfileSite;
+
+/// Samples about one allocation per @bytes allocated by a thread,
+///   0 turns sampling off (default)
+void allocator_profiler_set_sample_interval(size_t bytes);
+
+/// Tags allocations of the calling thread, e.g. by a subsystem name.
+/// @tag has to be a string literal or outlive the profile.
+/// @return const char*, previous tag to restore nested scopes
+const char *allocator_profiler_set_tag(const char *tag);
+
+/// Copies up to @count recorded sites to @p_sites
+/// @param p_dropped_samples: if not NULL, receives the number of samples
+///   not recorded because the site table was full
+/// @return size_t, number of recorded sites, may be more than @count
+size_t allocator_profiler_get_sites(AllocatorProfileSite *p_sites, size_t count,
+                                    size_t *p_dropped_samples);
+
+/// Forgets all samples
+void allocator_profiler_reset(void);
+#endif // !ALLOCATOR_PROFILER
+
+/// Gives pages inside free blocks back to the system,
+///   they are mapped again on first access
+/// @return size_t, number of bytes released
+size_t allocator_trim(void);
+
 #endif // !__ALOCATOR_H__
@@ -0,0 +1,221 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "allocator.h"
+#include "logger.h"
+
+#ifdef ALLOCATOR_THREAD_SAFE
+#include <pthread.h>
+#endif // !ALLOCATOR_THREAD_SAFE
+
+void init_allocator() {
+  size_t allocator_size = 4lu * 1024lu * 1024lu; // 4 MiB
+  if (!allocator_init(allocator_size)) {
+    abort();
+  }
+}
+
+LogSeverity g_log_severity = LOG_ALL;
+
+void test_stats() {
+  AllocatorStats stats;
+  allocator_get_stats(&stats);
+  assert(0 == stats.bytes_in_use);
+  assert(stats.mapped_bytes >= 4lu * 1024lu * 1024lu);
+
+  void *small = a_allocate(10);
+  void *big = a_allocate(1000);
+  allocator_get_stats(&stats);
+  assert(2 == stats.allocs_count);
+  assert(1 == stats.allocs[1]);
+  assert(1 == stats.allocs[6]);
+  assert(stats.bytes_in_use >= 1010);
+  size_t peak = stats.bytes_in_use;
+
+  big = a_reallocate(big, 1000, 100);
+  allocator_get_stats(&stats);
+  assert(1 == stats.reallocs_count);
+  assert(1 == stats.reallocs[3]);
+  assert(stats.bytes_in_use < peak);
+  assert(peak == stats.peak_bytes_in_use);
+
+  // a block after the grown one is taken, so its data is copied
+  void *blocker = a_allocate(1000);
+  big = a_reallocate(big, 100, 200);
+  allocator_get_stats(&stats);
+  assert(stats.realloc_copy_bytes >= 100);
+
+  a_free(small);
+  a_free(big);
+  a_free(blocker);
+  allocator_get_stats(&stats);
+  assert(0 == stats.bytes_in_use);
+  assert(stats.allocs_count == stats.frees_count);
+  allocator_log_stats(&stats, logf_info);
+}
+
+#ifdef ALLOCATOR_PROFILER
+void test_profiler() {
+  allocator_profiler_set_sample_interval(1024);
+
+  const char *prev_tag = allocator_profiler_set_tag("test");
+  void *ptrs[256];
+  for (size_t i = 0; i < 256; ++i) ptrs[i] = a_allocate(64);
+  allocator_profiler_set_tag(prev_tag);
+
+  AllocatorProfileSite sites[4];
+  size_t sites_count = allocator_profiler_get_sites(sites, 4, NULL);
+  assert(1 == sites_count);
+  assert(0 == strcmp("test", sites[0].tag));
+  assert(0 < sites[0].sampled_count);
+  assert(0 < sites[0].estimated_live_bytes);
+
+  for (size_t i = 0; i < 256; ++i) a_free(ptrs[i]);
+  allocator_profiler_get_sites(sites, 4, NULL);
+  assert(0 == sites[0].estimated_live_bytes);
+
+  allocator_profiler_set_sample_interval(0);
+  allocator_profiler_reset();
+}
+#endif // !ALLOCATOR_PROFILER
+
+#ifdef ALLOCATOR_THREAD_SAFE
+#define STRESS_THREADS_COUNT 4
+#define STRESS_BLOCKS_COUNT 512
+#define STRESS_ROUNDS_COUNT 200
+
+/// Blocks a thread hands over to the next thread, which checks and frees them
+typedef struct {
+  pthread_mutex_t lock;
+  unsigned char *blocks[STRESS_BLOCKS_COUNT];
+  size_t sizes[STRESS_BLOCKS_COUNT];
+  size_t count;
+} StressMailbox;
+
+typedef struct {
+  size_t index;
+  StressMailbox *mailboxes;
+  bool is_corrupted;
+} StressCtx;
+
+static size_t stress_random(size_t *p_state) {
+  *p_state ^= *p_state << 13;
+  *p_state ^= *p_state >> 7;
+  *p_state ^= *p_state << 17;
+  return *p_state;
+}
+
+static bool stress_check(const unsigned char *block, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    if ((unsigned char)(size + i) != block[i]) return false;
+  }
+  return true;
+}
+
+static void *stress_thread(void *arg) {
+  StressCtx *p_ctx = arg;
+  StressMailbox *p_own = &p_ctx->mailboxes[p_ctx->index];
+  StressMailbox *p_next = &p_ctx->mailboxes[(p_ctx->index + 1) % STRESS_THREADS_COUNT];
+  size_t state = 0x9E3779B97F4A7C15ull * (p_ctx->index + 1);
+
+  unsigned char *blocks[STRESS_BLOCKS_COUNT];
+  size_t sizes[STRESS_BLOCKS_COUNT];
+  for (size_t round = 0; round < STRESS_ROUNDS_COUNT; ++round) {
+    // mostly cached small blocks, some go to the shared Vsa and some are reallocated
+    for (size_t i = 0; i < STRESS_BLOCKS_COUNT; ++i) {
+      size_t size = 0 == i % 16 ? 300 + stress_random(&state) % 2000
+                                : 1 + stress_random(&state) % 256;
+      blocks[i] = a_allocate(size);
+      if (0 == i % 7) {
+        size_t new_size = 1 + stress_random(&state) % 512;
+        blocks[i] = a_reallocate(blocks[i], size, new_size);
+        size = new_size;
+      }
+      sizes[i] = size;
+      for (size_t j = 0; j < size; ++j) blocks[i][j] = (unsigned char)(size + j);
+    }
+
+    // every other block is freed by the next thread
+    pthread_mutex_lock(&p_next->lock);
+    for (size_t i = 0; i < STRESS_BLOCKS_COUNT; i += 2) {
+      if (STRESS_BLOCKS_COUNT == p_next->count) break;
+      p_next->blocks[p_next->count] = blocks[i];
+      p_next->sizes[p_next->count++] = sizes[i];
+      blocks[i] = NULL;
+    }
+    pthread_mutex_unlock(&p_next->lock);
+
+    for (size_t i = 0; i < STRESS_BLOCKS_COUNT; ++i) {
+      if (NULL == blocks[i]) continue;
+      if (!stress_check(blocks[i], sizes[i])) p_ctx->is_corrupted = true;
+      a_free(blocks[i]);
+    }
+
+    pthread_mutex_lock(&p_own->lock);
+    for (size_t i = 0; i < p_own->count; ++i) {
+      if (!stress_check(p_own->blocks[i], p_own->sizes[i])) p_ctx->is_corrupted = true;
+      a_free(p_own->blocks[i]);
+    }
+    p_own->count = 0;
+    pthread_mutex_unlock(&p_own->lock);
+  }
+
+  return NULL;
+}
+
+void test_threads() {
+  AllocatorStats before;
+  allocator_get_stats(&before);
+
+  static StressMailbox mailboxes[STRESS_THREADS_COUNT];
+  StressCtx ctxs[STRESS_THREADS_COUNT];
+  pthread_t threads[STRESS_THREADS_COUNT];
+  for (size_t i = 0; i < STRESS_THREADS_COUNT; ++i) {
+    pthread_mutex_init(&mailboxes[i].lock, NULL);
+    mailboxes[i].count = 0;
+    ctxs[i] = (StressCtx){ .index = i, .mailboxes = mailboxes };
+  }
+  for (size_t i = 0; i < STRESS_THREADS_COUNT; ++i) {
+    assert(0 == pthread_create(&threads[i], NULL, stress_thread, &ctxs[i]));
+  }
+  for (size_t i = 0; i < STRESS_THREADS_COUNT; ++i) pthread_join(threads[i], NULL);
+
+  // blocks left in mailboxes of threads that finished first
+  for (size_t i = 0; i < STRESS_THREADS_COUNT; ++i) {
+    assert(!ctxs[i].is_corrupted);
+    for (size_t j = 0; j < mailboxes[i].count; ++j) {
+      assert(stress_check(mailboxes[i].blocks[j], mailboxes[i].sizes[j]));
+      a_free(mailboxes[i].blocks[j]);
+    }
+    pthread_mutex_destroy(&mailboxes[i].lock);
+  }
+
+  // caches of exited threads are back in the Vsa, this thread's cache is flushed by trim
+  AllocatorStats after;
+  allocator_trim();
+  allocator_get_stats(&after);
+  assert(before.bytes_in_use == after.bytes_in_use);
+  // counters of exited threads are kept
+  assert(after.allocs_count - before.allocs_count
+         >= STRESS_THREADS_COUNT * STRESS_ROUNDS_COUNT * STRESS_BLOCKS_COUNT);
+  assert(after.allocs_count - before.allocs_count == after.frees_count - before.frees_count);
+  assert(after.peak_bytes_in_use > before.peak_bytes_in_use);
+  assert(1 == after.fragmentation.free_blocks_count);
+}
+#endif // !ALLOCATOR_THREAD_SAFE
+
+int main() {
+  init_allocator();
+  atexit(allocator_finalize);
+
+  test_stats();
+#ifdef ALLOCATOR_THREAD_SAFE
+  test_threads();
+#endif // !ALLOCATOR_THREAD_SAFE
+#ifdef ALLOCATOR_PROFILER
+  test_profiler();
+#endif // !ALLOCATOR_PROFILER
+
+  return 0;
+}
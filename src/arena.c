@@ -0,0 +1,161 @@
+#include <assert.h>
+#include <string.h>
+
+#include "arena.h"
+#include "allocator.h"
+
+#define WORD_SIZE (sizeof(size_t))
+
+typedef struct {
+  /// Older chunk
+  void *p_prev;
+
+  /// End of this chunk
+  char *p_end;
+} ArenaChunk;
+
+#define CHUNK_GET_DATA(chunk) ((char*)(chunk) + sizeof(ArenaChunk))
+
+static size_t size_align(size_t size) {
+  return (size + WORD_SIZE - 1) & ~(WORD_SIZE - 1);
+}
+
+/// Frees chunks newer than @p_keep, makes @p_keep the newest one
+static void arena_pop_chunks(Arena *p_arena, void *p_keep) {
+  while (p_arena->chunks != p_keep) {
+    ArenaChunk *p_chunk = p_arena->chunks;
+    assert(NULL != p_chunk);
+    p_arena->chunks = p_chunk->p_prev;
+    a_free(p_chunk);
+  }
+
+  ArenaChunk *p_chunk = p_arena->chunks;
+  p_arena->p_top = NULL == p_chunk ? NULL : CHUNK_GET_DATA(p_chunk);
+  p_arena->p_end = NULL == p_chunk ? NULL : p_chunk->p_end;
+  p_arena->p_last = NULL;
+}
+
+void arena_init(Arena *p_arena, size_t chunk_size) {
+  assert(NULL != p_arena);
+
+  p_arena->chunk_size = 0 == chunk_size ? ARENA_DEFAULT_CHUNK_SIZE : chunk_size;
+  p_arena->chunks = NULL;
+  p_arena->p_top = NULL;
+  p_arena->p_end = NULL;
+  p_arena->p_last = NULL;
+}
+
+void arena_finalize(Arena *p_arena) {
+  assert(NULL != p_arena);
+  arena_pop_chunks(p_arena, NULL);
+}
+
+void *arena_alloc(Arena *p_arena, size_t bytes) {
+  return arena_alloc_aligned(p_arena, bytes, WORD_SIZE);
+}
+
+void *arena_alloc_aligned(Arena *p_arena, size_t bytes, size_t alignment) {
+  assert(NULL != p_arena);
+  assert(0 != alignment && 0 == (alignment & (alignment - 1)) 
+         && "Alignment should be a power of two.");
+
+  if (alignment < WORD_SIZE) alignment = WORD_SIZE;
+  bytes = size_align(bytes);
+
+  char *p_top = (char*)(((size_t)p_arena->p_top + alignment - 1) & ~(alignment - 1));
+  if (NULL == p_arena->p_top || p_top > p_arena->p_end 
+      || (size_t)(p_arena->p_end - p_top) < bytes) {
+    size_t data_size = bytes + alignment - WORD_SIZE;
+    if (data_size < p_arena->chunk_size) data_size = p_arena->chunk_size;
+
+    ArenaChunk *p_chunk = a_allocate(sizeof(ArenaChunk) + data_size);
+    if (NULL == p_chunk) return NULL;
+
+    p_chunk->p_prev = p_arena->chunks;
+    p_chunk->p_end = CHUNK_GET_DATA(p_chunk) + data_size;
+    p_arena->chunks = p_chunk;
+    p_arena->p_end = p_chunk->p_end;
+    p_top = (char*)(((size_t)CHUNK_GET_DATA(p_chunk) + alignment - 1) & ~(alignment - 1));
+  }
+
+  p_arena->p_last = p_top;
+  p_arena->p_top = p_top + bytes;
+  return p_top;
+}
+
+void *arena_realloc(Arena *p_arena, void *ptr, size_t old_size, size_t new_size) {
+  return arena_realloc_aligned(p_arena, ptr, old_size, new_size, WORD_SIZE);
+}
+
+void *arena_realloc_aligned(Arena *p_arena, void *ptr, size_t old_size, size_t new_size,
+                            size_t alignment) {
+  assert(NULL != p_arena);
+
+  if (NULL == ptr) return arena_alloc_aligned(p_arena, new_size, alignment);
+
+  if (0 == new_size) {
+    arena_free(p_arena, ptr);
+    return NULL;
+  }
+
+  if (ptr == p_arena->p_last 
+      && size_align(new_size) <= (size_t)(p_arena->p_end - p_arena->p_last)) {
+    p_arena->p_top = p_arena->p_last + size_align(new_size);
+    return ptr;
+  }
+
+  void *allocated = arena_alloc_aligned(p_arena, new_size, alignment);
+  if (NULL == allocated) return NULL;
+
+  memcpy(allocated, ptr, old_size < new_size ? old_size : new_size);
+  return allocated;
+}
+
+void arena_free(Arena *p_arena, void *ptr) {
+  assert(NULL != p_arena);
+
+  if (NULL != ptr && ptr == p_arena->p_last) {
+    p_arena->p_top = p_arena->p_last;
+    p_arena->p_last = NULL;
+  }
+}
+
+ArenaMark arena_mark(const Arena *p_arena) {
+  assert(NULL != p_arena);
+  return (ArenaMark){ .chunk = p_arena->chunks, .p_top = p_arena->p_top };
+}
+
+void arena_reset_to_mark(Arena *p_arena, ArenaMark mark) {
+  assert(NULL != p_arena);
+
+  if (NULL == mark.chunk) {
+    arena_reset(p_arena);
+    return;
+  }
+
+  arena_pop_chunks(p_arena, mark.chunk);
+  p_arena->p_top = mark.p_top;
+}
+
+void arena_reset(Arena *p_arena) {
+  assert(NULL != p_arena);
+
+  ArenaChunk *p_oldest = p_arena->chunks;
+  while (NULL != p_oldest && NULL != p_oldest->p_prev) {
+    p_oldest = p_oldest->p_prev;
+  }
+
+  arena_pop_chunks(p_arena, p_oldest);
+}
+
+bool arena_owns(const Arena *p_arena, const void *ptr) {
+  assert(NULL != p_arena);
+
+  for (const ArenaChunk *p_chunk = p_arena->chunks; NULL != p_chunk; p_chunk = p_chunk->p_prev) {
+    if ((const char*)ptr >= CHUNK_GET_DATA(p_chunk) && (const char*)ptr < p_chunk->p_end) {
+      return true;
+    }
+  }
+
+  return false;
+}
@@ -0,0 +1,84 @@
+#ifndef __ARENA_H__
+#define __ARENA_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define ARENA_DEFAULT_CHUNK_SIZE (64lu * 1024lu)
+
+/// Linear (bump) allocator.
+/// Allocations are carved one after another from chunks requested
+///   from the global allocator, they are released all at once by
+///   arena_reset or arena_reset_to_mark.
+/// The most recent allocation can be grown, shrunk or freed in place.
+typedef struct {
+  /// Minimal size of a chunk requested from the allocator
+  size_t chunk_size;
+
+  /// Newest chunk, chunks are linked to the older ones
+  void *chunks;
+
+  /// Next free byte and end of the newest chunk
+  char *p_top;
+  char *p_end;
+
+  /// Most recent allocation
+  char *p_last;
+} Arena;
+
+/// State of an arena that can be restored by arena_reset_to_mark
+typedef struct {
+  void *chunk;
+  char *p_top;
+} ArenaMark;
+
+
+/// Initializes an empty arena, no memory is allocated until the first arena_alloc
+///
+/// @param p_arena: pointer to the arena to be initialized
+/// @param chunk_size: minimal size of chunks requested from the allocator,
+///   ARENA_DEFAULT_CHUNK_SIZE is used if 0 is passed
+/// @return void
+void arena_init(Arena *p_arena, size_t chunk_size);
+
+/// Frees all chunks of the arena, all allocations become invalid
+void arena_finalize(Arena *p_arena);
+
+/// Allocates @bytes (word alligned) on top of the arena
+///
+/// @return void*, NULL if the allocator is out of memory
+void *arena_alloc(Arena *p_arena, size_t bytes);
+
+/// Allocates @bytes on top of the arena at a multiple of @alignment (a power of two)
+void *arena_alloc_aligned(Arena *p_arena, size_t bytes, size_t alignment);
+
+/// Resizes the allocation pointed by @ptr.
+/// The most recent allocation is resized in place if it fits in its chunk,
+///   any other is copied to a new allocation on top of the arena.
+/// If @ptr is NULL, call has the same effect as arena_alloc(p_arena, new_size).
+/// If @new_size is 0, call has the same effect as arena_free(p_arena, ptr)
+///   and returns NULL.
+void *arena_realloc(Arena *p_arena, void *ptr, size_t old_size, size_t new_size);
+
+/// Resizes the allocation made by arena_alloc_aligned with the same @alignment
+/// @see arena_realloc
+void *arena_realloc_aligned(Arena *p_arena, void *ptr, size_t old_size, size_t new_size,
+                            size_t alignment);
+
+/// Releases memory of @ptr if it is the most recent allocation,
+///   otherwise it is released by the next reset
+void arena_free(Arena *p_arena, void *ptr);
+
+/// Returns current state of the arena
+ArenaMark arena_mark(const Arena *p_arena);
+
+/// Releases everything allocated after @mark was taken
+void arena_reset_to_mark(Arena *p_arena, ArenaMark mark);
+
+/// Releases all allocations, the oldest chunk is kept for reuse
+void arena_reset(Arena *p_arena);
+
+/// Checks if @ptr points into memory of the arena
+bool arena_owns(const Arena *p_arena, const void *ptr);
+
+#endif // !__ARENA_H__
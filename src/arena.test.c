@@ -0,0 +1,163 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "allocator.h"
+#include "logger.h"
+#include "vec.h"
+#include "table.h"
+#include "string_builder.h"
+
+void init_allocator() {
+  size_t allocator_size = 4lu * 1024lu * 1024lu; // 4 MiB
+  if (!allocator_init(allocator_size)) {
+    abort();
+  }
+}
+
+void test_bump(void) {
+  Arena arena;
+  arena_init(&arena, 256);
+
+  char *a = arena_alloc(&arena, 10);
+  char *b = arena_alloc(&arena, 10);
+  assert(NULL != a && NULL != b);
+  assert(b >= a + 10);
+  assert(arena_owns(&arena, a) && arena_owns(&arena, b));
+
+  // the top allocation grows in place
+  char *grown = arena_realloc(&arena, b, 10, 100);
+  assert(grown == b);
+
+  // an older one is copied
+  memcpy(a, "arena", 6);
+  char *moved = arena_realloc(&arena, a, 10, 20);
+  assert(moved != a);
+  assert(0 == strcmp(moved, "arena"));
+
+  char *aligned = arena_alloc_aligned(&arena, 10, 64);
+  assert(NULL != aligned && 0 == (size_t)aligned % 64);
+
+  // bigger than a chunk
+  char *big = arena_alloc(&arena, 1000);
+  assert(NULL != big);
+  memset(big, 1, 1000);
+
+  // the chunk of big is full, allocations after the mark take new chunks
+  ArenaMark mark = arena_mark(&arena);
+  char *small = arena_alloc(&arena, 8);
+  char *large = arena_alloc(&arena, 300);
+  assert(arena_owns(&arena, small) && arena_owns(&arena, large));
+  arena_reset_to_mark(&arena, mark);
+  assert(!arena_owns(&arena, small) && !arena_owns(&arena, large));
+  assert(arena_owns(&arena, big));
+
+  arena_reset(&arena);
+  assert(arena_alloc(&arena, 8) == a);
+
+  arena_finalize(&arena);
+  assert(NULL == arena.chunks);
+}
+
+void test_scratch(void) {
+#ifndef ALLOCATOR_THREAD_SAFE
+  VsaFragmentation before;
+  allocator_get_fragmentation(&before);
+#endif // !ALLOCATOR_THREAD_SAFE
+
+  vec(int) long_lived;
+  vec_alloc(long_lived);
+
+  Arena arena;
+  arena_init(&arena, 0);
+  Arena *p_prev = allocator_set_scratch(&arena);
+  assert(NULL == p_prev);
+
+  vec(int) v;
+  vec_alloc(v);
+  for (int i = 0; i < 1000; ++i) {
+    vec_push(v, i);
+    vec_push(long_lived, i);
+  }
+  assert(arena_owns(&arena, vec_get_header(v)));
+  assert(!arena_owns(&arena, vec_get_header(long_lived)));
+
+  StringBuilder sb;
+  string_builder_init(sb);
+  string_builder_append_cstr(&sb, "scratch");
+  assert(arena_owns(&arena, string_builder_get_cstr(&sb)));
+
+  // a table allocates its entries array once it outgrows the inline entries
+  Table table;
+  table_init(&table, hash_cstr_default, key_cmp_default, NULL);
+  const char *keys[] = {"a", "b", "c", "d", "e", "f", "g", "h", "i", "j"};
+  for (size_t i = 0; i < sizeof(keys) / sizeof(*keys); ++i) {
+    table_set(&table, keys[i], "value");
+  }
+  assert(arena_owns(&arena, table.entries));
+
+  // freeing scratch memory is optional
+  vec_free(v);
+
+  allocator_set_scratch(p_prev);
+  arena_reset(&arena);
+  arena_finalize(&arena);
+
+  for (int i = 0; i < 1000; ++i) {
+    assert(i == long_lived[i]);
+  }
+  vec_free(long_lived);
+
+  // with ALLOCATOR_THREAD_SAFE freed small blocks stay in the thread cache
+#ifndef ALLOCATOR_THREAD_SAFE
+  VsaFragmentation after;
+  allocator_get_fragmentation(&after);
+  assert(before.free_bytes == after.free_bytes);
+#endif // !ALLOCATOR_THREAD_SAFE
+}
+
+void test_allocator_handle(void) {
+  Arena arena;
+  arena_init(&arena, 0);
+  Allocator allocator = allocator_from_arena(&arena);
+
+  vec(int) v;
+  vec_alloc_with(v, 4, &allocator);
+  for (int i = 0; i < 100; ++i) vec_push(v, i);
+  assert(arena_owns(&arena, vec_get_header(v)));
+  for (int i = 0; i < 100; ++i) assert(i == v[i]);
+
+  StringBuilder sb;
+  string_builder_init_with_allocator(sb, &allocator);
+  string_builder_append_cstr(&sb, "handle");
+  assert(arena_owns(&arena, string_builder_get_cstr(&sb)));
+  assert(0 == strcmp("handle", string_builder_get_cstr(&sb)));
+
+  Table table;
+  table_init_with_allocator(&table, hash_cstr_default, key_cmp_default, NULL, &allocator);
+  const char *keys[] = {"a", "b", "c", "d", "e", "f", "g", "h", "i", "j"};
+  for (size_t i = 0; i < sizeof(keys) / sizeof(*keys); ++i) {
+    table_set(&table, keys[i], (void*)keys[i]);
+  }
+  assert(arena_owns(&arena, table.entries));
+
+  void *value = NULL;
+  assert(table_get(&table, keys[3], &value));
+  assert(value == keys[3]);
+
+  arena_finalize(&arena);
+}
+
+LogSeverity g_log_severity = LOG_ALL;
+
+int main() {
+  init_allocator();
+  atexit(allocator_finalize);
+
+  test_bump();
+  test_scratch();
+  test_allocator_handle();
+
+  return 0;
+}
@@ -0,0 +1,536 @@
+#include <assert.h>
+#include <sched.h>
+
+#include "concurrent_table.h"
+#include "allocator.h"
+#include "vec.h"
+
+#define TOMBSTONE_VAL CONCURRENT_TABLE_TOMBSTONE_VAL
+#define MOVED_VAL CONCURRENT_TABLE_MOVED_VAL
+
+/// Hash of a taken slot has the top bit set, so 0 marks an empty slot
+#define HASH_TAKEN_BIT ((size_t)1 << (sizeof(size_t) * 8 - 1))
+
+/// Marks an empty slot of an array whose entries are moved,
+///   such slot cannot be taken anymore
+#define HASH_MOVED ((size_t)1)
+
+/// Minimal capacity is twice the number of stripes,
+///   so writers that race for slots cannot fill an array
+#define ARR_MIN_CAPACITY (CONCURRENT_TABLE_STRIPE_COUNT * 2)
+
+/// A writer starts a resize once 3/4 of slots are taken,
+///   no slot is taken beyond 7/8 of them
+#define RESIZE_LOAD(capacity) ((capacity) / 4 * 3)
+#define MAX_LOAD(capacity) ((capacity) / 8 * 7)
+
+/// Number of slots a writer moves to the new array after its operation
+#define MIGRATE_CHUNK_SIZE 64
+
+/// A stripe tries to move the epoch forward after this many deletions
+#define LIMBO_ADVANCE_INTERVAL 32
+
+#define LOAD(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define STORE(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#define CAS(ptr, p_expected, desired) \
+  __atomic_compare_exchange_n((ptr), (p_expected), (desired), false, \
+                              __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+#define FETCH_ADD(ptr, value) __atomic_fetch_add((ptr), (value), __ATOMIC_ACQ_REL)
+#define FETCH_SUB(ptr, value) __atomic_fetch_sub((ptr), (value), __ATOMIC_ACQ_REL)
+// a thread counted in an epoch has to see the epoch it is counted in
+// and a writer that moves the epoch has to see that count, or the other way
+#define SEQ_LOAD(ptr) __atomic_load_n((ptr), __ATOMIC_SEQ_CST)
+#define SEQ_FETCH_ADD(ptr, value) __atomic_fetch_add((ptr), (value), __ATOMIC_SEQ_CST)
+#define SEQ_CAS(ptr, p_expected, desired) \
+  __atomic_compare_exchange_n((ptr), (p_expected), (desired), false, \
+                              __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+
+/// Slot is taken by writing its hash, then its key is published.
+/// Deletion writes TOMBSTONE_VAL to the value and clears the key,
+///   so the key can be freed, a deleted slot is not taken again.
+/// Moving the entry to the next array writes MOVED_VAL.
+typedef struct {
+  size_t hash;
+  const void *key;
+  void *value;
+} Slot;
+
+typedef struct SlotArray {
+  /// Number of slots, a power of two
+  size_t capacity;
+
+  /// Number of taken slots, including deleted ones
+  ///   and slots reserved for entries moved from the previous array
+  size_t used;
+
+  /// Array entries are being moved to, NULL if the array is the newest one
+  struct SlotArray *p_next;
+
+  /// Next slot to move and number of slots moved so far
+  size_t migrate_cursor;
+  size_t migrated_count;
+
+  /// Link in the list of retired arrays
+  struct SlotArray *p_retired_next;
+
+  Slot slots[];
+} SlotArray;
+
+
+static ConcurrentTableStripe *stripe_get(ConcurrentTable *table, size_t hash) {
+  size_t mixed = hash * 0x9E3779B97F4A7C15ull;
+  return &table->stripes[(mixed >> 32) % CONCURRENT_TABLE_STRIPE_COUNT];
+}
+
+
+/// Address of the variable picks the shard of readers of the thread
+static _Thread_local char t_reader_anchor;
+
+/// Counts the calling thread in the current epoch until epoch_exit,
+///   memory retired from now on is not freed meanwhile
+///
+/// @return size_t*, counter to pass to epoch_exit
+static size_t *epoch_enter(const ConcurrentTable *table) {
+  size_t mixed = (size_t)&t_reader_anchor * 0x9E3779B97F4A7C15ull;
+  // counters change while the table is shared by readers
+  ConcurrentTableReaders *p_readers = (ConcurrentTableReaders*)
+    &table->readers[(mixed >> 32) % CONCURRENT_TABLE_READER_SHARD_COUNT];
+
+  for (;;) {
+    size_t epoch = SEQ_LOAD(&table->epoch);
+    size_t *p_active = &p_readers->active[epoch & 1];
+    SEQ_FETCH_ADD(p_active, 1);
+    if (epoch == SEQ_LOAD(&table->epoch)) return p_active;
+
+    // the epoch moved before the thread was counted in it
+    FETCH_SUB(p_active, 1);
+  }
+}
+
+static void epoch_exit(size_t *p_active) {
+  FETCH_SUB(p_active, 1);
+}
+
+/// Moves the epoch from E to E + 1 if no thread counted in E - 1 is left.
+/// Threads counted in E - 2 and before left already, so memory retired
+///   in E - 1 cannot be reached by any thread once the epoch is E + 1.
+static void epoch_try_advance(ConcurrentTable *table) {
+  size_t epoch = SEQ_LOAD(&table->epoch);
+  for (size_t i = 0; i < CONCURRENT_TABLE_READER_SHARD_COUNT; ++i) {
+    if (0 != SEQ_LOAD(&table->readers[i].active[(epoch + 1) & 1])) return;
+  }
+  SEQ_CAS(&table->epoch, &epoch, epoch + 1);
+}
+
+/// Passes pairs deleted two or more epochs before @epoch to free_kv_func,
+///   the stripe has to be locked
+///
+/// @return ConcurrentTablePair*, vec of pairs deleted in @epoch
+static ConcurrentTablePair *stripe_limbo_get_locked(ConcurrentTable *table,
+                                                    ConcurrentTableStripe *stripe,
+                                                    size_t epoch) {
+  ConcurrentTablePair *limbo = stripe->limbo[epoch & 1];
+  if (NULL == limbo) {
+    vec_alloc(limbo);
+  } else if (epoch != stripe->limbo_epochs[epoch & 1]) {
+    // same parity and another epoch, so at least two epochs old
+    for (size_t i = 0; i < vec_count(limbo); ++i) {
+      table->free_kv_func(limbo[i].key, limbo[i].value);
+    }
+    vec_count(limbo) = 0;
+  }
+  stripe->limbo[epoch & 1] = limbo;
+  stripe->limbo_epochs[epoch & 1] = epoch;
+  return limbo;
+}
+
+/// Keeps a deleted pair until no thread can see it, the stripe has to be locked
+static void stripe_retire_locked(ConcurrentTable *table, ConcurrentTableStripe *stripe,
+                                 const void *key, void *value) {
+  size_t epoch = SEQ_LOAD(&table->epoch);
+  ConcurrentTablePair *limbo = stripe_limbo_get_locked(table, stripe, epoch);
+  vec_push(limbo, ((ConcurrentTablePair){ key, value }));
+  stripe->limbo[epoch & 1] = limbo;
+
+  if (0 == vec_count(limbo) % LIMBO_ADVANCE_INTERVAL) epoch_try_advance(table);
+}
+
+static SlotArray *array_create(size_t capacity) {
+  SlotArray *arr = a_allocate(sizeof(SlotArray) + sizeof(Slot) * capacity);
+  if (NULL == arr) logf_fatal("CONCURRENT_TABLE", 137, "allocation of array with capacity %lu failed!", capacity);
+
+  arr->capacity = capacity;
+  arr->used = 0;
+  arr->p_next = NULL;
+  arr->migrate_cursor = 0;
+  arr->migrated_count = 0;
+  arr->p_retired_next = NULL;
+  for (size_t i = 0; i < capacity; ++i) {
+    arr->slots[i].hash = 0;
+    arr->slots[i].key = NULL;
+    arr->slots[i].value = TOMBSTONE_VAL;
+  }
+  return arr;
+}
+
+/// Looking up for a slot with key in the array
+///
+/// @return Slot*, slot of the key or NULL if the key is not in the array
+static Slot *array_find(const ConcurrentTable *table, SlotArray *arr,
+                        const void *key, size_t hash) {
+  size_t mask = arr->capacity - 1;
+  for (size_t index = hash & mask;; index = (index + 1) & mask) {
+    Slot *slot = arr->slots + index;
+
+    size_t slot_hash = LOAD(&slot->hash);
+    if (0 == slot_hash || HASH_MOVED == slot_hash) return NULL;
+    if (hash != slot_hash) continue;
+
+    // key is not published yet while the slot is being taken,
+    // that insertion is not visible to readers yet, or it was deleted
+    const void *slot_key = LOAD(&slot->key);
+    if (NULL != slot_key && table->key_cmp_func(key, slot_key)) return slot;
+  }
+}
+
+/// Takes an empty slot of the array for @key
+///
+/// @return Slot*, NULL if entries of the array are being moved
+static Slot *array_take(SlotArray *arr, const void *key, size_t hash) {
+  size_t mask = arr->capacity - 1;
+  for (size_t index = hash & mask;; index = (index + 1) & mask) {
+    Slot *slot = arr->slots + index;
+
+    size_t slot_hash = LOAD(&slot->hash);
+    if (0 == slot_hash && CAS(&slot->hash, &slot_hash, hash)) {
+      STORE(&slot->key, key);
+      return slot;
+    }
+    if (HASH_MOVED == slot_hash) return NULL;
+  }
+}
+
+/// Moves the entry of the slot to the next array,
+///   the stripe of the slot hash has to be locked
+static void slot_migrate_locked(SlotArray *arr, Slot *slot) {
+  void *value = LOAD(&slot->value);
+  if (MOVED_VAL == value) return;
+
+  if (TOMBSTONE_VAL != value) {
+    // the key cannot be in the next array yet: writers of the key
+    // move its entry before they write to the next array
+    Slot *new_slot = array_take(arr->p_next, LOAD(&slot->key), LOAD(&slot->hash));
+    assert(NULL != new_slot);
+    STORE(&new_slot->value, value);
+  }
+  STORE(&slot->value, MOVED_VAL);
+}
+
+static void array_free_list(SlotArray *arr) {
+  while (NULL != arr) {
+    SlotArray *retired_next = arr->p_retired_next;
+    a_free(arr);
+    arr = retired_next;
+  }
+}
+
+/// Replaces the current array by @arr->p_next once all entries are moved,
+///   @arr is freed two epochs later
+static void array_retire(ConcurrentTable *table, SlotArray *arr) {
+  pthread_mutex_lock(&table->resize_lock);
+  STORE(&table->current, arr->p_next);
+
+  epoch_try_advance(table);
+  size_t epoch = SEQ_LOAD(&table->epoch);
+  if (epoch != table->retired_epochs[epoch & 1]) {
+    // same parity and another epoch, so at least two epochs old
+    array_free_list(table->retired[epoch & 1]);
+    table->retired[epoch & 1] = NULL;
+    table->retired_epochs[epoch & 1] = epoch;
+  }
+  arr->p_retired_next = table->retired[epoch & 1];
+  table->retired[epoch & 1] = arr;
+  pthread_mutex_unlock(&table->resize_lock);
+}
+
+/// Moves a chunk of entries of @arr to the next array,
+///   no stripe may be locked by the caller
+static void migrate_help(ConcurrentTable *table, SlotArray *arr) {
+  size_t begin = FETCH_ADD(&arr->migrate_cursor, MIGRATE_CHUNK_SIZE);
+  if (begin >= arr->capacity) return;
+
+  size_t end = begin + MIGRATE_CHUNK_SIZE;
+  if (end > arr->capacity) end = arr->capacity;
+
+  for (size_t i = begin; i < end; ++i) {
+    Slot *slot = arr->slots + i;
+
+    size_t slot_hash = 0;
+    if (CAS(&slot->hash, &slot_hash, HASH_MOVED)) continue;
+
+    ConcurrentTableStripe *stripe = stripe_get(table, slot_hash);
+    pthread_mutex_lock(&stripe->lock);
+    slot_migrate_locked(arr, slot);
+    pthread_mutex_unlock(&stripe->lock);
+  }
+
+  if (FETCH_ADD(&arr->migrated_count, end - begin) + (end - begin) == arr->capacity) {
+    array_retire(table, arr);
+  }
+}
+
+/// Creates the array entries of @arr are moved to,
+///   or the first array if @arr is NULL
+static void resize_start(ConcurrentTable *table, SlotArray *arr) {
+  pthread_mutex_lock(&table->resize_lock);
+  if (LOAD(&table->current) != arr || (NULL != arr && NULL != arr->p_next)) {
+    // another writer was faster
+    pthread_mutex_unlock(&table->resize_lock);
+    return;
+  }
+
+  // slots for all entries of the old array are reserved in the new one,
+  // writers that are taking slots in the old array are counted as well
+  size_t reserved = LOAD(&table->count) + CONCURRENT_TABLE_STRIPE_COUNT;
+  size_t capacity = ARR_MIN_CAPACITY;
+  while (capacity < reserved * 2) capacity *= 2;
+
+  SlotArray *next = array_create(capacity);
+  if (NULL == arr) {
+    STORE(&table->current, next);
+  } else {
+    next->used = reserved;
+    STORE(&arr->p_next, next);
+  }
+  pthread_mutex_unlock(&table->resize_lock);
+}
+
+/// Makes room for a new key when the newest array is full,
+///   no stripe may be locked by the caller
+static void make_room(ConcurrentTable *table) {
+  SlotArray *current = LOAD(&table->current);
+  if (NULL == current || NULL == LOAD(&current->p_next)) {
+    resize_start(table, current);
+    return;
+  }
+
+  // the new array is full before all entries were moved to it
+  while (LOAD(&table->current) == current) {
+    migrate_help(table, current);
+    sched_yield();
+  }
+}
+
+/// Finds the slot of the key in the newest array and takes a new one if needed.
+/// Entry of the key in an older array is moved to the newest array first.
+/// The stripe of the key has to be locked.
+///
+/// @param is_taking: take a slot if the key is not found
+/// @outparam p_is_full: set if a slot is needed but the newest array is full
+/// @return Slot*, NULL if the key is not found and no slot was taken
+static Slot *slot_find_locked(ConcurrentTable *table, const void *key, size_t hash,
+                              bool is_taking, bool *p_is_full) {
+  *p_is_full = false;
+
+  SlotArray *arr = LOAD(&table->current);
+  while (NULL != arr) {
+    SlotArray *next = LOAD(&arr->p_next);
+    Slot *slot = array_find(table, arr, key, hash);
+
+    if (NULL != next) {
+      if (NULL != slot) slot_migrate_locked(arr, slot);
+      arr = next;
+      continue;
+    }
+
+    if (NULL != slot) {
+      // moved by a writer that started the resize after p_next was loaded
+      if (MOVED_VAL == LOAD(&slot->value)) continue;
+      return slot;
+    }
+
+    if (!is_taking) return NULL;
+
+    if (FETCH_ADD(&arr->used, 1) >= MAX_LOAD(arr->capacity)) {
+      FETCH_SUB(&arr->used, 1);
+      break;
+    }
+
+    slot = array_take(arr, key, hash);
+    if (NULL != slot) return slot;
+
+    // entries started to be moved after p_next was loaded
+    FETCH_SUB(&arr->used, 1);
+  }
+
+  *p_is_full = is_taking;
+  return NULL;
+}
+
+/// Starts a resize if the newest array is loaded enough,
+///   helps to move entries if a resize is in progress
+static void maintain(ConcurrentTable *table) {
+  SlotArray *current = LOAD(&table->current);
+  if (NULL != LOAD(&current->p_next)) {
+    migrate_help(table, current);
+  } else if (LOAD(&current->used) >= RESIZE_LOAD(current->capacity)) {
+    resize_start(table, current);
+  }
+}
+
+
+void concurrent_table_init(ConcurrentTable *table,
+                           HashFunc hash_func, KeyCmpFunc key_cmp_func,
+                           FreeKeyValFunc free_kv_func) {
+  assert(NULL != table);
+  assert(NULL != hash_func);
+  assert(NULL != key_cmp_func);
+
+  table->hash_func = hash_func;
+  table->key_cmp_func = key_cmp_func;
+  table->free_kv_func = free_kv_func;
+  table->current = NULL;
+  table->count = 0;
+  table->epoch = 0;
+  pthread_mutex_init(&table->resize_lock, NULL);
+  for (size_t i = 0; i < 2; ++i) {
+    table->retired[i] = NULL;
+    table->retired_epochs[i] = i;
+  }
+  for (size_t i = 0; i < CONCURRENT_TABLE_STRIPE_COUNT; ++i) {
+    pthread_mutex_init(&table->stripes[i].lock, NULL);
+    table->stripes[i].limbo[0] = NULL;
+    table->stripes[i].limbo[1] = NULL;
+  }
+  for (size_t i = 0; i < CONCURRENT_TABLE_READER_SHARD_COUNT; ++i) {
+    table->readers[i].active[0] = 0;
+    table->readers[i].active[1] = 0;
+  }
+}
+
+void concurrent_table_free(ConcurrentTable *table) {
+  assert(NULL != table);
+
+  SlotArray *arr = table->current;
+  while (NULL != arr) {
+    SlotArray *next = arr->p_next;
+    for (size_t i = 0; NULL != table->free_kv_func && i < arr->capacity; ++i) {
+      Slot *slot = arr->slots + i;
+      if (TOMBSTONE_VAL == slot->value || MOVED_VAL == slot->value) continue;
+      table->free_kv_func(slot->key, slot->value);
+    }
+    a_free(arr);
+    arr = next;
+  }
+
+  for (size_t i = 0; i < 2; ++i) {
+    array_free_list(table->retired[i]);
+    table->retired[i] = NULL;
+  }
+
+  pthread_mutex_destroy(&table->resize_lock);
+  for (size_t i = 0; i < CONCURRENT_TABLE_STRIPE_COUNT; ++i) {
+    ConcurrentTableStripe *stripe = &table->stripes[i];
+    for (size_t j = 0; j < 2; ++j) {
+      ConcurrentTablePair *limbo = stripe->limbo[j];
+      if (NULL == limbo) continue;
+      for (size_t k = 0; k < vec_count(limbo); ++k) {
+        table->free_kv_func(limbo[k].key, limbo[k].value);
+      }
+      vec_free(limbo);
+      stripe->limbo[j] = NULL;
+    }
+    pthread_mutex_destroy(&stripe->lock);
+  }
+  table->current = NULL;
+  table->count = 0;
+}
+
+bool concurrent_table_set(ConcurrentTable *table, const void *key, void *value) {
+  assert(NULL != table);
+  assert(NULL != key);
+  assert(TOMBSTONE_VAL != value && MOVED_VAL != value);
+
+  size_t hash = table->hash_func(key) | HASH_TAKEN_BIT;
+  ConcurrentTableStripe *stripe = stripe_get(table, hash);
+  size_t *p_active = epoch_enter(table);
+
+  bool is_new_key = false;
+  for (;;) {
+    bool is_full = false;
+    pthread_mutex_lock(&stripe->lock);
+    Slot *slot = slot_find_locked(table, key, hash, true, &is_full);
+    if (NULL != slot) {
+      is_new_key = TOMBSTONE_VAL == LOAD(&slot->value);
+      STORE(&slot->value, value);
+      if (is_new_key) FETCH_ADD(&table->count, 1);
+    }
+    pthread_mutex_unlock(&stripe->lock);
+
+    if (!is_full) break;
+    make_room(table);
+  }
+
+  maintain(table);
+  epoch_exit(p_active);
+  return is_new_key;
+}
+
+bool concurrent_table_get(const ConcurrentTable *table, const void *key, void **value) {
+  assert(NULL != table);
+  assert(NULL != key);
+
+  size_t hash = table->hash_func(key) | HASH_TAKEN_BIT;
+  size_t *p_active = epoch_enter(table);
+
+  // a key missing in an array may have been inserted to the next one already
+  bool is_found = false;
+  SlotArray *arr = LOAD(&table->current);
+  for (; NULL != arr; arr = LOAD(&arr->p_next)) {
+    Slot *slot = array_find(table, arr, key, hash);
+    if (NULL == slot) continue;
+
+    void *slot_value = LOAD(&slot->value);
+    if (MOVED_VAL == slot_value) continue;
+    if (TOMBSTONE_VAL == slot_value) break;
+
+    *value = slot_value;
+    is_found = true;
+    break;
+  }
+
+  epoch_exit(p_active);
+  return is_found;
+}
+
+bool concurrent_table_delete(ConcurrentTable *table, const void *key) {
+  assert(NULL != table);
+  assert(NULL != key);
+
+  size_t hash = table->hash_func(key) | HASH_TAKEN_BIT;
+  ConcurrentTableStripe *stripe = stripe_get(table, hash);
+  size_t *p_active = epoch_enter(table);
+
+  bool is_full = false;
+  pthread_mutex_lock(&stripe->lock);
+  Slot *slot = slot_find_locked(table, key, hash, false, &is_full);
+  bool is_deleted = NULL != slot && TOMBSTONE_VAL != LOAD(&slot->value);
+  if (is_deleted) {
+    const void *slot_key = LOAD(&slot->key);
+    void *slot_value = LOAD(&slot->value);
+    STORE(&slot->value, TOMBSTONE_VAL);
+    STORE(&slot->key, NULL);
+    FETCH_SUB(&table->count, 1);
+    if (NULL != table->free_kv_func) stripe_retire_locked(table, stripe, slot_key, slot_value);
+  }
+  pthread_mutex_unlock(&stripe->lock);
+
+  if (NULL != LOAD(&table->current)) maintain(table);
+  epoch_exit(p_active);
+  return is_deleted;
+}
+
+size_t concurrent_table_count(const ConcurrentTable *table) {
+  assert(NULL != table);
+  return LOAD(&table->count);
+}
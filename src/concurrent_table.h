@@ -0,0 +1,140 @@
+#ifndef __CONCURRENT_TABLE_H__
+#define __CONCURRENT_TABLE_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "table.h"
+
+/// Number of locks writers are spread over by hash of the key
+#define CONCURRENT_TABLE_STRIPE_COUNT 64
+
+/// Number of counters of threads inside table operations,
+///   threads are spread over them by address of a thread local variable
+#define CONCURRENT_TABLE_READER_SHARD_COUNT 64
+
+/// Values the table uses internally, they cannot be stored
+#define CONCURRENT_TABLE_TOMBSTONE_VAL ((void*)0x1)
+#define CONCURRENT_TABLE_MOVED_VAL ((void*)0x2)
+
+/// Hash table for data that is read by many threads while a few update it.
+///
+/// concurrent_table_get takes no locks and never waits for writers.
+/// concurrent_table_set and concurrent_table_delete lock one of
+///   CONCURRENT_TABLE_STRIPE_COUNT locks chosen by hash of the key,
+///   so writers of different keys mostly do not contend.
+/// When the table fills up a bigger array is created and entries are moved
+///   to it a few at a time by following writers, readers look into both
+///   arrays meanwhile.
+///
+/// Replaced arrays and deleted pairs may still be used by threads that
+///   started an operation before, so they are reclaimed by epochs:
+///   every operation counts itself in the epoch it started in,
+///   writers move the epoch forward once no operation of the previous epoch
+///   is running, and memory retired in an epoch is freed two epochs later.
+///   Counting costs a get two atomic additions on a counter shared with
+///   threads of the same shard only. A thread that stays inside an operation
+///   holds reclamation back, memory then grows until it leaves.
+/// Deleted pairs are passed to free_kv_func once no thread can see them,
+///   pairs left in the table are passed to it by concurrent_table_free.
+/// Arrays are allocated by a_allocate, build with ALLOCATOR_THREAD_SAFE
+///   if several threads write to the table.
+typedef struct {
+  const void *key;
+  void *value;
+} ConcurrentTablePair;
+
+/// Threads inside an operation that started in an even or odd epoch
+typedef struct {
+  _Alignas(64) size_t active[2];
+} ConcurrentTableReaders;
+
+typedef struct {
+  pthread_mutex_t lock;
+
+  /// Pairs deleted under the lock (vecs), by parity of the epoch
+  ///   they were deleted in, and the epoch of each list
+  ConcurrentTablePair *limbo[2];
+  size_t limbo_epochs[2];
+} ConcurrentTableStripe;
+
+typedef struct {
+  HashFunc hash_func;
+  KeyCmpFunc key_cmp_func;
+  FreeKeyValFunc free_kv_func;
+
+  /// Array readers start at, it is replaced when moving entries is done
+  void *current;
+
+  /// Number of keys in the table
+  size_t count;
+
+  /// Epoch of reclamation, see ConcurrentTableReaders
+  size_t epoch;
+
+  /// Arrays that were replaced, linked through themselves,
+  ///   by parity of the epoch they were replaced in, and the epoch of each list
+  void *retired[2];
+  size_t retired_epochs[2];
+
+  /// Serializes creation of a bigger array and retiring the old one
+  pthread_mutex_t resize_lock;
+
+  ConcurrentTableStripe stripes[CONCURRENT_TABLE_STRIPE_COUNT];
+
+  ConcurrentTableReaders readers[CONCURRENT_TABLE_READER_SHARD_COUNT];
+} ConcurrentTable;
+
+
+/// Initializes an empty table
+///
+/// @param table: pointer to the table to be initialized
+/// @param hash_func: pointer to the hash function for keys
+/// @param key_cmp_func: pointer to the function that compares keys for equality
+/// @param free_kv_func: pointer to the callback function for freeing deleted
+///   key and value pairs and pairs left on concurrent_table_free,
+///   it will not be called if NULL is passed
+/// @return void
+void concurrent_table_init(ConcurrentTable *table,
+                           HashFunc hash_func, KeyCmpFunc key_cmp_func,
+                           FreeKeyValFunc free_kv_func);
+
+/// Frees all arrays of the table and passes pairs left in it to free_kv_func,
+///   no other thread may use the table
+///
+/// @param table: pointer to the table to be freed
+/// @return void
+void concurrent_table_free(ConcurrentTable *table);
+
+/// Inserts new value to the table by key,
+/// if key already exists, then overrides old value associated to that key
+///
+/// @param table: pointer to table to insert value in
+/// @param key: pointer to the key to associate value with
+/// @param value: pointer to the value to insert,
+///   it must not be CONCURRENT_TABLE_TOMBSTONE_VAL or CONCURRENT_TABLE_MOVED_VAL
+///
+/// @return bool, true if key is new, otherwise false
+bool concurrent_table_set(ConcurrentTable *table, const void *key, void *value);
+
+/// Looks up for a value in the tabel associated with the key without locking
+///
+/// @param table: pointer to the table to look up in
+/// @param key: pointer to the key value associated with
+/// @outparam value: pointer to the found value (untouched if not found)
+/// @return bool, true if value was found, false otherwise
+bool concurrent_table_get(const ConcurrentTable *table, const void *key, void **value);
+
+/// Deletes entry associated with the key in the table,
+///   the pair is passed to free_kv_func once no other thread can see it
+///
+/// @param table: pointer to the table to delete from
+/// @param key: pointer to the key value associated with
+/// @return bool, true if entry was found and deleted, false otherwise
+bool concurrent_table_delete(ConcurrentTable *table, const void *key);
+
+/// Returns the number of keys in the table
+size_t concurrent_table_count(const ConcurrentTable *table);
+
+#endif // !__CONCURRENT_TABLE_H__
@@ -0,0 +1,159 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "concurrent_table.h"
+#include "allocator.h"
+#include "logger.h"
+
+void init_allocator() {
+  size_t allocator_size = 4lu * 1024lu * 1024lu; // 4 MiB
+  if (!allocator_init(allocator_size)) {
+    abort();
+  }
+}
+
+LogSeverity g_log_severity = LOG_ALL;
+
+bool key_cmp_cstr(const void *lhs, const void *rhs) {
+  return 0 == strcmp(lhs, rhs);
+}
+
+#define KEYS_COUNT 4000
+#define READERS_COUNT 4
+
+static char g_keys[KEYS_COUNT][16];
+static ConcurrentTable g_table;
+static bool g_is_writing = true;
+
+// keys below KEYS_COUNT / 2 are never deleted or changed,
+// readers must find them however the table is resized meanwhile
+void *reader_run(void *arg) {
+  (void)arg;
+  size_t found_count = 0;
+  while (__atomic_load_n(&g_is_writing, __ATOMIC_ACQUIRE)) {
+    for (size_t i = 0; i < KEYS_COUNT / 2; ++i) {
+      void *value = NULL;
+      assert(concurrent_table_get(&g_table, g_keys[i], &value));
+      assert(i + 16 == (size_t)value);
+      ++found_count;
+    }
+  }
+  return (void*)found_count;
+}
+
+static size_t g_freed_count;
+
+void free_key(const void *key, void *value) {
+  (void)value;
+  a_free((void*)key);
+  ++g_freed_count;
+}
+
+char *key_create(const char *prefix, size_t i) {
+  char *key = a_allocate(32);
+  snprintf(key, 32, "%s_%zu", prefix, i);
+  return key;
+}
+
+#define CHURN_ROUNDS 40
+#define CHURN_WINDOW 500
+
+/// Inserts KEYS_COUNT new keys, each deletes the key inserted CHURN_WINDOW keys before
+void churn_round(size_t *p_inserted_count) {
+  char key[32];
+  for (size_t i = 0; i < KEYS_COUNT; ++i, ++*p_inserted_count) {
+    assert(concurrent_table_set(&g_table, key_create("churn", *p_inserted_count), (void*)16));
+    if (*p_inserted_count < CHURN_WINDOW) continue;
+
+    snprintf(key, sizeof(key), "churn_%zu", *p_inserted_count - CHURN_WINDOW);
+    assert(concurrent_table_delete(&g_table, key));
+  }
+}
+
+// the writer inserts ever new keys and deletes them again while readers look up
+// stable keys, replaced arrays and deleted keys are freed while the table is used
+void test_churn() {
+  __atomic_store_n(&g_is_writing, true, __ATOMIC_RELEASE);
+  g_freed_count = 0;
+  concurrent_table_init(&g_table, hash_cstr_default, key_cmp_cstr, free_key);
+  for (size_t i = 0; i < KEYS_COUNT / 2; ++i) {
+    assert(concurrent_table_set(&g_table, key_create("key", i), (void*)(i + 16)));
+  }
+
+  pthread_t readers[READERS_COUNT];
+  for (size_t i = 0; i < READERS_COUNT; ++i) {
+    pthread_create(&readers[i], NULL, reader_run, NULL);
+  }
+
+  size_t inserted_count = 0;
+  AllocatorStats warm, after;
+  for (size_t round = 0; round < CHURN_ROUNDS; ++round) {
+    if (CHURN_ROUNDS / 4 == round) allocator_get_stats(&warm);
+    churn_round(&inserted_count);
+  }
+  allocator_get_stats(&after);
+  __atomic_store_n(&g_is_writing, false, __ATOMIC_RELEASE);
+  for (size_t i = 0; i < READERS_COUNT; ++i) pthread_join(readers[i], NULL);
+
+  // a reader preempted inside a lookup holds reclamation back for a while,
+  // without reclamation the last three quarters of rounds would add megabytes
+  assert(after.bytes_in_use < 2 * warm.bytes_in_use);
+
+  // with no readers every deletion but the last few per stripe is reclaimed
+  churn_round(&inserted_count);
+  assert(inserted_count - CHURN_WINDOW <= g_freed_count + 64 * CONCURRENT_TABLE_STRIPE_COUNT);
+  assert(KEYS_COUNT / 2 + CHURN_WINDOW == concurrent_table_count(&g_table));
+
+  concurrent_table_free(&g_table);
+  assert(inserted_count + KEYS_COUNT / 2 == g_freed_count);
+}
+
+int main() {
+  init_allocator();
+  atexit(allocator_finalize);
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) snprintf(g_keys[i], sizeof(g_keys[i]), "key_%zu", i);
+
+  concurrent_table_init(&g_table, hash_cstr_default, key_cmp_cstr, NULL);
+  void *value = NULL;
+  assert(!concurrent_table_get(&g_table, g_keys[0], &value));
+  assert(!concurrent_table_delete(&g_table, g_keys[0]));
+
+  for (size_t i = 0; i < KEYS_COUNT / 2; ++i) {
+    assert(concurrent_table_set(&g_table, g_keys[i], (void*)(i + 16)));
+  }
+  assert(!concurrent_table_set(&g_table, g_keys[0], (void*)16));
+
+  pthread_t readers[READERS_COUNT];
+  for (size_t i = 0; i < READERS_COUNT; ++i) {
+    pthread_create(&readers[i], NULL, reader_run, NULL);
+  }
+
+  // the writer grows the table and churns the other half of keys
+  for (size_t round = 0; round < 20; ++round) {
+    for (size_t i = KEYS_COUNT / 2; i < KEYS_COUNT; ++i) {
+      assert(concurrent_table_set(&g_table, g_keys[i], (void*)(i + 16)));
+    }
+    for (size_t i = KEYS_COUNT / 2; i < KEYS_COUNT; ++i) {
+      assert(concurrent_table_get(&g_table, g_keys[i], &value));
+      assert(concurrent_table_delete(&g_table, g_keys[i]));
+      assert(!concurrent_table_get(&g_table, g_keys[i], &value));
+    }
+  }
+  __atomic_store_n(&g_is_writing, false, __ATOMIC_RELEASE);
+
+  for (size_t i = 0; i < READERS_COUNT; ++i) {
+    void *found_count = NULL;
+    pthread_join(readers[i], &found_count);
+    assert(0 < (size_t)found_count);
+  }
+  assert(KEYS_COUNT / 2 == concurrent_table_count(&g_table));
+
+  concurrent_table_free(&g_table);
+
+  test_churn();
+  return 0;
+}
@@ -0,0 +1,250 @@
+#ifndef __DEQUE_H__
+#define __DEQUE_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#include "allocator.h"
+#include "logger.h"
+
+/// Generator of chunked double ended queues.
+///
+/// DEQUE_DEFINE(name, T) defines the deque type `name` keeping elements of T
+///   in fixed size blocks of DEQUE_BLOCK_COUNT(T) elements. A directory
+///   of block pointers has free room at both ends, so push and pop at either
+///   end are O(1) and growing allocates one block, never copying elements:
+///   only the directory of pointers is copied when it runs out of room.
+/// Elements never move, a pointer to an element stays valid until
+///   the element is popped.
+///
+/// Iterating by name##_segment visits contiguous runs of elements, so the
+///   inner loop is as tight as a loop over a vec:
+///   for (size_t i = 0; i < name##_count(&d);) {
+///     size_t n;
+///     T *items = name##_segment(&d, i, &n);
+///     for (size_t j = 0; j < n; ++j) ... items[j] ...
+///     i += n;
+///   }
+///
+/// Defined static inline functions: name##_init, name##_init_with_allocator,
+///   name##_free, name##_count, name##_is_empty, name##_at, name##_front,
+///   name##_back, name##_segment, name##_push_back, name##_push_front,
+///   name##_pop_back, name##_pop_front, name##_extend_back and name##_clear.
+///
+/// Example:
+///   DEQUE_DEFINE(int_deque, int)
+///   int_deque d;
+///   int_deque_init(&d);
+///   int_deque_push_back(&d, 1);
+///   int_deque_push_front(&d, 0);
+///   int_deque_free(&d);
+
+/// Elements in a block, a power of two of about 4 KiB worth of elements
+#define DEQUE_BLOCK_COUNT(T) \
+  (sizeof(T) <= 8 ? 512 : sizeof(T) <= 16 ? 256 : sizeof(T) <= 32 ? 128 \
+   : sizeof(T) <= 64 ? 64 : 16)
+
+#define DEQUE_DIRECTORY_MIN_CAPACITY 8
+
+#define DEQUE_DEFINE(name, T) \
+  typedef struct { \
+    /* directory, blocks[first_block, first_block + blocks_count) are used */ \
+    T **blocks; \
+    size_t blocks_capacity; \
+    size_t first_block; \
+    size_t blocks_count; \
+    /* index of the first element in the first block */ \
+    size_t head; \
+    size_t count; \
+    /* emptied block kept for the next push, so pushing and popping */ \
+    /* across a block boundary does not allocate every time */ \
+    T *spare_block; \
+    /* allocator of blocks and the directory, NULL for the global allocator */ \
+    const Allocator *p_allocator; \
+  } name; \
+  \
+  static inline void name##_init_with_allocator(name *d, const Allocator *p_allocator) { \
+    assert(NULL != d); \
+    d->blocks = NULL; \
+    d->blocks_capacity = 0; \
+    d->first_block = 0; \
+    d->blocks_count = 0; \
+    d->head = 0; \
+    d->count = 0; \
+    d->spare_block = NULL; \
+    d->p_allocator = p_allocator; \
+  } \
+  \
+  static inline void name##_init(name *d) { \
+    name##_init_with_allocator(d, NULL); \
+  } \
+  \
+  static inline void name##_free(name *d) { \
+    assert(NULL != d); \
+    for (size_t i = 0; i < d->blocks_count; ++i) { \
+      allocator_free(d->p_allocator, d->blocks[d->first_block + i]); \
+    } \
+    if (NULL != d->spare_block) allocator_free(d->p_allocator, d->spare_block); \
+    if (NULL != d->blocks) allocator_free(d->p_allocator, d->blocks); \
+    name##_init_with_allocator(d, NULL); \
+  } \
+  \
+  static inline size_t name##_count(const name *d) { \
+    return d->count; \
+  } \
+  \
+  static inline bool name##_is_empty(const name *d) { \
+    return 0 == d->count; \
+  } \
+  \
+  static inline T *name##_at(const name *d, size_t index) { \
+    assert(index < d->count); \
+    size_t pos = d->head + index; \
+    return d->blocks[d->first_block + pos / DEQUE_BLOCK_COUNT(T)] + pos % DEQUE_BLOCK_COUNT(T); \
+  } \
+  \
+  static inline T *name##_front(const name *d) { \
+    return name##_at(d, 0); \
+  } \
+  \
+  static inline T *name##_back(const name *d) { \
+    assert(0 != d->count); \
+    return name##_at(d, d->count - 1); \
+  } \
+  \
+  /* @outparam p_count: number of contiguous elements starting at @index */ \
+  /* @return T*, pointer to the element at @index */ \
+  static inline T *name##_segment(const name *d, size_t index, size_t *p_count) { \
+    assert(NULL != p_count); \
+    size_t offset = (d->head + index) % DEQUE_BLOCK_COUNT(T); \
+    size_t count = DEQUE_BLOCK_COUNT(T) - offset; \
+    *p_count = count < d->count - index ? count : d->count - index; \
+    return name##_at(d, index); \
+  } \
+  \
+  static inline T *name##_block_allocate(name *d) { \
+    T *block = d->spare_block; \
+    d->spare_block = NULL; \
+    if (NULL == block) block = allocator_allocate(d->p_allocator, DEQUE_BLOCK_COUNT(T) * sizeof(T)); \
+    if (NULL == block) logf_fatal("DEQUE", 137, "allocation of a block failed!"); \
+    return block; \
+  } \
+  \
+  static inline void name##_block_release(name *d, T *block) { \
+    if (NULL == d->spare_block) { \
+      d->spare_block = block; \
+      return; \
+    } \
+    allocator_free(d->p_allocator, block); \
+  } \
+  \
+  /* Makes room for a block pointer before the first or after the last used one, */ \
+  /* used pointers are centered in the directory, which doubles when half full */ \
+  static inline void name##_directory_reserve(name *d, bool is_front) { \
+    if (is_front ? 0 != d->first_block \
+                 : d->first_block + d->blocks_count < d->blocks_capacity) return; \
+    \
+    size_t capacity = d->blocks_capacity; \
+    if (d->blocks_count * 2 >= capacity) { \
+      capacity = capacity < DEQUE_DIRECTORY_MIN_CAPACITY ? DEQUE_DIRECTORY_MIN_CAPACITY \
+                                                         : capacity * 2; \
+    } \
+    size_t first_block = (capacity - d->blocks_count) / 2; \
+    \
+    if (capacity == d->blocks_capacity) { \
+      memmove(d->blocks + first_block, d->blocks + d->first_block, \
+              d->blocks_count * sizeof(T*)); \
+    } else { \
+      T **blocks = allocator_allocate(d->p_allocator, capacity * sizeof(T*)); \
+      if (NULL == blocks) logf_fatal("DEQUE", 137, "allocation of a directory failed!"); \
+      if (NULL != d->blocks) { \
+        memcpy(blocks + first_block, d->blocks + d->first_block, d->blocks_count * sizeof(T*)); \
+        allocator_free(d->p_allocator, d->blocks); \
+      } \
+      d->blocks = blocks; \
+      d->blocks_capacity = capacity; \
+    } \
+    d->first_block = first_block; \
+  } \
+  \
+  /* Adds a block after the last one if the last one is full */ \
+  static inline void name##_reserve_back(name *d) { \
+    if (d->head + d->count < d->blocks_count * DEQUE_BLOCK_COUNT(T)) return; \
+    name##_directory_reserve(d, false); \
+    d->blocks[d->first_block + d->blocks_count++] = name##_block_allocate(d); \
+  } \
+  \
+  static inline void name##_push_back(name *d, T e) { \
+    assert(NULL != d); \
+    name##_reserve_back(d); \
+    size_t pos = d->head + d->count++; \
+    d->blocks[d->first_block + pos / DEQUE_BLOCK_COUNT(T)][pos % DEQUE_BLOCK_COUNT(T)] = e; \
+  } \
+  \
+  static inline void name##_push_front(name *d, T e) { \
+    assert(NULL != d); \
+    if (0 == d->head) { \
+      name##_directory_reserve(d, true); \
+      d->blocks[--d->first_block] = name##_block_allocate(d); \
+      ++d->blocks_count; \
+      d->head = DEQUE_BLOCK_COUNT(T); \
+    } \
+    d->blocks[d->first_block][--d->head] = e; \
+    ++d->count; \
+  } \
+  \
+  static inline T name##_pop_back(name *d) { \
+    assert(NULL != d); \
+    assert(0 != d->count); \
+    size_t pos = d->head + --d->count; \
+    T e = d->blocks[d->first_block + pos / DEQUE_BLOCK_COUNT(T)][pos % DEQUE_BLOCK_COUNT(T)]; \
+    /* the last block is released once it holds no element */ \
+    if (pos <= (d->blocks_count - 1) * DEQUE_BLOCK_COUNT(T)) { \
+      name##_block_release(d, d->blocks[d->first_block + --d->blocks_count]); \
+      if (0 == d->blocks_count) d->head = 0; \
+    } \
+    return e; \
+  } \
+  \
+  static inline T name##_pop_front(name *d) { \
+    assert(NULL != d); \
+    assert(0 != d->count); \
+    T e = d->blocks[d->first_block][d->head++]; \
+    --d->count; \
+    if (DEQUE_BLOCK_COUNT(T) == d->head) { \
+      name##_block_release(d, d->blocks[d->first_block++]); \
+      --d->blocks_count; \
+      d->head = 0; \
+    } \
+    return e; \
+  } \
+  \
+  /* Appends @n elements copied from @ptr with a memcpy per block */ \
+  static inline void name##_extend_back(name *d, const T *ptr, size_t n) { \
+    assert(NULL != d); \
+    while (n > 0) { \
+      name##_reserve_back(d); \
+      size_t pos = d->head + d->count; \
+      size_t offset = pos % DEQUE_BLOCK_COUNT(T); \
+      size_t count = DEQUE_BLOCK_COUNT(T) - offset < n ? DEQUE_BLOCK_COUNT(T) - offset : n; \
+      memcpy(d->blocks[d->first_block + pos / DEQUE_BLOCK_COUNT(T)] + offset, ptr, \
+             count * sizeof(T)); \
+      d->count += count; \
+      ptr += count; \
+      n -= count; \
+    } \
+  } \
+  \
+  /* Removes all elements, one block is kept as the spare */ \
+  static inline void name##_clear(name *d) { \
+    assert(NULL != d); \
+    while (0 != d->blocks_count) { \
+      name##_block_release(d, d->blocks[d->first_block + --d->blocks_count]); \
+    } \
+    d->head = 0; \
+    d->count = 0; \
+  }
+
+#endif // !__DEQUE_H__
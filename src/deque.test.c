@@ -0,0 +1,143 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "deque.h"
+#include "allocator.h"
+#include "logger.h"
+
+void init_allocator() {
+  size_t allocator_size = 4lu * 1024lu * 1024lu; // 4 MiB
+  if (!allocator_init(allocator_size)) {
+    abort();
+  }
+}
+
+LogSeverity g_log_severity = LOG_ALL;
+
+typedef struct {
+  char bytes[40];
+} Wide;
+
+DEQUE_DEFINE(int_deque, int)
+DEQUE_DEFINE(wide_deque, Wide)
+
+#define ITEMS_COUNT 20000
+
+void test_ends() {
+  int_deque d;
+  int_deque_init(&d);
+  assert(int_deque_is_empty(&d));
+
+  // 0 .. ITEMS_COUNT - 1 pushed back, -1 .. -ITEMS_COUNT pushed front
+  for (int i = 0; i < ITEMS_COUNT; ++i) {
+    int_deque_push_back(&d, i);
+    int_deque_push_front(&d, -i - 1);
+  }
+  assert(2 * ITEMS_COUNT == int_deque_count(&d));
+  assert(-ITEMS_COUNT == *int_deque_front(&d));
+  assert(ITEMS_COUNT - 1 == *int_deque_back(&d));
+  for (size_t i = 0; i < int_deque_count(&d); ++i) {
+    assert((int)i - ITEMS_COUNT == *int_deque_at(&d, i));
+  }
+
+  // elements do not move while the deque grows
+  int *p_first = int_deque_front(&d);
+  int *p_last = int_deque_back(&d);
+  for (int i = 0; i < ITEMS_COUNT * 4; ++i) {
+    int_deque_push_back(&d, 0);
+    int_deque_push_front(&d, 0);
+  }
+  assert(-ITEMS_COUNT == *p_first);
+  assert(ITEMS_COUNT - 1 == *p_last);
+  for (int i = 0; i < ITEMS_COUNT * 4; ++i) {
+    assert(0 == int_deque_pop_back(&d));
+    assert(0 == int_deque_pop_front(&d));
+  }
+  assert(p_first == int_deque_front(&d));
+  assert(p_last == int_deque_back(&d));
+
+  for (int i = ITEMS_COUNT - 1; i >= 0; --i) {
+    assert(i == int_deque_pop_back(&d));
+    assert(-i - 1 == int_deque_pop_front(&d));
+  }
+  assert(int_deque_is_empty(&d));
+  assert(0 == d.blocks_count);
+
+  // a deque used as a queue keeps a bounded number of blocks
+  for (int i = 0; i < ITEMS_COUNT * 10; ++i) {
+    int_deque_push_back(&d, i);
+    if (i >= 1000) assert(i - 1000 == int_deque_pop_front(&d));
+  }
+  assert(1000 == int_deque_count(&d));
+  assert(d.blocks_count <= 1000 / DEQUE_BLOCK_COUNT(int) + 2);
+
+  // alternating across a block boundary reuses the spare block
+  int_deque_clear(&d);
+  assert(int_deque_is_empty(&d));
+  for (int i = 0; i <= DEQUE_BLOCK_COUNT(int); ++i) int_deque_push_back(&d, i);
+  int_deque_pop_back(&d);
+  AllocatorStats before, after;
+  allocator_get_stats(&before);
+  for (int i = 0; i < 100; ++i) {
+    int_deque_push_back(&d, i);
+    assert(i == int_deque_pop_back(&d));
+  }
+  allocator_get_stats(&after);
+  assert(before.allocs_count == after.allocs_count);
+
+  int_deque_free(&d);
+  assert(int_deque_is_empty(&d));
+}
+
+void test_segments() {
+  static int items[ITEMS_COUNT];
+  for (int i = 0; i < ITEMS_COUNT; ++i) items[i] = i;
+
+  int_deque d;
+  int_deque_init(&d);
+  for (int i = 0; i < 100; ++i) int_deque_push_front(&d, -i - 1);
+  int_deque_extend_back(&d, items, ITEMS_COUNT);
+  int_deque_extend_back(&d, items, 0);
+  assert(ITEMS_COUNT + 100 == int_deque_count(&d));
+
+  long long sum = 0;
+  size_t visited = 0;
+  for (size_t i = 0; i < int_deque_count(&d);) {
+    size_t n;
+    int *segment = int_deque_segment(&d, i, &n);
+    assert(0 < n && n <= DEQUE_BLOCK_COUNT(int));
+    for (size_t j = 0; j < n; ++j) {
+      assert((int)(i + j) - 100 == segment[j]);
+      sum += segment[j];
+    }
+    visited += n;
+    i += n;
+  }
+  assert(ITEMS_COUNT + 100 == visited);
+  assert((long long)ITEMS_COUNT * (ITEMS_COUNT - 1) / 2 - 5050 == sum);
+  int_deque_free(&d);
+
+  wide_deque w;
+  wide_deque_init(&w);
+  for (int i = 0; i < 1000; ++i) {
+    Wide e;
+    memset(e.bytes, i % 128, sizeof(e.bytes));
+    if (i % 2) wide_deque_push_back(&w, e);
+    else wide_deque_push_front(&w, e);
+  }
+  assert(1000 == wide_deque_count(&w));
+  assert(999 % 128 == wide_deque_back(&w)->bytes[39]);
+  assert(998 % 128 == wide_deque_front(&w)->bytes[0]);
+  wide_deque_free(&w);
+}
+
+int main() {
+  init_allocator();
+  atexit(allocator_finalize);
+
+  test_ends();
+  test_segments();
+
+  return 0;
+}
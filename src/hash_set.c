@@ -0,0 +1,211 @@
+#include <assert.h>
+
+#include "hash_set.h"
+#include "allocator.h"
+#include "logger.h"
+
+#define HASH_SET_MAX_LOAD .75
+
+#define ARR_MIN_CAPACITY 16
+
+/// Distance of an entry at @index from the bucket its hash points to
+#define PROBE_LENGTH(pentry, index, capacity) (((index) - ((pentry)->hash & (capacity))) & (capacity))
+
+/// Looking up for an entry with key, inline entries included
+///
+/// @return HashSetEntry*, pointer to the found entry or NULL if there is no such key
+static HashSetEntry *find_entry(const HashSet *set, const void *key, size_t hash) {
+  if (set->capacity < 0) {
+    for (size_t i = 0; i < set->count; ++i) {
+      const HashSetEntry *pentry = set->inline_entries + i;
+      if (hash == pentry->hash && set->key_cmp_func(key, pentry->key)) {
+        return (HashSetEntry*)pentry;
+      }
+    }
+    return NULL;
+  }
+
+  size_t capacity = set->capacity;
+  size_t index = hash & capacity;
+
+  // an entry closer to its home than the key would be to its own
+  // means that the key would have taken its place
+  for (size_t probe_length = 0;; ++probe_length) {
+    HashSetEntry *pentry = set->entries + index;
+
+    if (NULL == pentry->key || PROBE_LENGTH(pentry, index, capacity) < probe_length) {
+      return NULL;
+    }
+    if (hash == pentry->hash && set->key_cmp_func(key, pentry->key)) {
+      return pentry;
+    }
+
+    index = (index + 1) & capacity;
+  }
+}
+
+/// Places an entry with a key that is not in the entries array yet
+static void insert_entry(HashSetEntry *entries, size_t capacity, HashSetEntry entry) {
+  size_t index = entry.hash & capacity;
+
+  for (size_t probe_length = 0;; ++probe_length) {
+    HashSetEntry *pentry = entries + index;
+
+    if (NULL == pentry->key) {
+      *pentry = entry;
+      return;
+    }
+
+    size_t entry_probe_length = PROBE_LENGTH(pentry, index, capacity);
+    if (entry_probe_length < probe_length) {
+      HashSetEntry displaced = *pentry;
+      *pentry = entry;
+      entry = displaced;
+      probe_length = entry_probe_length;
+    }
+
+    index = (index + 1) & capacity;
+  }
+}
+
+/// Moves all entries, inline ones included, to a new array of @capacity + 1 entries
+static void adjust_capacity(HashSet *set, size_t capacity) {
+  HashSetEntry *entries = allocator_allocate(set->p_allocator,
+                                             sizeof(HashSetEntry) * (capacity + 1));
+  if (NULL == entries) {
+    logf_fatal("HASH_SET", 137, "allocation for hash set with capacity %lu failed!", capacity);
+  }
+  for (size_t i = 0; i <= capacity; ++i) entries[i].key = NULL;
+
+  if (set->capacity < 0) {
+    for (size_t i = 0; i < set->count; ++i) {
+      insert_entry(entries, capacity, set->inline_entries[i]);
+    }
+  }
+  for (ssize_t i = 0; i <= set->capacity; ++i) {
+    if (NULL != set->entries[i].key) insert_entry(entries, capacity, set->entries[i]);
+  }
+
+  allocator_free(set->p_allocator, set->entries);
+  set->entries = entries;
+  set->capacity = capacity;
+}
+
+static void hash_set_init_impl(HashSet *set, HashFunc hash_func, KeyCmpFunc key_cmp_func,
+                               FreeKeyFunc free_key_func, const Allocator *p_allocator) {
+  set->p_allocator = p_allocator;
+  set->hash_func = hash_func;
+  set->key_cmp_func = key_cmp_func;
+  set->free_key_func = free_key_func;
+  set->count = 0;
+  set->capacity = -1;
+  set->entries = NULL;
+}
+
+void hash_set_init(HashSet *set, HashFunc hash_func, KeyCmpFunc key_cmp_func,
+                   FreeKeyFunc free_key_func) {
+  assert(NULL != set);
+  assert(NULL != hash_func);
+  assert(NULL != key_cmp_func);
+  hash_set_init_impl(set, hash_func, key_cmp_func, free_key_func, NULL);
+}
+
+void hash_set_init_with_allocator(HashSet *set, HashFunc hash_func, KeyCmpFunc key_cmp_func,
+                                  FreeKeyFunc free_key_func, const Allocator *p_allocator) {
+  assert(NULL != set);
+  assert(NULL != hash_func);
+  assert(NULL != key_cmp_func);
+  hash_set_init_impl(set, hash_func, key_cmp_func, free_key_func, p_allocator);
+}
+
+void hash_set_free(HashSet *set) {
+  assert(NULL != set);
+  if (NULL != set->free_key_func) {
+    if (set->capacity < 0) {
+      for (size_t i = 0; i < set->count; ++i) set->free_key_func(set->inline_entries[i].key);
+    }
+    for (ssize_t i = 0; i <= set->capacity; ++i) {
+      if (NULL != set->entries[i].key) set->free_key_func(set->entries[i].key);
+    }
+  }
+  allocator_free(set->p_allocator, set->entries);
+  hash_set_init_impl(set, NULL, NULL, NULL, NULL);
+}
+
+bool hash_set_add(HashSet *set, const void *key) {
+  assert(NULL != set);
+  assert(NULL != key);
+
+  size_t hash = set->hash_func(key);
+  if (0 != set->count && NULL != find_entry(set, key, hash)) return false;
+
+  if (set->capacity < 0 && set->count < HASH_SET_INLINE_CAPACITY) {
+    set->inline_entries[set->count++] = (HashSetEntry){ key, hash };
+    return true;
+  }
+
+  if ((set->capacity + 1) * HASH_SET_MAX_LOAD <= set->count + 1) {
+    size_t capacity = set->capacity < 0 ? ARR_MIN_CAPACITY : (size_t)(set->capacity + 1) * 2;
+    adjust_capacity(set, capacity - 1);
+  }
+
+  insert_entry(set->entries, set->capacity, (HashSetEntry){ key, hash });
+  ++set->count;
+
+  return true;
+}
+
+bool hash_set_contains(const HashSet *set, const void *key) {
+  assert(NULL != set);
+  assert(NULL != key);
+
+  if (0 == set->count) return false;
+
+  return NULL != find_entry(set, key, set->hash_func(key));
+}
+
+bool hash_set_remove(HashSet *set, const void *key) {
+  assert(NULL != set);
+  assert(NULL != key);
+
+  if (0 == set->count) return false;
+
+  HashSetEntry *pentry = find_entry(set, key, set->hash_func(key));
+  if (NULL == pentry) return false;
+
+  if (NULL != set->free_key_func) set->free_key_func(pentry->key);
+
+  if (set->capacity < 0) {
+    *pentry = set->inline_entries[--set->count];
+    return true;
+  }
+
+  // backward shift: entries after the removed one move a step closer
+  // to their home bucket until an empty entry or an entry at its home
+  size_t capacity = set->capacity;
+  size_t index = pentry - set->entries;
+  for (;;) {
+    size_t next = (index + 1) & capacity;
+    HashSetEntry *pnext = set->entries + next;
+    if (NULL == pnext->key || 0 == PROBE_LENGTH(pnext, next, capacity)) break;
+
+    set->entries[index] = *pnext;
+    index = next;
+  }
+  set->entries[index].key = NULL;
+  --set->count;
+
+  return true;
+}
+
+void hash_set_add_all(HashSet *dest, const HashSet *src) {
+  assert(NULL != dest);
+  assert(NULL != src);
+
+  if (src->capacity < 0) {
+    for (size_t i = 0; i < src->count; ++i) hash_set_add(dest, src->inline_entries[i].key);
+  }
+  for (ssize_t i = 0; i <= src->capacity; ++i) {
+    if (NULL != src->entries[i].key) hash_set_add(dest, src->entries[i].key);
+  }
+}
@@ -0,0 +1,108 @@
+#ifndef __HASH_SET_H__
+#define __HASH_SET_H__
+
+#include <stddef.h>
+#include <sys/types.h>
+#include <stdbool.h>
+
+#include "allocator.h"
+#include "table.h"
+
+/// Represents a key in a HashSet
+typedef struct {
+  const void *key;
+
+  /// Hash of the key, cached so resizing does not call hash_func
+  size_t hash;
+} HashSetEntry;
+
+typedef void (*FreeKeyFunc)(const void *key);
+
+/// Number of keys a set holds without allocating
+#define HASH_SET_INLINE_CAPACITY 8
+
+/// Set of keys, a Table without values: an entry takes 16 bytes instead of 24.
+/// Probing is the same as in Table: Robin Hood linear probing
+///   and backward shift deletion.
+/// Up to HASH_SET_INLINE_CAPACITY keys are kept inside the set and scanned
+///   linearly, the entries array is allocated when there are more keys.
+typedef struct {
+  HashFunc hash_func;
+  KeyCmpFunc key_cmp_func;
+  FreeKeyFunc free_key_func;
+
+  /// Number of keys in the set
+  size_t count;
+
+  /// Capacity of entries array - 1, -1 while keys are inline
+  ssize_t capacity;
+
+  /// Array of entries, NULL while keys are inline
+  HashSetEntry *entries;
+
+  /// Keys of a set without the entries array, the first count of them are taken
+  HashSetEntry inline_entries[HASH_SET_INLINE_CAPACITY];
+
+  /// Allocator of the entries array, NULL for the global allocator
+  const Allocator *p_allocator;
+} HashSet;
+
+
+/// Initializes an empty set
+///
+/// @param set: pointer to the set to be initialized
+/// @param hash_func: pointer to the hash function for keys
+/// @param key_cmp_func: pointer to the function that compares keys for equality
+/// @param free_key_func: pointer to the callback function for freeing keys
+///   when removing key or on hash_set_free, it will not be called if NULL is passed
+/// @return void
+void hash_set_init(HashSet *set,
+                   HashFunc hash_func, KeyCmpFunc key_cmp_func,
+                   FreeKeyFunc free_key_func);
+
+/// Initializes an empty set, the entries array will be allocated
+///   in @p_allocator (NULL for the global allocator)
+///
+/// @param p_allocator: allocator handle, it has to outlive the set
+/// @see hash_set_init for the rest of parameters
+/// @return void
+void hash_set_init_with_allocator(HashSet *set,
+                                  HashFunc hash_func, KeyCmpFunc key_cmp_func,
+                                  FreeKeyFunc free_key_func,
+                                  const Allocator *p_allocator);
+
+/// Frees the entries array of the set and initializes it to zeros
+///
+/// @param set: pointer to the set to be freed
+/// @return void
+void hash_set_free(HashSet *set);
+
+/// Adds a key to the set, the set keeps the key it already has
+///
+/// @param set: pointer to the set to add to
+/// @param key: pointer to the key
+/// @return bool, true if key is new, otherwise false
+bool hash_set_add(HashSet *set, const void *key);
+
+/// Checks if the key is in the set
+///
+/// @param set: pointer to the set to look up in
+/// @param key: pointer to the key
+/// @return bool, true if the key is in the set
+bool hash_set_contains(const HashSet *set, const void *key);
+
+/// Removes the key from the set
+///
+/// @param set: pointer to the set to remove from
+/// @param key: pointer to the key
+/// @return bool, true if key was found and removed, false otherwise
+bool hash_set_remove(HashSet *set, const void *key);
+
+/// Adds all keys from src to dest
+///
+/// @param dest: destination set
+/// @param src: source set
+/// @return void
+void hash_set_add_all(HashSet *dest, const HashSet *src);
+
+#endif // !__HASH_SET_H__
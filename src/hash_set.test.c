@@ -0,0 +1,94 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "hash_set.h"
+#include "allocator.h"
+#include "logger.h"
+
+void init_allocator() {
+  size_t allocator_size = 4lu * 1024lu * 1024lu; // 4 MiB
+  if (!allocator_init(allocator_size)) {
+    abort();
+  }
+}
+
+LogSeverity g_log_severity = LOG_ALL;
+
+bool key_cmp_cstr(const void *lhs, const void *rhs) {
+  return 0 == strcmp(lhs, rhs);
+}
+
+static size_t g_freed_count;
+
+void free_key_count(const void *key) {
+  (void)key;
+  ++g_freed_count;
+}
+
+#define KEYS_COUNT 1000
+
+int main() {
+  init_allocator();
+  atexit(allocator_finalize);
+
+  static char keys[KEYS_COUNT][16];
+  for (size_t i = 0; i < KEYS_COUNT; ++i) snprintf(keys[i], sizeof(keys[i]), "key_%zu", i);
+
+  HashSet set;
+  hash_set_init(&set, hash_cstr_default, key_cmp_cstr, free_key_count);
+  assert(!hash_set_contains(&set, keys[0]));
+  assert(!hash_set_remove(&set, keys[0]));
+
+  // small sets keep keys inline and do not allocate
+  AllocatorStats before, after;
+  allocator_get_stats(&before);
+  for (size_t i = 0; i < HASH_SET_INLINE_CAPACITY; ++i) {
+    assert(hash_set_add(&set, keys[i]));
+    assert(!hash_set_add(&set, keys[i]));
+  }
+  assert(hash_set_remove(&set, keys[0]));
+  assert(!hash_set_contains(&set, keys[0]));
+  assert(hash_set_add(&set, keys[0]));
+  allocator_get_stats(&after);
+  assert(before.allocs_count == after.allocs_count);
+  assert(NULL == set.entries);
+  assert(1 == g_freed_count);
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    assert((i >= HASH_SET_INLINE_CAPACITY) == hash_set_add(&set, keys[i]));
+  }
+  assert(KEYS_COUNT == set.count);
+  assert(NULL != set.entries);
+
+  char lookup[16];
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    snprintf(lookup, sizeof(lookup), "key_%zu", i);
+    assert(hash_set_contains(&set, lookup));
+  }
+  assert(!hash_set_contains(&set, "missing"));
+
+  for (size_t i = 0; i < KEYS_COUNT; i += 2) {
+    assert(hash_set_remove(&set, keys[i]));
+    assert(!hash_set_remove(&set, keys[i]));
+  }
+  assert(KEYS_COUNT / 2 == set.count);
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    assert((i % 2 == 1) == hash_set_contains(&set, keys[i]));
+  }
+
+  HashSet copy;
+  hash_set_init(&copy, hash_cstr_default, key_cmp_cstr, NULL);
+  hash_set_add_all(&copy, &set);
+  assert(KEYS_COUNT / 2 == copy.count);
+  assert(hash_set_contains(&copy, keys[1]));
+  hash_set_free(&copy);
+
+  g_freed_count = 0;
+  hash_set_free(&set);
+  assert(KEYS_COUNT / 2 == g_freed_count);
+  assert(0 == set.count);
+
+  return 0;
+}
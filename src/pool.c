@@ -0,0 +1,78 @@
+#include <assert.h>
+
+#include "pool.h"
+#include "allocator.h"
+
+#define WORD_SIZE (sizeof(size_t))
+
+/// Chunk starts with the link to the previous chunk, slots follow it
+#define CHUNK_HEADER_SIZE WORD_SIZE
+
+void pool_init(Pool *p_pool, size_t slot_size, size_t slots_per_chunk) {
+  assert(NULL != p_pool);
+  assert(slot_size > 0);
+
+  if (slot_size < sizeof(void*)) slot_size = sizeof(void*);
+  slot_size = (slot_size + WORD_SIZE - 1) & ~(WORD_SIZE - 1);
+
+  p_pool->slot_size = slot_size;
+  p_pool->slots_per_chunk = 0 == slots_per_chunk 
+    ? POOL_DEFAULT_SLOTS_PER_CHUNK 
+    : slots_per_chunk;
+  p_pool->free_list = NULL;
+  p_pool->chunks = NULL;
+  p_pool->p_unused_begin = NULL;
+  p_pool->p_unused_end = NULL;
+  p_pool->taken_count = 0;
+}
+
+void pool_finalize(Pool *p_pool) {
+  assert(NULL != p_pool);
+
+  void *chunk = p_pool->chunks;
+  while (NULL != chunk) {
+    void *prev = *(void**)chunk;
+    a_free(chunk);
+    chunk = prev;
+  }
+
+  pool_init(p_pool, p_pool->slot_size, p_pool->slots_per_chunk);
+}
+
+void *pool_alloc(Pool *p_pool) {
+  assert(NULL != p_pool);
+
+  void *slot = p_pool->free_list;
+  if (NULL != slot) {
+    p_pool->free_list = *(void**)slot;
+    ++p_pool->taken_count;
+    return slot;
+  }
+
+  if (p_pool->p_unused_begin == p_pool->p_unused_end) {
+    size_t chunk_size = CHUNK_HEADER_SIZE + p_pool->slot_size * p_pool->slots_per_chunk;
+    char *chunk = a_allocate(chunk_size);
+    if (NULL == chunk) return NULL;
+
+    *(void**)chunk = p_pool->chunks;
+    p_pool->chunks = chunk;
+    p_pool->p_unused_begin = chunk + CHUNK_HEADER_SIZE;
+    p_pool->p_unused_end = chunk + chunk_size;
+  }
+
+  slot = p_pool->p_unused_begin;
+  p_pool->p_unused_begin += p_pool->slot_size;
+  ++p_pool->taken_count;
+  return slot;
+}
+
+void pool_free(Pool *p_pool, void *ptr) {
+  assert(NULL != p_pool);
+
+  if (NULL == ptr) return;
+
+  assert(p_pool->taken_count > 0);
+  *(void**)ptr = p_pool->free_list;
+  p_pool->free_list = ptr;
+  --p_pool->taken_count;
+}
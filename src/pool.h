@@ -0,0 +1,62 @@
+#ifndef __POOL_H__
+#define __POOL_H__
+
+#include <stddef.h>
+
+#define POOL_DEFAULT_SLOTS_PER_CHUNK 64
+
+/// Fixed size object pool.
+/// Slots carry no header, a free slot holds the link to the next free slot.
+/// Memory is requested from the global allocator in chunks of
+///   slots_per_chunk slots and is given back only by pool_finalize.
+typedef struct {
+  /// Size of one slot, word alligned
+  size_t slot_size;
+
+  /// Number of slots in every chunk requested from the allocator
+  size_t slots_per_chunk;
+
+  /// Head of the list of freed slots
+  void *free_list;
+
+  /// List of all chunks, linked through their first word
+  void *chunks;
+
+  /// Part of the newest chunk that was never handed out
+  char *p_unused_begin;
+  char *p_unused_end;
+
+  /// Number of slots currently handed out
+  size_t taken_count;
+} Pool;
+
+
+/// Initializes an empty pool, no memory is allocated until the first pool_alloc
+///
+/// @param p_pool: pointer to the pool to be initialized
+/// @param slot_size: size of objects stored in the pool
+/// @param slots_per_chunk: number of slots allocated at once when the pool runs out,
+///   POOL_DEFAULT_SLOTS_PER_CHUNK is used if 0 is passed
+/// @return void
+void pool_init(Pool *p_pool, size_t slot_size, size_t slots_per_chunk);
+
+/// Frees all chunks of the pool, every slot becomes invalid
+///
+/// @param p_pool: pointer to the pool to be finalized
+/// @return void
+void pool_finalize(Pool *p_pool);
+
+/// Takes a slot from the pool
+///
+/// @param p_pool: pointer to the pool to allocate from
+/// @return void*, pointer to slot_size bytes or NULL if allocator is out of memory
+void *pool_alloc(Pool *p_pool);
+
+/// Returns a slot to the pool
+///
+/// @param p_pool: pointer to the pool @ptr was allocated from
+/// @param ptr: pointer to the slot, NULL is ignored
+/// @return void
+void pool_free(Pool *p_pool, void *ptr);
+
+#endif // !__POOL_H__
@@ -0,0 +1,73 @@
+#include <assert.h>
+#include <stdlib.h>
+
+#include "pool.h"
+#include "allocator.h"
+#include "logger.h"
+
+typedef struct {
+  size_t id;
+  double weight;
+  void *p_next;
+} Node;
+
+void init_allocator() {
+  size_t allocator_size = 4lu * 1024lu * 1024lu; // 4 MiB
+  if (!allocator_init(allocator_size)) {
+    abort();
+  }
+}
+
+LogSeverity g_log_severity = LOG_ALL;
+
+#define NODES_COUNT 100
+
+int main() {
+  init_allocator();
+  atexit(allocator_finalize);
+
+  Pool pool;
+  pool_init(&pool, sizeof(Node), 16);
+  assert(0 == pool.taken_count);
+  assert(NULL == pool.chunks);
+
+  Node *nodes[NODES_COUNT];
+  for (size_t i = 0; i < NODES_COUNT; ++i) {
+    nodes[i] = pool_alloc(&pool);
+    assert(NULL != nodes[i]);
+    nodes[i]->id = i;
+    nodes[i]->weight = (double)i / 2;
+    nodes[i]->p_next = NULL;
+  }
+
+  assert(NODES_COUNT == pool.taken_count);
+
+  // slots do not overlap
+  for (size_t i = 0; i < NODES_COUNT; ++i) {
+    assert(i == nodes[i]->id);
+  }
+
+  // freed slots are reused first, most recently freed first
+  pool_free(&pool, nodes[10]);
+  pool_free(&pool, nodes[20]);
+  assert(NODES_COUNT - 2 == pool.taken_count);
+
+  Node *reused = pool_alloc(&pool);
+  assert(reused == nodes[20]);
+  reused = pool_alloc(&pool);
+  assert(reused == nodes[10]);
+
+  for (size_t i = 0; i < NODES_COUNT; ++i) {
+    pool_free(&pool, nodes[i]);
+  }
+  assert(0 == pool.taken_count);
+
+  pool_finalize(&pool);
+  assert(NULL == pool.chunks);
+
+  VsaFragmentation frag;
+  allocator_get_fragmentation(&frag);
+  assert(1 == frag.free_blocks_count);
+
+  return 0;
+}
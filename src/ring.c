@@ -0,0 +1,48 @@
+#include <assert.h>
+
+#include "ring.h"
+#include "logger.h"
+
+void *ring_allocate(size_t el_size, size_t capacity, RingKind kind, const Allocator *p_allocator) {
+  assert(capacity > 0 && "Capacity should be greater than 0.");
+  assert(el_size > 0);
+
+  size_t rounded = 1;
+  while (rounded < capacity) rounded *= 2;
+  capacity = rounded;
+
+  // sequences follow the elements, aligned to size_t
+  size_t elements_size = capacity * el_size;
+  size_t sequences_offset = (elements_size + sizeof(size_t) - 1) & ~(sizeof(size_t) - 1);
+  size_t bytes = sizeof(RingHeader) + sequences_offset;
+  if (RING_MPMC == kind) bytes += capacity * sizeof(size_t);
+
+  RingHeader *p_header = allocator_allocate_aligned(p_allocator, bytes, RING_CACHE_LINE);
+  if (NULL == p_header) {
+    logf_fatal("RING", 137, "allocation for ring with capacity %lu failed!", capacity);
+  }
+
+  p_header->tail = 0;
+  p_header->cached_head = 0;
+  p_header->head = 0;
+  p_header->cached_tail = 0;
+  p_header->mask = capacity - 1;
+  p_header->kind = kind;
+  p_header->p_allocator = p_allocator;
+  p_header->sequences = NULL;
+
+  void *ring = p_header + 1;
+  if (RING_MPMC == kind) {
+    p_header->sequences = (size_t*)((char*)ring + sequences_offset);
+    for (size_t i = 0; i < capacity; ++i) p_header->sequences[i] = i;
+  }
+
+  return ring;
+}
+
+void ring_free_impl(void *ring) {
+  assert(NULL != ring);
+
+  RingHeader *p_header = ring_get_header(ring);
+  allocator_free(p_header->p_allocator, p_header);
+}
@@ -0,0 +1,346 @@
+#ifndef __RING_H__
+#define __RING_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#include "allocator.h"
+
+/// Fixed capacity ring buffer queues, stored like vec: a header followed
+///   by the elements, ring(T) is a pointer to the first element slot.
+///
+/// Three variants share the layout and differ in who may use them:
+///   ring(T)      - one thread, ring_* functions;
+///   spsc_ring(T) - one producer and one consumer thread, lock-free,
+///                  spsc_ring_* functions;
+///   mpmc_ring(T) - any number of producers and consumers, lock-free
+///                  bounded queue of Dmitry Vyukov, mpmc_ring_* functions.
+/// Elements are passed by pointer and copied in and out, push fails when the
+///   ring is full and pop fails when it is empty, nothing blocks.
+/// Batched push_many/pop_many move as many elements as fit in one go and
+///   publish them with a single atomic store (or CAS for mpmc).
+///
+/// Producer and consumer positions live on separate cache lines,
+///   so the two sides do not invalidate each other's line on every operation.
+///
+/// Example:
+///   spsc_ring(Job) jobs;
+///   spsc_ring_alloc(jobs, 1024);
+///   spsc_ring_push(jobs, &job);        // producer thread
+///   while (!spsc_ring_pop(jobs, &job)) // consumer thread
+///     ;
+///   ring_free(jobs);
+
+#define RING_CACHE_LINE 64
+
+typedef enum {
+  RING_SINGLE,
+  RING_SPSC,
+  RING_MPMC,
+} RingKind;
+
+typedef struct {
+  /// Position the next element is pushed at, it only grows
+  _Alignas(RING_CACHE_LINE) size_t tail;
+
+  /// spsc: head as the producer saw it last time, refreshed when the ring looks full
+  size_t cached_head;
+
+  /// Position the next element is popped from, it only grows
+  _Alignas(RING_CACHE_LINE) size_t head;
+
+  /// spsc: tail as the consumer saw it last time, refreshed when the ring looks empty
+  size_t cached_tail;
+
+  /// Capacity - 1, capacity is a power of two
+  _Alignas(RING_CACHE_LINE) size_t mask;
+
+  /// mpmc: sequence number of each slot, NULL for other kinds
+  size_t *sequences;
+
+  RingKind kind;
+
+  /// Allocator the ring lives in, NULL for the global allocator
+  const Allocator *p_allocator;
+} RingHeader;
+
+#define ring(T) T*
+#define spsc_ring(T) T*
+#define mpmc_ring(T) T*
+
+#define ring_get_header(r) (((RingHeader*)(r)) - 1)
+
+/// Allocates a ring of @kind for @capacity elements (rounded up to a power of two)
+///
+/// @return void*, pointer to the first element slot, the header is before it
+void *ring_allocate(size_t el_size, size_t capacity, RingKind kind, const Allocator *p_allocator);
+
+/// Frees a ring of any kind, no thread may use it anymore
+void ring_free_impl(void *ring);
+
+#define ring_alloc(r, cap) ring_alloc_with((r), (cap), NULL)
+#define spsc_ring_alloc(r, cap) spsc_ring_alloc_with((r), (cap), NULL)
+#define mpmc_ring_alloc(r, cap) mpmc_ring_alloc_with((r), (cap), NULL)
+
+/// Allocate a ring in @allocator (const Allocator*), it has to outlive the ring
+#define ring_alloc_with(r, cap, allocator) \
+  ((r) = ring_allocate(sizeof(*(r)), (cap), RING_SINGLE, (allocator)))
+#define spsc_ring_alloc_with(r, cap, allocator) \
+  ((r) = ring_allocate(sizeof(*(r)), (cap), RING_SPSC, (allocator)))
+#define mpmc_ring_alloc_with(r, cap, allocator) \
+  ((r) = ring_allocate(sizeof(*(r)), (cap), RING_MPMC, (allocator)))
+
+#define ring_free(r) ring_free_impl((r))
+
+#define ring_capacity(r) (ring_get_header((r))->mask + 1)
+
+/// Number of elements, only a snapshot for spsc and mpmc rings
+#define ring_count(r) ring_count_impl((r))
+#define ring_is_empty(r) (0 == ring_count((r)))
+
+/// Fails to compile if *(p) cannot be assigned to an element of @r
+#define RING_CHECK_TYPE(r, p) ((void)sizeof(*(r) = *(p)))
+
+/// Copies *@p_e to the ring
+/// @return bool, false if the ring is full
+#define ring_push(r, p_e) \
+  (RING_CHECK_TYPE((r), (p_e)), ring_push_impl((r), (p_e), sizeof(*(r))))
+
+/// Moves the oldest element to *@p_out
+/// @return bool, false if the ring is empty
+#define ring_pop(r, p_out) \
+  (RING_CHECK_TYPE((r), (p_out)), ring_pop_impl((r), (p_out), sizeof(*(r))))
+
+/// Copies up to @n elements from @p_items to the ring
+/// @return size_t, number of pushed elements, the first ones of @p_items
+#define ring_push_many(r, p_items, n) \
+  (RING_CHECK_TYPE((r), (p_items)), ring_push_many_impl((r), (p_items), (n), sizeof(*(r))))
+
+/// Moves up to @n oldest elements to @p_out
+/// @return size_t, number of popped elements
+#define ring_pop_many(r, p_out, n) \
+  (RING_CHECK_TYPE((r), (p_out)), ring_pop_many_impl((r), (p_out), (n), sizeof(*(r))))
+
+/// Same as ring_push, ring_pop, ring_push_many and ring_pop_many
+///   for a spsc ring, push on the producer thread and pop on the consumer one
+#define spsc_ring_push(r, p_e) \
+  (RING_CHECK_TYPE((r), (p_e)), spsc_ring_push_impl((r), (p_e), sizeof(*(r))))
+#define spsc_ring_pop(r, p_out) \
+  (RING_CHECK_TYPE((r), (p_out)), spsc_ring_pop_impl((r), (p_out), sizeof(*(r))))
+#define spsc_ring_push_many(r, p_items, n) \
+  (RING_CHECK_TYPE((r), (p_items)), spsc_ring_push_many_impl((r), (p_items), (n), sizeof(*(r))))
+#define spsc_ring_pop_many(r, p_out, n) \
+  (RING_CHECK_TYPE((r), (p_out)), spsc_ring_pop_many_impl((r), (p_out), (n), sizeof(*(r))))
+
+/// Same as ring_push, ring_pop, ring_push_many and ring_pop_many
+///   for a mpmc ring, any thread may call them
+#define mpmc_ring_push(r, p_e) \
+  (RING_CHECK_TYPE((r), (p_e)), mpmc_ring_push_impl((r), (p_e), sizeof(*(r))))
+#define mpmc_ring_pop(r, p_out) \
+  (RING_CHECK_TYPE((r), (p_out)), mpmc_ring_pop_impl((r), (p_out), sizeof(*(r))))
+#define mpmc_ring_push_many(r, p_items, n) \
+  (RING_CHECK_TYPE((r), (p_items)), mpmc_ring_push_many_impl((r), (p_items), (n), sizeof(*(r))))
+#define mpmc_ring_pop_many(r, p_out, n) \
+  (RING_CHECK_TYPE((r), (p_out)), mpmc_ring_pop_many_impl((r), (p_out), (n), sizeof(*(r))))
+
+#define RING_LOAD(ptr) __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define RING_LOAD_RELAXED(ptr) __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define RING_STORE(ptr, value) __atomic_store_n((ptr), (value), __ATOMIC_RELEASE)
+#define RING_CAS(ptr, p_expected, desired) \
+  __atomic_compare_exchange_n((ptr), (p_expected), (desired), true, \
+                              __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+
+// Functions below are static inline so el_size is a constant after inlining
+//   and copying an element compiles to plain moves.
+
+static inline size_t ring_count_impl(const void *ring) {
+  const RingHeader *p_header = ring_get_header(ring);
+  size_t head = RING_LOAD(&p_header->head);
+  size_t tail = RING_LOAD(&p_header->tail);
+  // head is loaded first, so a concurrent pop cannot make it pass tail
+  return tail - head;
+}
+
+/// Copies @count elements from @p_items to slots starting at position @pos
+static inline void ring_copy_in(void *ring, size_t mask, size_t pos,
+                                const void *p_items, size_t count, size_t el_size) {
+  size_t index = pos & mask;
+  size_t first_count = mask + 1 - index < count ? mask + 1 - index : count;
+  memcpy((char*)ring + index * el_size, p_items, first_count * el_size);
+  memcpy(ring, (const char*)p_items + first_count * el_size, (count - first_count) * el_size);
+}
+
+/// Copies @count elements from slots starting at position @pos to @p_out
+static inline void ring_copy_out(const void *ring, size_t mask, size_t pos,
+                                 void *p_out, size_t count, size_t el_size) {
+  size_t index = pos & mask;
+  size_t first_count = mask + 1 - index < count ? mask + 1 - index : count;
+  memcpy(p_out, (const char*)ring + index * el_size, first_count * el_size);
+  memcpy((char*)p_out + first_count * el_size, ring, (count - first_count) * el_size);
+}
+
+static inline size_t ring_push_many_impl(void *ring, const void *p_items, size_t count,
+                                         size_t el_size) {
+  RingHeader *p_header = ring_get_header(ring);
+  assert(RING_SINGLE == p_header->kind);
+
+  size_t free_count = p_header->mask + 1 - (p_header->tail - p_header->head);
+  if (count > free_count) count = free_count;
+
+  ring_copy_in(ring, p_header->mask, p_header->tail, p_items, count, el_size);
+  p_header->tail += count;
+  return count;
+}
+
+static inline size_t ring_pop_many_impl(void *ring, void *p_out, size_t count, size_t el_size) {
+  RingHeader *p_header = ring_get_header(ring);
+  assert(RING_SINGLE == p_header->kind);
+
+  size_t used_count = p_header->tail - p_header->head;
+  if (count > used_count) count = used_count;
+
+  ring_copy_out(ring, p_header->mask, p_header->head, p_out, count, el_size);
+  p_header->head += count;
+  return count;
+}
+
+static inline bool ring_push_impl(void *ring, const void *p_e, size_t el_size) {
+  return 1 == ring_push_many_impl(ring, p_e, 1, el_size);
+}
+
+static inline bool ring_pop_impl(void *ring, void *p_out, size_t el_size) {
+  return 1 == ring_pop_many_impl(ring, p_out, 1, el_size);
+}
+
+static inline size_t spsc_ring_push_many_impl(void *ring, const void *p_items, size_t count,
+                                              size_t el_size) {
+  RingHeader *p_header = ring_get_header(ring);
+  assert(RING_SPSC == p_header->kind);
+
+  // only the producer writes tail
+  size_t tail = RING_LOAD_RELAXED(&p_header->tail);
+  size_t capacity = p_header->mask + 1;
+  if (capacity - (tail - p_header->cached_head) < count) {
+    p_header->cached_head = RING_LOAD(&p_header->head);
+  }
+  size_t free_count = capacity - (tail - p_header->cached_head);
+  if (count > free_count) count = free_count;
+  if (0 == count) return 0;
+
+  ring_copy_in(ring, p_header->mask, tail, p_items, count, el_size);
+  RING_STORE(&p_header->tail, tail + count);
+  return count;
+}
+
+static inline size_t spsc_ring_pop_many_impl(void *ring, void *p_out, size_t count,
+                                             size_t el_size) {
+  RingHeader *p_header = ring_get_header(ring);
+  assert(RING_SPSC == p_header->kind);
+
+  // only the consumer writes head
+  size_t head = RING_LOAD_RELAXED(&p_header->head);
+  if (p_header->cached_tail - head < count) {
+    p_header->cached_tail = RING_LOAD(&p_header->tail);
+  }
+  size_t used_count = p_header->cached_tail - head;
+  if (count > used_count) count = used_count;
+  if (0 == count) return 0;
+
+  ring_copy_out(ring, p_header->mask, head, p_out, count, el_size);
+  RING_STORE(&p_header->head, head + count);
+  return count;
+}
+
+static inline bool spsc_ring_push_impl(void *ring, const void *p_e, size_t el_size) {
+  return 1 == spsc_ring_push_many_impl(ring, p_e, 1, el_size);
+}
+
+static inline bool spsc_ring_pop_impl(void *ring, void *p_out, size_t el_size) {
+  return 1 == spsc_ring_pop_many_impl(ring, p_out, 1, el_size);
+}
+
+// mpmc: a slot at position pos is free for the producer of pos when its
+//   sequence is pos and holds an element for the consumer of pos when its
+//   sequence is pos + 1. The consumer sets it to pos + capacity,
+//   freeing the slot for the producer of the next lap.
+
+static inline size_t mpmc_ring_push_many_impl(void *ring, const void *p_items, size_t count,
+                                              size_t el_size) {
+  RingHeader *p_header = ring_get_header(ring);
+  assert(RING_MPMC == p_header->kind);
+
+  // the loop below takes claiming nothing for losing a free slot
+  // to another thread and would retry forever
+  if (0 == count) return 0;
+
+  size_t mask = p_header->mask;
+  size_t *sequences = p_header->sequences;
+  size_t pos = RING_LOAD_RELAXED(&p_header->tail);
+  size_t claimed;
+  for (;;) {
+    // free slots following tail can only be claimed by moving tail over them
+    claimed = 0;
+    while (claimed < count && RING_LOAD(&sequences[(pos + claimed) & mask]) == pos + claimed) {
+      ++claimed;
+    }
+    if (0 == claimed) {
+      size_t sequence = RING_LOAD(&sequences[pos & mask]);
+      // a slot not freed by the consumer of the previous lap, the ring is full
+      if ((ptrdiff_t)(sequence - pos) < 0) return 0;
+      pos = RING_LOAD_RELAXED(&p_header->tail);
+      continue;
+    }
+    if (RING_CAS(&p_header->tail, &pos, pos + claimed)) break;
+  }
+
+  ring_copy_in(ring, mask, pos, p_items, claimed, el_size);
+  for (size_t i = 0; i < claimed; ++i) RING_STORE(&sequences[(pos + i) & mask], pos + i + 1);
+  return claimed;
+}
+
+static inline size_t mpmc_ring_pop_many_impl(void *ring, void *p_out, size_t count,
+                                             size_t el_size) {
+  RingHeader *p_header = ring_get_header(ring);
+  assert(RING_MPMC == p_header->kind);
+
+  // the same as in mpmc_ring_push_many_impl for an element not taken yet
+  if (0 == count) return 0;
+
+  size_t mask = p_header->mask;
+  size_t *sequences = p_header->sequences;
+  size_t pos = RING_LOAD_RELAXED(&p_header->head);
+  size_t claimed;
+  for (;;) {
+    claimed = 0;
+    while (claimed < count
+           && RING_LOAD(&sequences[(pos + claimed) & mask]) == pos + claimed + 1) {
+      ++claimed;
+    }
+    if (0 == claimed) {
+      size_t sequence = RING_LOAD(&sequences[pos & mask]);
+      // a slot not filled by its producer yet, the ring is empty
+      if ((ptrdiff_t)(sequence - (pos + 1)) < 0) return 0;
+      pos = RING_LOAD_RELAXED(&p_header->head);
+      continue;
+    }
+    if (RING_CAS(&p_header->head, &pos, pos + claimed)) break;
+  }
+
+  ring_copy_out(ring, mask, pos, p_out, claimed, el_size);
+  for (size_t i = 0; i < claimed; ++i) {
+    RING_STORE(&sequences[(pos + i) & mask], pos + i + mask + 1);
+  }
+  return claimed;
+}
+
+static inline bool mpmc_ring_push_impl(void *ring, const void *p_e, size_t el_size) {
+  return 1 == mpmc_ring_push_many_impl(ring, p_e, 1, el_size);
+}
+
+static inline bool mpmc_ring_pop_impl(void *ring, void *p_out, size_t el_size) {
+  return 1 == mpmc_ring_pop_many_impl(ring, p_out, 1, el_size);
+}
+
+#endif // !__RING_H__
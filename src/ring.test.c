@@ -0,0 +1,284 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "ring.h"
+#include "allocator.h"
+#include "logger.h"
+
+void init_allocator() {
+  size_t allocator_size = 4lu * 1024lu * 1024lu; // 4 MiB
+  if (!allocator_init(allocator_size)) {
+    abort();
+  }
+}
+
+LogSeverity g_log_severity = LOG_ALL;
+
+typedef struct {
+  size_t producer;
+  size_t value;
+} Item;
+
+void test_single() {
+  ring(int) r;
+  ring_alloc(r, 5);
+  assert(8 == ring_capacity(r));
+  assert(ring_is_empty(r));
+  assert(0 == (size_t)r % RING_CACHE_LINE);
+
+  int value = 0;
+  assert(!ring_pop(r, &value));
+
+  // positions wrap around the slots several times
+  int next_push = 0, next_pop = 0;
+  for (int round = 0; round < 20; ++round) {
+    while (ring_push(r, &next_push)) ++next_push;
+    assert(8 == ring_count(r));
+    for (int i = 0; i < 5; ++i) {
+      assert(ring_pop(r, &value));
+      assert(next_pop++ == value);
+    }
+  }
+
+  // batches are cut to free slots and to elements present
+  int items[16], out[16];
+  for (int i = 0; i < 16; ++i) items[i] = 1000 + i;
+  assert(5 == ring_push_many(r, items, 16));
+  assert(0 == ring_push_many(r, items, 16));
+  assert(3 == ring_pop_many(r, out, 3));
+  for (int i = 0; i < 3; ++i) assert(next_pop++ == out[i]);
+  assert(5 == ring_pop_many(r, out, 16));
+  for (int i = 0; i < 5; ++i) assert(1000 + i == out[i]);
+  assert(ring_is_empty(r));
+  assert(0 == ring_pop_many(r, out, 16));
+
+  // empty batches do nothing, whether the ring is empty, full or neither
+  assert(0 == ring_push_many(r, items, 0));
+  assert(0 == ring_pop_many(r, out, 0));
+  assert(1 == ring_push_many(r, items, 1));
+  assert(0 == ring_push_many(r, items, 0));
+  assert(0 == ring_pop_many(r, out, 0));
+  assert(1 == ring_count(r));
+  assert(7 == ring_push_many(r, items, 16));
+  assert(0 == ring_push_many(r, items, 0));
+  assert(0 == ring_pop_many(r, out, 0));
+  assert(8 == ring_pop_many(r, out, 16));
+
+  ring_free(r);
+}
+
+void test_kinds_single_threaded() {
+  spsc_ring(Item) spsc;
+  spsc_ring_alloc(spsc, 16);
+  mpmc_ring(Item) mpmc;
+  mpmc_ring_alloc(mpmc, 16);
+
+  Item items[40], out[40];
+  for (size_t i = 0; i < 40; ++i) items[i] = (Item){ 0, i };
+
+  size_t spsc_pushed = 0, spsc_popped = 0, mpmc_pushed = 0, mpmc_popped = 0;
+  for (int round = 0; round < 10; ++round) {
+    spsc_pushed += spsc_ring_push_many(spsc, items, 40);
+    mpmc_pushed += mpmc_ring_push_many(mpmc, items, 40);
+    assert(16 == spsc_pushed - spsc_popped);
+    assert(16 == mpmc_pushed - mpmc_popped);
+    assert(!spsc_ring_push(spsc, items));
+    assert(!mpmc_ring_push(mpmc, items));
+
+    size_t popped = spsc_ring_pop_many(spsc, out, 7);
+    assert(7 == popped);
+    for (size_t i = 0; i < popped; ++i) assert(i == out[i].value);
+    spsc_popped += popped;
+    popped = mpmc_ring_pop_many(mpmc, out, 7);
+    assert(7 == popped);
+    for (size_t i = 0; i < popped; ++i) assert(i == out[i].value);
+    mpmc_popped += popped;
+
+    Item item;
+    while (spsc_ring_pop(spsc, &item)) ++spsc_popped;
+    while (mpmc_ring_pop(mpmc, &item)) ++mpmc_popped;
+    assert(spsc_pushed == spsc_popped);
+    assert(mpmc_pushed == mpmc_popped);
+    assert(ring_is_empty(spsc));
+    assert(ring_is_empty(mpmc));
+  }
+
+  // empty batches do nothing, whether the ring is empty, full or neither
+  for (size_t filled = 0; filled <= 16; filled += 8) {
+    assert(filled == spsc_ring_push_many(spsc, items, filled));
+    assert(filled == mpmc_ring_push_many(mpmc, items, filled));
+    assert(0 == spsc_ring_push_many(spsc, items, 0));
+    assert(0 == mpmc_ring_push_many(mpmc, items, 0));
+    assert(0 == spsc_ring_pop_many(spsc, out, 0));
+    assert(0 == mpmc_ring_pop_many(mpmc, out, 0));
+    assert(filled == ring_count(spsc));
+    assert(filled == ring_count(mpmc));
+    assert(filled == spsc_ring_pop_many(spsc, out, 40));
+    assert(filled == mpmc_ring_pop_many(mpmc, out, 40));
+  }
+
+  ring_free(spsc);
+  ring_free(mpmc);
+}
+
+#define ITEMS_PER_PRODUCER 200000
+#define MAX_THREADS 4
+
+typedef struct {
+  Item *ring;
+  size_t producer;
+  size_t batch_size;
+  size_t consumed_count;
+  /// Sum of consumed values and the last value seen from each producer
+  size_t sum;
+  size_t last_values[MAX_THREADS];
+  bool is_ordered;
+} ThreadCtx;
+
+static size_t g_consumed_total;
+static size_t g_consumers_goal;
+
+void *spsc_producer(void *arg) {
+  ThreadCtx *p_ctx = arg;
+  Item batch[64];
+  for (size_t value = 1; value <= ITEMS_PER_PRODUCER;) {
+    size_t count = 0;
+    for (; count < p_ctx->batch_size && value + count <= ITEMS_PER_PRODUCER; ++count) {
+      batch[count] = (Item){ 0, value + count };
+    }
+    size_t pushed = 0;
+    while (pushed < count) {
+      size_t n = spsc_ring_push_many(p_ctx->ring, batch + pushed, count - pushed);
+      if (0 == n) sched_yield();
+      pushed += n;
+    }
+    value += count;
+  }
+  return NULL;
+}
+
+void *spsc_consumer(void *arg) {
+  ThreadCtx *p_ctx = arg;
+  Item batch[64];
+  size_t expected = 1;
+  while (expected <= ITEMS_PER_PRODUCER) {
+    size_t n = spsc_ring_pop_many(p_ctx->ring, batch, p_ctx->batch_size);
+    if (0 == n) sched_yield();
+    for (size_t i = 0; i < n; ++i) {
+      if (expected++ != batch[i].value) p_ctx->is_ordered = false;
+    }
+  }
+  return NULL;
+}
+
+void test_spsc_threads(size_t batch_size) {
+  ThreadCtx producer = { .batch_size = batch_size };
+  ThreadCtx consumer = { .batch_size = batch_size, .is_ordered = true };
+  spsc_ring_alloc(producer.ring, 256);
+  consumer.ring = producer.ring;
+
+  pthread_t threads[2];
+  pthread_create(&threads[0], NULL, spsc_producer, &producer);
+  pthread_create(&threads[1], NULL, spsc_consumer, &consumer);
+  pthread_join(threads[0], NULL);
+  pthread_join(threads[1], NULL);
+
+  assert(consumer.is_ordered);
+  assert(ring_is_empty(producer.ring));
+  ring_free(producer.ring);
+}
+
+void *mpmc_producer(void *arg) {
+  ThreadCtx *p_ctx = arg;
+  Item batch[64];
+  for (size_t value = 1; value <= ITEMS_PER_PRODUCER;) {
+    size_t count = 0;
+    for (; count < p_ctx->batch_size && value + count <= ITEMS_PER_PRODUCER; ++count) {
+      batch[count] = (Item){ p_ctx->producer, value + count };
+    }
+    size_t pushed = 0;
+    while (pushed < count) {
+      size_t n = mpmc_ring_push_many(p_ctx->ring, batch + pushed, count - pushed);
+      if (0 == n) sched_yield();
+      pushed += n;
+    }
+    value += count;
+  }
+  return NULL;
+}
+
+void *mpmc_consumer(void *arg) {
+  ThreadCtx *p_ctx = arg;
+  Item batch[64];
+  while (__atomic_load_n(&g_consumed_total, __ATOMIC_RELAXED) < g_consumers_goal) {
+    size_t n = mpmc_ring_pop_many(p_ctx->ring, batch, p_ctx->batch_size);
+    if (0 == n) {
+      sched_yield();
+      continue;
+    }
+    for (size_t i = 0; i < n; ++i) {
+      // elements of one producer are popped in the order they were pushed
+      size_t producer = batch[i].producer;
+      if (batch[i].value <= p_ctx->last_values[producer]) p_ctx->is_ordered = false;
+      p_ctx->last_values[producer] = batch[i].value;
+      p_ctx->sum += batch[i].value;
+    }
+    p_ctx->consumed_count += n;
+    __atomic_fetch_add(&g_consumed_total, n, __ATOMIC_RELAXED);
+  }
+  return NULL;
+}
+
+void test_mpmc_threads(size_t producers_count, size_t consumers_count, size_t batch_size) {
+  mpmc_ring(Item) r;
+  mpmc_ring_alloc(r, 128);
+  g_consumed_total = 0;
+  g_consumers_goal = producers_count * ITEMS_PER_PRODUCER;
+
+  ThreadCtx producers[MAX_THREADS], consumers[MAX_THREADS];
+  pthread_t producer_threads[MAX_THREADS], consumer_threads[MAX_THREADS];
+  for (size_t i = 0; i < consumers_count; ++i) {
+    consumers[i] = (ThreadCtx){ .ring = r, .batch_size = batch_size, .is_ordered = true };
+    pthread_create(&consumer_threads[i], NULL, mpmc_consumer, &consumers[i]);
+  }
+  for (size_t i = 0; i < producers_count; ++i) {
+    producers[i] = (ThreadCtx){ .ring = r, .producer = i, .batch_size = batch_size };
+    pthread_create(&producer_threads[i], NULL, mpmc_producer, &producers[i]);
+  }
+  for (size_t i = 0; i < producers_count; ++i) pthread_join(producer_threads[i], NULL);
+  for (size_t i = 0; i < consumers_count; ++i) pthread_join(consumer_threads[i], NULL);
+
+  // every element is consumed exactly once
+  size_t consumed_count = 0, sum = 0;
+  for (size_t i = 0; i < consumers_count; ++i) {
+    assert(consumers[i].is_ordered);
+    consumed_count += consumers[i].consumed_count;
+    sum += consumers[i].sum;
+  }
+  assert(producers_count * ITEMS_PER_PRODUCER == consumed_count);
+  assert(producers_count * ((size_t)ITEMS_PER_PRODUCER * (ITEMS_PER_PRODUCER + 1) / 2) == sum);
+  assert(ring_is_empty(r));
+
+  ring_free(r);
+}
+
+int main() {
+  init_allocator();
+  atexit(allocator_finalize);
+
+  test_single();
+  test_kinds_single_threaded();
+
+  test_spsc_threads(1);
+  test_spsc_threads(32);
+
+  test_mpmc_threads(1, 1, 1);
+  test_mpmc_threads(4, 4, 1);
+  test_mpmc_threads(4, 2, 16);
+  test_mpmc_threads(2, 4, 64);
+
+  return 0;
+}
@@ -0,0 +1,151 @@
+#ifndef __SMALL_VEC_H__
+#define __SMALL_VEC_H__
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#include "allocator.h"
+#include "logger.h"
+
+/// Generator of vectors that keep the first elements inline.
+///
+/// SMALL_VEC_DEFINE(name, T, N) defines the vector type `name` holding up to N
+///   elements of T inside itself, so a vector declared on the stack or inside
+///   another struct does not allocate until it outgrows them. Then the elements
+///   are moved to an array in the allocator and the vector grows like vec.
+/// Elements are accessed by name##_data(v)[i] or name##_at(v, i), the pointer
+///   stays valid until the vector grows. The vector is a plain value while it
+///   is inline, it can be copied by assignment only while it does not allocate.
+///
+/// Defined static inline functions: name##_init, name##_init_with_allocator,
+///   name##_free, name##_data, name##_at, name##_back, name##_count,
+///   name##_is_inline, name##_reserve, name##_push, name##_pop, name##_clear
+///   and name##_extend_from.
+///
+/// Example:
+///   SMALL_VEC_DEFINE(int_small_vec, int, 4)
+///   int_small_vec v;
+///   int_small_vec_init(&v);
+///   int_small_vec_push(&v, 42);
+///   int_small_vec_free(&v);
+
+#define SMALL_VEC_GROW_FACTOR 2
+
+#define SMALL_VEC_DEFINE(name, T, N) \
+  typedef struct { \
+    size_t count; \
+    /* N while elements are inline */ \
+    size_t capacity; \
+    /* array of elements, NULL while they are inline */ \
+    T *items; \
+    /* allocator of the items array, NULL for the global allocator */ \
+    const Allocator *p_allocator; \
+    T inline_items[N]; \
+  } name; \
+  \
+  static inline void name##_init_with_allocator(name *v, const Allocator *p_allocator) { \
+    assert(NULL != v); \
+    v->count = 0; \
+    v->capacity = (N); \
+    v->items = NULL; \
+    v->p_allocator = p_allocator; \
+  } \
+  \
+  static inline void name##_init(name *v) { \
+    name##_init_with_allocator(v, NULL); \
+  } \
+  \
+  static inline void name##_free(name *v) { \
+    assert(NULL != v); \
+    if (NULL != v->items) allocator_free(v->p_allocator, v->items); \
+    name##_init_with_allocator(v, NULL); \
+  } \
+  \
+  static inline T *name##_data(name *v) { \
+    return NULL == v->items ? v->inline_items : v->items; \
+  } \
+  \
+  static inline T *name##_at(name *v, size_t index) { \
+    assert(index < v->count); \
+    return name##_data(v) + index; \
+  } \
+  \
+  static inline T *name##_back(name *v) { \
+    assert(0 != v->count); \
+    return name##_data(v) + v->count - 1; \
+  } \
+  \
+  static inline size_t name##_count(const name *v) { \
+    return v->count; \
+  } \
+  \
+  static inline bool name##_is_inline(const name *v) { \
+    return NULL == v->items; \
+  } \
+  \
+  /* Moves the elements to an array of exactly @capacity elements */ \
+  static inline void name##_reallocate(name *v, size_t capacity) { \
+    T *items; \
+    if (NULL == v->items) { \
+      /* bounded by the inline array too, so the compiler sees the copy */ \
+      /* cannot read past it */ \
+      assert(v->count <= (N)); \
+      size_t bytes = v->count * sizeof(T); \
+      if (bytes > sizeof(v->inline_items)) bytes = sizeof(v->inline_items); \
+      items = allocator_allocate(v->p_allocator, capacity * sizeof(T)); \
+      if (NULL != items) memcpy(items, v->inline_items, bytes); \
+    } else { \
+      items = allocator_reallocate(v->p_allocator, v->items, \
+                                   v->capacity * sizeof(T), capacity * sizeof(T)); \
+    } \
+    if (NULL == items) { \
+      logf_fatal("SMALL_VEC", 137, "allocation for vector with capacity %lu failed!", capacity); \
+      /* logf_fatal returns when logging is off, inline elements cannot take the rest */ \
+      abort(); \
+    } \
+    v->items = items; \
+    v->capacity = capacity; \
+  } \
+  \
+  /* Grows capacity to at least @capacity elements with a single allocation */ \
+  static inline void name##_reserve(name *v, size_t capacity) { \
+    assert(NULL != v); \
+    if (capacity > v->capacity) name##_reallocate(v, capacity); \
+  } \
+  \
+  static inline void name##_ensure(name *v, size_t count) { \
+    if (count <= v->capacity) return; \
+    size_t capacity = v->capacity * SMALL_VEC_GROW_FACTOR; \
+    name##_reallocate(v, capacity < count ? count : capacity); \
+  } \
+  \
+  static inline void name##_push(name *v, T e) { \
+    assert(NULL != v); \
+    if (v->count == v->capacity) name##_ensure(v, v->count + 1); \
+    name##_data(v)[v->count++] = e; \
+  } \
+  \
+  static inline T name##_pop(name *v) { \
+    assert(NULL != v); \
+    assert(0 != v->count); \
+    return name##_data(v)[--v->count]; \
+  } \
+  \
+  /* Removes all elements, allocated capacity is kept */ \
+  static inline void name##_clear(name *v) { \
+    assert(NULL != v); \
+    v->count = 0; \
+  } \
+  \
+  /* Appends @n elements copied from @ptr, which must not point into the vector */ \
+  static inline void name##_extend_from(name *v, const T *ptr, size_t n) { \
+    assert(NULL != v); \
+    name##_ensure(v, v->count + n); \
+    memcpy(name##_data(v) + v->count, ptr, n * sizeof(T)); \
+    v->count += n; \
+  }
+
+#endif // !__SMALL_VEC_H__
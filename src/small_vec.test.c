@@ -0,0 +1,111 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "small_vec.h"
+#include "allocator.h"
+#include "logger.h"
+
+void init_allocator() {
+  size_t allocator_size = 4lu * 1024lu * 1024lu; // 4 MiB
+  if (!allocator_init(allocator_size)) {
+    abort();
+  }
+}
+
+LogSeverity g_log_severity = LOG_ALL;
+
+SMALL_VEC_DEFINE(int_small_vec, int, 4)
+
+typedef struct {
+  double x, y;
+} Point;
+
+SMALL_VEC_DEFINE(point_small_vec, Point, 2)
+
+void test_inline() {
+  int_small_vec v;
+  int_small_vec_init(&v);
+  assert(0 == int_small_vec_count(&v));
+  assert(int_small_vec_is_inline(&v));
+
+  AllocatorStats before, after;
+  allocator_get_stats(&before);
+  for (int i = 0; i < 4; ++i) int_small_vec_push(&v, i * 10);
+  assert(30 == int_small_vec_pop(&v));
+  int_small_vec_push(&v, 30);
+  allocator_get_stats(&after);
+  assert(before.allocs_count == after.allocs_count);
+  assert(int_small_vec_is_inline(&v));
+  assert(v.inline_items == int_small_vec_data(&v));
+
+  // copying an inline vector copies its elements
+  int_small_vec copy = v;
+  *int_small_vec_at(&copy, 0) = 100;
+  assert(0 == *int_small_vec_at(&v, 0));
+
+  // the fifth element spills the vector to the allocator
+  int_small_vec_push(&v, 40);
+  assert(!int_small_vec_is_inline(&v));
+  assert(5 == int_small_vec_count(&v));
+  assert(8 == v.capacity);
+  for (int i = 0; i < 5; ++i) assert(i * 10 == *int_small_vec_at(&v, i));
+  assert(40 == *int_small_vec_back(&v));
+
+  for (int i = 5; i < 1000; ++i) int_small_vec_push(&v, i * 10);
+  for (int i = 0; i < 1000; ++i) assert(i * 10 == int_small_vec_data(&v)[i]);
+
+  int_small_vec_clear(&v);
+  assert(0 == int_small_vec_count(&v));
+  assert(!int_small_vec_is_inline(&v));
+
+  int_small_vec_free(&v);
+  assert(int_small_vec_is_inline(&v));
+  assert(0 == int_small_vec_count(&v));
+}
+
+void test_bulk() {
+  static int buffer[100];
+  for (int i = 0; i < 100; ++i) buffer[i] = i;
+
+  int_small_vec v;
+  int_small_vec_init(&v);
+  int_small_vec_extend_from(&v, buffer, 3);
+  assert(int_small_vec_is_inline(&v));
+  int_small_vec_extend_from(&v, buffer + 3, 97);
+  assert(!int_small_vec_is_inline(&v));
+  assert(100 == int_small_vec_count(&v));
+  assert(0 == memcmp(int_small_vec_data(&v), buffer, sizeof(buffer)));
+
+  int_small_vec_reserve(&v, 50);
+  assert(100 == v.capacity);
+  int_small_vec_reserve(&v, 500);
+  assert(500 == v.capacity);
+  int_small_vec_free(&v);
+
+  // reserving beyond the inline capacity allocates once
+  point_small_vec points;
+  point_small_vec_init(&points);
+  point_small_vec_reserve(&points, 1);
+  assert(point_small_vec_is_inline(&points));
+  point_small_vec_reserve(&points, 64);
+  assert(!point_small_vec_is_inline(&points));
+  AllocatorStats before, after;
+  allocator_get_stats(&before);
+  for (int i = 0; i < 64; ++i) point_small_vec_push(&points, (Point){ i, -i });
+  allocator_get_stats(&after);
+  assert(before.allocs_count == after.allocs_count);
+  assert(before.reallocs_count == after.reallocs_count);
+  assert(63 == point_small_vec_back(&points)->x);
+  point_small_vec_free(&points);
+}
+
+int main() {
+  init_allocator();
+  atexit(allocator_finalize);
+
+  test_inline();
+  test_bulk();
+
+  return 0;
+}
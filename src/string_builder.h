@@ -9,7 +9,8 @@ typedef struct {
 } StringBuilder;
 
 #define string_builder_init(sb) do { vec_alloc(sb.data); vec_push(sb.data, '\0'); } while (0)
-#define string_builder_init_with_capacity(sb, cap) vec_alloc_reserved(char, sb.data, (cap))
+#define string_builder_init_with_capacity(sb, cap) do { vec_alloc_reserved(sb.data, (cap)); vec_push(sb.data, '\0'); } while (0)
+#define string_builder_init_with_allocator(sb, allocator) do { vec_alloc_with(sb.data, VEC_INITIAL_CAPACITY, (allocator)); vec_push(sb.data, '\0'); } while (0)
 #define string_builder_free(sb) vec_free((sb).data)
 
 #define string_builder_get_length(sb) vec_count((sb).data)
@@ -0,0 +1,321 @@
+#include <assert.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "swiss_table.h"
+#include "allocator.h"
+#include "logger.h"
+
+#define GROUP_WIDTH SWISS_TABLE_GROUP_WIDTH
+
+/// Control bytes of slots without a key have the sign bit set,
+///   control byte of a taken slot is the low 7 bits of the hash
+#define CTRL_EMPTY ((int8_t)-128)   // 0b10000000
+#define CTRL_DELETED ((int8_t)-2)   // 0b11111110
+
+#define H1(hash) ((hash) >> 7)
+#define H2(hash) ((int8_t)((hash) & 0x7F))
+
+/// Slots taken by keys and tombstones are limited to 7/8 of the capacity
+#define MAX_LOAD_NUMERATOR 7
+#define MAX_LOAD_DENOMINATOR 8
+
+#define ARR_MIN_CAPACITY GROUP_WIDTH
+
+#define NOT_FOUND ((size_t)-1)
+
+/// Bit i is set if slot i of the group matches
+typedef uint32_t GroupMask;
+
+#if defined(__SSE2__)
+
+static inline GroupMask group_match(const int8_t *ctrl, int8_t h2) {
+  __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+  return (GroupMask)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8(h2)));
+}
+
+static inline GroupMask group_match_empty(const int8_t *ctrl) {
+  return group_match(ctrl, CTRL_EMPTY);
+}
+
+static inline GroupMask group_match_empty_or_deleted(const int8_t *ctrl) {
+  __m128i group = _mm_loadu_si128((const __m128i*)ctrl);
+  return (GroupMask)_mm_movemask_epi8(group);
+}
+
+#else
+
+// Portable fallback compares 8 control bytes in a word at once
+
+#define LSBS 0x0101010101010101ull
+#define MSBS 0x8080808080808080ull
+
+static inline uint64_t word_load(const int8_t *ctrl) {
+  uint64_t word;
+  memcpy(&word, ctrl, sizeof(word));
+  return word;
+}
+
+/// Gathers the sign bits of the bytes of @bits into the low 8 bits
+static inline GroupMask word_to_mask(uint64_t bits) {
+  return (GroupMask)(((bits >> 7) * 0x0102040810204080ull) >> 56);
+}
+
+/// May report a byte next to a matching one as a match as well,
+///   that is harmless since keys of matching slots are compared anyway
+static inline GroupMask word_match(uint64_t word, int8_t h2) {
+  uint64_t x = word ^ (LSBS * (uint8_t)h2);
+  return word_to_mask((x - LSBS) & ~x & MSBS);
+}
+
+static inline GroupMask group_match(const int8_t *ctrl, int8_t h2) {
+  return word_match(word_load(ctrl), h2) | word_match(word_load(ctrl + 8), h2) << 8;
+}
+
+static inline GroupMask word_match_empty(uint64_t word) {
+  // empty has bit 1 unset, deleted has it set
+  return word_to_mask(word & ~(word << 6) & MSBS);
+}
+
+static inline GroupMask group_match_empty(const int8_t *ctrl) {
+  return word_match_empty(word_load(ctrl)) | word_match_empty(word_load(ctrl + 8)) << 8;
+}
+
+static inline GroupMask group_match_empty_or_deleted(const int8_t *ctrl) {
+  return word_to_mask(word_load(ctrl) & MSBS) | word_to_mask(word_load(ctrl + 8) & MSBS) << 8;
+}
+
+#endif // !__SSE2__
+
+static inline int mask_lowest(GroupMask mask) {
+  return __builtin_ctz(mask);
+}
+
+static inline int mask_leading_zeros(GroupMask mask) {
+  return __builtin_clz(mask) - (int)(sizeof(GroupMask) * 8 - GROUP_WIDTH);
+}
+
+
+/// Writes control byte of slot @index and its copy after the last slot
+static inline void set_ctrl(SwissTable *table, size_t index, int8_t h) {
+  table->ctrl[index] = h;
+  if (index < GROUP_WIDTH) table->ctrl[table->capacity + index] = h;
+}
+
+static size_t max_load(size_t capacity) {
+  return capacity / MAX_LOAD_DENOMINATOR * MAX_LOAD_NUMERATOR;
+}
+
+/// Looking up for a slot with key
+///
+/// @return size_t, index of the slot or NOT_FOUND
+static size_t find_slot(const SwissTable *table, const void *key, size_t hash) {
+  size_t mask = table->capacity - 1;
+  size_t pos = H1(hash) & mask;
+  int8_t h2 = H2(hash);
+
+  // groups are probed by triangular steps, that visits every group once
+  for (size_t step = GROUP_WIDTH;; step += GROUP_WIDTH) {
+    const int8_t *ctrl = table->ctrl + pos;
+
+    for (GroupMask match = group_match(ctrl, h2); 0 != match; match &= match - 1) {
+      size_t index = (pos + mask_lowest(match)) & mask;
+      const Entry *pentry = table->entries + index;
+      if (hash == pentry->hash && table->key_cmp_func(key, pentry->key)) return index;
+    }
+
+    if (0 != group_match_empty(ctrl)) return NOT_FOUND;
+
+    pos = (pos + step) & mask;
+  }
+}
+
+/// Finds the first empty or deleted slot on the probe sequence of @hash
+static size_t find_free_slot(const SwissTable *table, size_t hash) {
+  size_t mask = table->capacity - 1;
+  size_t pos = H1(hash) & mask;
+
+  for (size_t step = GROUP_WIDTH;; step += GROUP_WIDTH) {
+    GroupMask match = group_match_empty_or_deleted(table->ctrl + pos);
+    if (0 != match) return (pos + mask_lowest(match)) & mask;
+
+    pos = (pos + step) & mask;
+  }
+}
+
+/// Allocates arrays for @capacity slots and moves all entries there,
+///   tombstones are dropped
+static void adjust_capacity(SwissTable *table, size_t capacity) {
+  assert(capacity >= GROUP_WIDTH && 0 == (capacity & (capacity - 1)));
+
+  size_t ctrl_size = capacity + GROUP_WIDTH;
+  char *mem = allocator_allocate(table->p_allocator, sizeof(Entry) * capacity + ctrl_size);
+  if (NULL == mem) {
+    logf_fatal("SWISS_TABLE", 137, "allocation for table with capacity %lu failed!", capacity);
+  }
+
+  int8_t *old_ctrl = table->ctrl;
+  Entry *old_entries = table->entries;
+  size_t old_capacity = table->capacity;
+
+  table->entries = (Entry*)mem;
+  table->ctrl = (int8_t*)(mem + sizeof(Entry) * capacity);
+  table->capacity = capacity;
+  table->growth_left = max_load(capacity) - table->count;
+  memset(table->ctrl, CTRL_EMPTY, ctrl_size);
+
+  for (size_t i = 0; i < old_capacity; ++i) {
+    if (old_ctrl[i] < 0) continue;
+
+    const Entry *pentry = old_entries + i;
+    size_t index = find_free_slot(table, pentry->hash);
+    set_ctrl(table, index, H2(pentry->hash));
+    table->entries[index] = *pentry;
+  }
+
+  allocator_free(table->p_allocator, old_entries);
+}
+
+/// Makes room for one more key: doubles the table if it is filled with keys,
+///   rehashes it in place if it is filled with tombstones
+static void grow(SwissTable *table) {
+  if (0 == table->capacity) {
+    adjust_capacity(table, ARR_MIN_CAPACITY);
+  } else if (table->count * 2 >= max_load(table->capacity)) {
+    adjust_capacity(table, table->capacity * 2);
+  } else {
+    adjust_capacity(table, table->capacity);
+  }
+}
+
+static void swiss_table_init_impl(SwissTable *table,
+                                  HashFunc hash_func, KeyCmpFunc key_cmp_func,
+                                  FreeKeyValFunc free_kv_func,
+                                  const Allocator *p_allocator) {
+  table->p_allocator = p_allocator;
+  table->hash_func = hash_func;
+  table->key_cmp_func = key_cmp_func;
+  table->free_kv_func = free_kv_func;
+  table->count = 0;
+  table->capacity = 0;
+  table->growth_left = 0;
+  table->ctrl = NULL;
+  table->entries = NULL;
+}
+
+void swiss_table_init(SwissTable *table, HashFunc hash_func, KeyCmpFunc key_cmp_func,
+                      FreeKeyValFunc free_kv_func) {
+  assert(NULL != table);
+  assert(NULL != hash_func);
+  assert(NULL != key_cmp_func);
+  swiss_table_init_impl(table, hash_func, key_cmp_func, free_kv_func, NULL);
+}
+
+void swiss_table_init_with_allocator(SwissTable *table,
+                                     HashFunc hash_func, KeyCmpFunc key_cmp_func,
+                                     FreeKeyValFunc free_kv_func,
+                                     const Allocator *p_allocator) {
+  assert(NULL != table);
+  assert(NULL != hash_func);
+  assert(NULL != key_cmp_func);
+  swiss_table_init_impl(table, hash_func, key_cmp_func, free_kv_func, p_allocator);
+}
+
+void swiss_table_free(SwissTable *table) {
+  assert(NULL != table);
+  if (NULL != table->free_kv_func) {
+    for (size_t i = 0; i < table->capacity; ++i) {
+      if (table->ctrl[i] < 0) continue;
+      table->free_kv_func(table->entries[i].key, table->entries[i].value);
+    }
+  }
+  allocator_free(table->p_allocator, table->entries);
+  swiss_table_init_impl(table, NULL, NULL, NULL, NULL);
+}
+
+bool swiss_table_set(SwissTable *table, const void *key, void *value) {
+  assert(NULL != table);
+  assert(NULL != key);
+
+  size_t hash = table->hash_func(key);
+  if (0 != table->count) {
+    size_t index = find_slot(table, key, hash);
+    if (NOT_FOUND != index) {
+      table->entries[index].key = key;
+      table->entries[index].value = value;
+      table->entries[index].hash = hash;
+      return false;
+    }
+  }
+
+  if (0 == table->capacity) grow(table);
+
+  size_t index = find_free_slot(table, hash);
+  if (0 == table->growth_left && CTRL_EMPTY == table->ctrl[index]) {
+    grow(table);
+    index = find_free_slot(table, hash);
+  }
+
+  table->growth_left -= CTRL_EMPTY == table->ctrl[index];
+  set_ctrl(table, index, H2(hash));
+  table->entries[index].key = key;
+  table->entries[index].value = value;
+  table->entries[index].hash = hash;
+  ++table->count;
+
+  return true;
+}
+
+bool swiss_table_get(const SwissTable *table, const void *key, void **value) {
+  assert(NULL != table);
+  assert(NULL != key);
+
+  if (0 == table->count) return false;
+
+  size_t index = find_slot(table, key, table->hash_func(key));
+  if (NOT_FOUND == index) return false;
+
+  *value = table->entries[index].value;
+  return true;
+}
+
+bool swiss_table_delete(SwissTable *table, const void *key) {
+  assert(NULL != table);
+  assert(NULL != key);
+
+  if (0 == table->count) return false;
+
+  size_t index = find_slot(table, key, table->hash_func(key));
+  if (NOT_FOUND == index) return false;
+
+  if (NULL != table->free_kv_func) {
+    table->free_kv_func(table->entries[index].key, table->entries[index].value);
+  }
+
+  // the slot can become empty again if no group containing it was ever full,
+  // then no probe sequence has passed through it
+  size_t mask = table->capacity - 1;
+  GroupMask empty_after = group_match_empty(table->ctrl + index);
+  GroupMask empty_before = group_match_empty(table->ctrl + ((index - GROUP_WIDTH) & mask));
+  bool was_never_full = 0 != empty_before && 0 != empty_after
+    && mask_lowest(empty_after) + mask_leading_zeros(empty_before) < GROUP_WIDTH;
+
+  set_ctrl(table, index, was_never_full ? CTRL_EMPTY : CTRL_DELETED);
+  table->growth_left += was_never_full;
+  --table->count;
+
+  return true;
+}
+
+void swiss_table_add_all(SwissTable *dest, const SwissTable *src) {
+  assert(NULL != dest);
+  assert(NULL != src);
+
+  for (size_t i = 0; i < src->capacity; ++i) {
+    if (src->ctrl[i] < 0) continue;
+    swiss_table_set(dest, src->entries[i].key, src->entries[i].value);
+  }
+}
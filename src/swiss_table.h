@@ -0,0 +1,110 @@
+#ifndef __SWISS_TABLE_H__
+#define __SWISS_TABLE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "table.h"
+#include "allocator.h"
+
+/// Number of slots whose control bytes are probed at once
+#define SWISS_TABLE_GROUP_WIDTH 16
+
+/// Hash table with the same interface as Table, laid out as a Swiss table:
+///   every slot has a control byte, that is either empty, deleted
+///   or holds the low 7 bits of the hash of the key stored in the slot.
+/// Lookups compare control bytes of a group of slots at once (SSE2 if available)
+///   and call key_cmp_func only for slots whose 7 bits match,
+///   a group with an empty slot ends the search.
+typedef struct {
+  HashFunc hash_func;
+  KeyCmpFunc key_cmp_func;
+  FreeKeyValFunc free_kv_func;
+
+  /// Number of active elements in entries array
+  size_t count;
+
+  /// Number of slots, a power of two, not less than SWISS_TABLE_GROUP_WIDTH,
+  ///   0 until the first insertion
+  size_t capacity;
+
+  /// Number of empty slots that can be taken before the table is rehashed
+  size_t growth_left;
+
+  /// Control bytes, capacity + SWISS_TABLE_GROUP_WIDTH of them,
+  ///   the first group is repeated after the last slot,
+  ///   so a group starting at any slot can be loaded at once
+  int8_t *ctrl;
+
+  /// Array of entries, stored in the same allocation as ctrl
+  Entry *entries;
+
+  /// Allocator of the entries array, NULL for the global allocator
+  const Allocator *p_allocator;
+} SwissTable;
+
+
+/// Initializes the table to all zeros
+///
+/// @param table: pointer to the table to be initialized
+/// @param hash_func: pointer to the hash function for keys
+/// @param key_cmp_func: pointer to the function that compares keys for equality
+/// @param free_kv_func: pointer to the callback function for freeing key and value pairs
+///   when deleting key or on swiss_table_free, it will not be called if NULL is passed
+/// @return void
+void swiss_table_init(SwissTable *table,
+                      HashFunc hash_func, KeyCmpFunc key_cmp_func,
+                      FreeKeyValFunc free_kv_func);
+
+/// Initializes the table to all zeros, the arrays will be allocated
+///   in @p_allocator (NULL for the global allocator)
+///
+/// @param p_allocator: allocator handle, it has to outlive the table
+/// @see swiss_table_init for the rest of parameters
+/// @return void
+void swiss_table_init_with_allocator(SwissTable *table,
+                                     HashFunc hash_func, KeyCmpFunc key_cmp_func,
+                                     FreeKeyValFunc free_kv_func,
+                                     const Allocator *p_allocator);
+
+/// Frees underlying arrays of the table
+/// and initializes all fields in the table to zeros.
+///
+/// @param table: pointer to the table to be freed
+/// @return void
+void swiss_table_free(SwissTable *table);
+
+/// Inserts new value to the table by key,
+/// if key already exists, then overrides old value associated to that key
+///
+/// @param table: pointer to table to insert value in
+/// @param key: pointer to the key to associate value with
+/// @param value: pointer to the value to insert
+///
+/// @return bool, true if key is new, otherwise false
+bool swiss_table_set(SwissTable *table, const void *key, void *value);
+
+/// Looks up for a value in the tabel associated with the key
+///
+/// @param table: pointer to the table to look up in
+/// @param key: pointer to the key value associated with
+/// @outparam value: pointer to the found value (untouched if not found)
+/// @return bool, true if value was found, false otherwise
+bool swiss_table_get(const SwissTable *table, const void *key, void **value);
+
+/// Deletes entry associated with the key in the table
+///
+/// @param table: pointer to the table to delete from
+/// @param key: pointer to the key value associated with
+/// @return bool, true if entry was found and deleted, false otherwise
+bool swiss_table_delete(SwissTable *table, const void *key);
+
+/// Inserts all entries from src to dest
+///
+/// @param dest: destination table
+/// @param src: source table
+/// @return void
+void swiss_table_add_all(SwissTable *dest, const SwissTable *src);
+
+#endif // !__SWISS_TABLE_H__
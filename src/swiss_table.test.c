@@ -0,0 +1,92 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "swiss_table.h"
+#include "allocator.h"
+#include "logger.h"
+
+void init_allocator() {
+  size_t allocator_size = 4lu * 1024lu * 1024lu; // 4 MiB
+  if (!allocator_init(allocator_size)) {
+    abort();
+  }
+}
+
+LogSeverity g_log_severity = LOG_ALL;
+
+bool key_cmp_cstr(const void *lhs, const void *rhs) {
+  return 0 == strcmp(lhs, rhs);
+}
+
+static size_t g_freed_count;
+
+void free_kv_count(const void *key, void *value) {
+  (void)key;
+  (void)value;
+  ++g_freed_count;
+}
+
+#define KEYS_COUNT 2000
+
+int main() {
+  init_allocator();
+  atexit(allocator_finalize);
+
+  static char keys[KEYS_COUNT][16];
+  for (size_t i = 0; i < KEYS_COUNT; ++i) snprintf(keys[i], sizeof(keys[i]), "key_%zu", i);
+
+  SwissTable table;
+  swiss_table_init(&table, hash_cstr_default, key_cmp_cstr, free_kv_count);
+
+  void *value = NULL;
+  assert(!swiss_table_get(&table, "key_0", &value));
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    assert(swiss_table_set(&table, keys[i], (void*)(i + 1)));
+  }
+  assert(KEYS_COUNT == table.count);
+  assert(!swiss_table_set(&table, keys[7], (void*)7));
+
+  char lookup[16];
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    snprintf(lookup, sizeof(lookup), "key_%zu", i);
+    assert(swiss_table_get(&table, lookup, &value));
+    assert((7 == i ? 7 : i + 1) == (size_t)value);
+  }
+  assert(!swiss_table_get(&table, "missing", &value));
+
+  // deleting every other key, the rest stays reachable past the tombstones
+  for (size_t i = 0; i < KEYS_COUNT; i += 2) {
+    assert(swiss_table_delete(&table, keys[i]));
+    assert(!swiss_table_delete(&table, keys[i]));
+  }
+  assert(KEYS_COUNT / 2 == table.count);
+  assert(KEYS_COUNT / 2 == g_freed_count);
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    assert((i % 2 == 1) == swiss_table_get(&table, keys[i], &value));
+  }
+
+  // reinserting over tombstones does not grow the table
+  size_t capacity = table.capacity;
+  for (size_t i = 0; i < KEYS_COUNT; i += 2) {
+    assert(swiss_table_set(&table, keys[i], (void*)(i + 1)));
+  }
+  assert(capacity == table.capacity);
+
+  SwissTable copy;
+  swiss_table_init(&copy, hash_cstr_default, key_cmp_cstr, NULL);
+  swiss_table_add_all(&copy, &table);
+  assert(KEYS_COUNT == copy.count);
+  assert(swiss_table_get(&copy, keys[KEYS_COUNT - 1], &value));
+  assert(KEYS_COUNT == (size_t)value);
+  swiss_table_free(&copy);
+
+  g_freed_count = 0;
+  swiss_table_free(&table);
+  assert(KEYS_COUNT == g_freed_count);
+  assert(0 == table.count);
+
+  return 0;
+}
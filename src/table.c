@@ -1,14 +1,49 @@
 #include <assert.h>
+#include <stdint.h>
 #include <string.h>
 
 #include "table.h"
 #include "allocator.h"
 #include "string_view.h"
+#include "logger.h"
 
 #define TABLE_MAX_LOAD .75
-#define TOMBSTONE_VAL (void*)0x1
+
+/// Starts loading home buckets of @hash into cache, it never faults.
+/// A macro since gcc takes a function of prefetches only for pure and drops its calls
+#define PREFETCH_ENTRY(table, hash) \
+  do { \
+    __builtin_prefetch((table)->entries + ((hash) & (table)->capacity)); \
+    if (NULL != (table)->old_entries) { \
+      __builtin_prefetch((table)->old_entries + ((hash) & (table)->old_capacity)); \
+    } \
+  } while (0)
+
+/// Starts loading the key of the entry in the home bucket of @key_hash
+///   if the entry has the same hash, so comparing it does not miss.
+/// The home bucket has to be prefetched a while before, it is read here
+#define PREFETCH_KEY(table, key_hash) \
+  do { \
+    const Entry *p_home = (table)->entries + ((key_hash) & (table)->capacity); \
+    if (NULL != p_home->key && (key_hash) == p_home->hash) __builtin_prefetch(p_home->key); \
+  } while (0)
+
+/// Distance of an entry at @index from the bucket its hash points to
+#define PROBE_LENGTH(pentry, index, capacity) (((index) - ((pentry)->hash & (capacity))) & (capacity))
 
 #define ARR_MIN_CAPACITY 8
+
+/// Number of old array buckets a call moves during incremental resize,
+///   the old array is drained before the new one reaches the max load
+#define MIGRATE_BUCKETS 16
+
+/// Load the next array of incremental resize is allocated at
+#define TABLE_PREPARE_LOAD .5
+
+/// Number of next array buckets a table_set call clears,
+///   the next array has twice the buckets and (MAX_LOAD - PREPARE_LOAD)
+///   of the current capacity sets to be cleared in, so 8 would do
+#define CLEAR_BUCKETS 16
 #define ARR_GROW_FACTOR 2
 
 /// returns capacity multiplied by MEM_GROW_FACTOR
@@ -19,8 +54,8 @@
     (capacity) * ARR_GROW_FACTOR)
 
 /// realocates array pointed by ptr with new_size
-#define GROW_ARRAY(T, ptr, old_count, new_count) \
-  (T*)a_reallocate(ptr, sizeof(T) * (old_count), sizeof(T) * (new_count))
+#define GROW_ARRAY(T, allocator, ptr, old_count, new_count) \
+  (T*)allocator_reallocate((allocator), ptr, sizeof(T) * (old_count), sizeof(T) * (new_count))
 
 
 /// Looking up for an entry with key in entries array
@@ -28,11 +63,26 @@
 /// @param entries: pointer to the array to look in
 /// @param capacity: capacity of the entries array
 /// @param key: pointer to the key to look up entry by
-/// @return Entry*, pointer to the found Entry
-///   if key in found entry is NULL, then entry was not found,
-///   and the nearest empty bucket for the key is returned
+/// @param hash: hash of the key
+/// @return Entry*, pointer to the found Entry or NULL if there is no such key
 static Entry *find_entry(Entry* entries, size_t capacity, const void *key,
-                         HashFunc hash_func, KeyCmpFunc key_cmp_func);
+                         size_t hash, KeyCmpFunc key_cmp_func);
+
+/// Places an entry with a key that is not in the entries array yet
+///
+/// @param entries: pointer to the array to insert in
+/// @param capacity: capacity of the entries array
+/// @param entry: entry to insert
+/// @return void
+static void insert_entry(Entry *entries, size_t capacity, Entry entry);
+
+/// Removes an entry from the entries array by shifting following entries back
+///
+/// @param entries: pointer to the array to remove from
+/// @param capacity: capacity of the entries array
+/// @param pentry: pointer to the entry to remove
+/// @return void
+static void remove_entry(Entry *entries, size_t capacity, Entry *pentry);
 
 /// Adjustes capacity of table's underlying array of entries to the desirable capacity
 /// by reallocating it,
@@ -43,15 +93,51 @@ static Entry *find_entry(Entry* entries, size_t capacity, const void *key,
 /// @param capacity: desirable capacity
 static void adjust_capacity(Table *table, size_t capacity);
 
+/// Starts incremental resize: the entries array becomes the old one
+///   and an empty array of the desirable capacity takes its place
+///
+/// @param table: table to resize
+/// @param capacity: desirable capacity
+static void start_resize(Table *table, size_t capacity);
+
+/// Moves entries of up to @buckets_count buckets of the old array
+///   to the entries array, frees the old array once it is empty
+///
+/// @param table: table with a resize in progress or not
+/// @param buckets_count: maximum number of old buckets to visit
+static void migrate(Table *table, size_t buckets_count);
+
+/// Allocates the array of the next incremental resize once the table
+///   is loaded enough and clears up to CLEAR_BUCKETS of its buckets
+///
+/// @param table: table in incremental resize mode
+static void prepare_resize(Table *table);
+
+/// Returns an array of empty entries of @capacity,
+///   the prepared next array if it fits, a new one otherwise
+///
+/// @param table: table the array is for
+/// @param capacity: desirable capacity
+/// @return Entry*, array the caller owns
+static Entry *take_cleared_entries(Table *table, size_t capacity);
+
 static void table_init_impl(Table *table, HashFunc hash_func, KeyCmpFunc key_cmp_func,
-                            FreeKeyValFunc free_kv_func) {
+                            FreeKeyValFunc free_kv_func, const Allocator *p_allocator) {
+  table->p_allocator = p_allocator;
   table->hash_func = hash_func;
   table->key_cmp_func = key_cmp_func;
   table->free_kv_func = free_kv_func;
   table->count = 0;
   table->capacity = -1;
-  table->tombstones_count = 0;
   table->entries = NULL;
+  table->old_entries = NULL;
+  table->old_capacity = -1;
+  table->old_count = 0;
+  table->migrate_index = 0;
+  table->next_entries = NULL;
+  table->next_capacity = -1;
+  table->next_cleared_index = 0;
+  table->is_resize_incremental = false;
 }
 
 void table_init(Table *table, HashFunc hash_func, KeyCmpFunc key_cmp_func,
@@ -59,41 +145,107 @@ void table_init(Table *table, HashFunc hash_func, KeyCmpFunc key_cmp_func,
   assert(NULL != table);
   assert(NULL != hash_func);
   assert(NULL != key_cmp_func);
-  table_init_impl(table, hash_func, key_cmp_func, free_kv_func);
+  table_init_impl(table, hash_func, key_cmp_func, free_kv_func, NULL);
+}
+
+void table_init_with_allocator(Table *table, HashFunc hash_func, KeyCmpFunc key_cmp_func,
+                               FreeKeyValFunc free_kv_func, const Allocator *p_allocator) {
+  assert(NULL != table);
+  assert(NULL != hash_func);
+  assert(NULL != key_cmp_func);
+  table_init_impl(table, hash_func, key_cmp_func, free_kv_func, p_allocator);
 }
 
 void table_free(Table *table) {
   assert(NULL != table);
   if (NULL != table->free_kv_func) {
+    if (table->capacity < 0) {
+      for (size_t i = 0; i < table->count; ++i) {
+        table->free_kv_func(table->inline_entries[i].key, table->inline_entries[i].value);
+      }
+    }
     for (ssize_t i = 0; i <= table->capacity; ++i) {
       Entry *pentry = table->entries + i;
       if (NULL != pentry->key) {
         table->free_kv_func(pentry->key, pentry->value);
       }
     }
+    for (ssize_t i = 0; i <= table->old_capacity; ++i) {
+      Entry *pentry = table->old_entries + i;
+      if (NULL != pentry->key) {
+        table->free_kv_func(pentry->key, pentry->value);
+      }
+    }
   }
-  a_free(table->entries);
-  table_init_impl(table, NULL, NULL, NULL);
+  allocator_free(table->p_allocator, table->entries);
+  allocator_free(table->p_allocator, table->old_entries);
+  allocator_free(table->p_allocator, table->next_entries);
+  table_init_impl(table, NULL, NULL, NULL, NULL);
 }
 
-bool table_set(Table* table, const void *key, void *value) {
-  assert(NULL != table);
+/// Looking up for an entry with key in both arrays of the table
+static Entry *lookup_entry(const Table *table, const void *key, size_t hash) {
+  if (table->capacity < 0) {
+    // few keys without an array are scanned linearly
+    for (size_t i = 0; i < table->count; ++i) {
+      const Entry *pentry = table->inline_entries + i;
+      if (hash == pentry->hash && table->key_cmp_func(key, pentry->key)) return (Entry*)pentry;
+    }
+    return NULL;
+  }
+
+  Entry *pentry = find_entry(table->entries, table->capacity, key, 
+                             hash, table->key_cmp_func);
+  if (NULL == pentry && NULL != table->old_entries) {
+    pentry = find_entry(table->old_entries, table->old_capacity, key,
+                        hash, table->key_cmp_func);
+  }
+  return pentry;
+}
+
+/// table_set with the hash of the key computed already
+static bool set_hashed(Table *table, const void *key, void *value, size_t hash) {
+  migrate(table, MIGRATE_BUCKETS);
+  if (table->is_resize_incremental) prepare_resize(table);
+
+  if (0 != table->count) {
+    Entry *pentry = lookup_entry(table, key, hash);
+    if (NULL != pentry) {
+      pentry->key = key;
+      pentry->value = value;
+      return false;
+    }
+  }
 
-  if ((table->capacity + 1) * TABLE_MAX_LOAD <= table->count + table->tombstones_count) {
+  if (table->capacity < 0 && table->count < TABLE_INLINE_CAPACITY) {
+    table->inline_entries[table->count++] = (Entry){ key, value, hash };
+    return true;
+  }
+
+  if ((table->capacity + 1) * TABLE_MAX_LOAD <= table->count + 1) {
     size_t capacity = GROW_CAPACITY(table->capacity + 1) - 1;
-    adjust_capacity(table, capacity);
+    // inline entries may need more than the minimal capacity
+    while ((capacity + 1) * TABLE_MAX_LOAD <= table->count + 1) {
+      capacity = GROW_CAPACITY(capacity + 1) - 1;
+    }
+    if (table->is_resize_incremental && table->capacity >= 0 && 0 != table->count) {
+      start_resize(table, capacity);
+    } else {
+      adjust_capacity(table, capacity);
+    }
   }
 
-  Entry *pentry = find_entry(table->entries, table->capacity, key, 
-                             table->hash_func, table->key_cmp_func);
+  insert_entry(table->entries, table->capacity, (Entry){ key, value, hash });
+  ++table->count;
 
-  bool is_new_key = NULL == pentry->key;
-  table->count += is_new_key;
+  return true;
+}
 
-  pentry->key = key;
-  pentry->value = value;
+bool table_set(Table* table, const void *key, void *value) {
+  assert(NULL != table);
+  assert(NULL != key);
 
-  return is_new_key;
+  return set_hashed(table, key, value, table->hash_func(key));
 }
 
 bool table_get(const Table* table, const void *key, void **value) {
@@ -101,72 +253,238 @@ bool table_get(const Table* table, const void *key, void **value) {
 
   if (0 == table->count) return false;
 
-  Entry *pentry = find_entry(table->entries, table->capacity, key, 
-                             table->hash_func, table->key_cmp_func);
-  if (NULL == pentry->key) return false;
+  Entry *pentry = lookup_entry(table, key, table->hash_func(key));
+  if (NULL == pentry) return false;
 
   *value = pentry->value;
   return true;
 }
 
+/// Hashes @count keys and prefetches their home buckets
+///
+/// @param table: table the keys are looked up in
+/// @param keys: keys to hash
+/// @param count: number of keys, up to TABLE_BATCH_SIZE
+/// @outparam hashes: array of count hashes
+static void hash_batch(const Table *table, const void *const *keys, size_t count,
+                       size_t *hashes) {
+  for (size_t i = 0; i < count; ++i) {
+    assert(NULL != keys[i]);
+    hashes[i] = table->hash_func(keys[i]);
+    if (table->capacity >= 0) PREFETCH_ENTRY(table, hashes[i]);
+  }
+}
+
+size_t table_get_many(const Table *table, const void *const *keys, size_t count,
+                      void **values, bool *found) {
+  assert(NULL != table);
+  assert(NULL != keys || 0 == count);
+  assert(NULL != values || 0 == count);
+
+  if (0 == table->count) {
+    if (NULL != found) memset(found, 0, sizeof(bool) * count);
+    return 0;
+  }
+
+  size_t found_count = 0;
+  size_t hashes[2][TABLE_BATCH_SIZE];
+  hash_batch(table, keys, count < TABLE_BATCH_SIZE ? count : TABLE_BATCH_SIZE, hashes[0]);
+  for (size_t begin = 0; begin < count; begin += TABLE_BATCH_SIZE) {
+    size_t batch_count = count - begin < TABLE_BATCH_SIZE ? count - begin : TABLE_BATCH_SIZE;
+    const size_t *batch_hashes = hashes[begin / TABLE_BATCH_SIZE % 2];
+
+    // buckets of the next batch are loaded while this one is resolved,
+    // buckets of this one were loaded while the previous one was
+    size_t next = begin + batch_count;
+    if (next < count) {
+      hash_batch(table, keys + next, count - next < TABLE_BATCH_SIZE ? count - next : TABLE_BATCH_SIZE,
+                 hashes[next / TABLE_BATCH_SIZE % 2]);
+    }
+    if (table->capacity >= 0) {
+      for (size_t i = 0; i < batch_count; ++i) PREFETCH_KEY(table, batch_hashes[i]);
+    }
+
+    for (size_t i = 0; i < batch_count; ++i) {
+      Entry *pentry = lookup_entry(table, keys[begin + i], batch_hashes[i]);
+      if (NULL != pentry) {
+        values[begin + i] = pentry->value;
+        ++found_count;
+      }
+      if (NULL != found) found[begin + i] = NULL != pentry;
+    }
+  }
+
+  return found_count;
+}
+
+size_t table_set_many(Table *table, const void *const *keys, void *const *values,
+                      size_t count) {
+  assert(NULL != table);
+  assert(NULL != keys || 0 == count);
+  assert(NULL != values || 0 == count);
+
+  size_t new_count = 0;
+  size_t hashes[2][TABLE_BATCH_SIZE];
+  hash_batch(table, keys, count < TABLE_BATCH_SIZE ? count : TABLE_BATCH_SIZE, hashes[0]);
+  for (size_t begin = 0; begin < count; begin += TABLE_BATCH_SIZE) {
+    size_t batch_count = count - begin < TABLE_BATCH_SIZE ? count - begin : TABLE_BATCH_SIZE;
+    const size_t *batch_hashes = hashes[begin / TABLE_BATCH_SIZE % 2];
+
+    size_t next = begin + batch_count;
+    if (next < count) {
+      hash_batch(table, keys + next, count - next < TABLE_BATCH_SIZE ? count - next : TABLE_BATCH_SIZE,
+                 hashes[next / TABLE_BATCH_SIZE % 2]);
+    }
+    if (table->capacity >= 0) {
+      for (size_t i = 0; i < batch_count; ++i) PREFETCH_KEY(table, batch_hashes[i]);
+    }
+
+    // a grow in the middle of the batch makes the rest of prefetches useless only
+    for (size_t i = 0; i < batch_count; ++i) {
+      new_count += set_hashed(table, keys[begin + i], values[begin + i], batch_hashes[i]);
+    }
+  }
+
+  return new_count;
+}
+
 bool table_delete(Table *table, const void *key) {
   assert(NULL != table);
 
   if (0 == table->count) return false;
 
-  Entry *pentry = find_entry(table->entries, table->capacity, key, 
-                             table->hash_func, table->key_cmp_func);
-  if (NULL == pentry->key) return false;
+  migrate(table, MIGRATE_BUCKETS);
+
+  size_t hash = table->hash_func(key);
+  if (table->capacity < 0) {
+    Entry *pentry = lookup_entry(table, key, hash);
+    if (NULL == pentry) return false;
+
+    if (NULL != table->free_kv_func) {
+      table->free_kv_func(pentry->key, pentry->value);
+    }
+    *pentry = table->inline_entries[--table->count];
+    return true;
+  }
+
+  Entry *entries = table->entries;
+  size_t capacity = table->capacity;
+  Entry *pentry = find_entry(entries, capacity, key, hash, table->key_cmp_func);
+  if (NULL == pentry && NULL != table->old_entries) {
+    entries = table->old_entries;
+    capacity = table->old_capacity;
+    pentry = find_entry(entries, capacity, key, hash, table->key_cmp_func);
+  }
+  if (NULL == pentry) return false;
 
   if (NULL != table->free_kv_func) {
     table->free_kv_func(pentry->key, pentry->value);
   }
 
-  // tombstone
-  pentry->key = NULL;
-  pentry->value = TOMBSTONE_VAL;
+  remove_entry(entries, capacity, pentry);
   --table->count;
-  ++table->tombstones_count;
+  if (entries == table->old_entries) {
+    --table->old_count;
+    migrate(table, 0);
+  }
 
   return true;
 }
 
+void table_set_resize_incremental(Table *table, bool is_incremental) {
+  assert(NULL != table);
+
+  table->is_resize_incremental = is_incremental;
+  if (!is_incremental) migrate(table, (size_t)-1);
+}
+
+/// Capacity table_set grows the table to before @count keys are in it
+///
+/// @return ssize_t, capacity of the table if it does not have to grow
+static ssize_t reserve_capacity(const Table *table, size_t count) {
+  if (table->capacity < 0 && count <= TABLE_INLINE_CAPACITY) return table->capacity;
+  if ((table->capacity + 1) * TABLE_MAX_LOAD > count) return table->capacity;
+
+  // the same condition table_set grows by, so inserting up to count keys does not
+  size_t capacity = GROW_CAPACITY(table->capacity + 1) - 1;
+  while ((capacity + 1) * TABLE_MAX_LOAD <= count) {
+    capacity = GROW_CAPACITY(capacity + 1) - 1;
+  }
+  return capacity;
+}
+
+void table_reserve(Table *table, size_t count) {
+  assert(NULL != table);
+
+  ssize_t capacity = reserve_capacity(table, count);
+  if (capacity != table->capacity) adjust_capacity(table, capacity);
+}
+
+size_t table_build(Table *table, const Entry *entries, size_t count) {
+  assert(NULL != table);
+  assert(NULL != entries || 0 == count);
+
+  table_reserve(table, table->count + count);
+
+  size_t new_count = 0;
+  for (size_t i = 0; i < count; ++i) {
+    assert(NULL != entries[i].key);
+    new_count += set_hashed(table, entries[i].key, entries[i].value,
+                            table->hash_func(entries[i].key));
+  }
+
+  return new_count;
+}
+
 void table_add_all(Table* dest, const Table *src) {
   assert(NULL != dest);
   assert(NULL != src);
 
-  for (ssize_t i = 0; i <= src->capacity; ++i) {
-    const Entry *pentry = src->entries + i;
-    if (NULL != pentry->key) {
-      table_set(dest, pentry->key, pentry->value);
+  if (dest == src) return;
+
+  // sized once for the case no key of src is in dest.
+  // Entries come in the order of src buckets, which inserted into a smaller
+  // array pile up in long runs, so dest is at least as big as src
+  ssize_t capacity = reserve_capacity(dest, dest->count + src->count);
+  if (capacity < src->capacity) capacity = src->capacity;
+  if (capacity != dest->capacity) adjust_capacity(dest, capacity);
+
+  // hashes cached in src are valid for dest if both hash the same way
+  bool is_same_hash = dest->hash_func == src->hash_func;
+  const Entry *arrays[] = { src->inline_entries, src->entries, src->old_entries };
+  size_t capacities[] = {
+    src->capacity < 0 ? src->count : 0,
+    (size_t)(src->capacity + 1),
+    (size_t)(src->old_capacity + 1)
+  };
+  for (size_t a = 0; a < 3; ++a) {
+    for (size_t i = 0; i < capacities[a]; ++i) {
+      const Entry *pentry = arrays[a] + i;
+      if (NULL == pentry->key) continue;
+
+      size_t hash = is_same_hash ? pentry->hash : dest->hash_func(pentry->key);
+      set_hashed(dest, pentry->key, pentry->value, hash);
     }
   }
 }
 
 static Entry *find_entry(Entry* entries, size_t capacity, const void *key, 
-                         HashFunc hash_func, KeyCmpFunc key_cmp_func) {
+                         size_t hash, KeyCmpFunc key_cmp_func) {
   assert(NULL != entries);
   assert(NULL != key);
-  assert(NULL != hash_func);
   assert(NULL != key_cmp_func);
 
-  size_t hash = hash_func(key);
   size_t index = hash & capacity;
-  Entry *tombstone = NULL;
 
-  for (;;) {
+  // an entry closer to its home than the key would be to its own
+  // means that the key would have taken its place
+  for (size_t probe_length = 0;; ++probe_length) {
     Entry *pentry = entries + index;
 
-    if (NULL == pentry->key) {
-      if (NULL == pentry->value) {
-        // empty entry
-        return NULL != tombstone ? tombstone : pentry;
-      } else {
-        // tombstone
-        if (NULL == tombstone) tombstone = pentry;
-      }
-    } else if (key_cmp_func(key, pentry->key)) {
-      // the key is found
+    if (NULL == pentry->key || PROBE_LENGTH(pentry, index, capacity) < probe_length) {
+      return NULL;
+    }
+    if (hash == pentry->hash && key_cmp_func(key, pentry->key)) {
       return pentry;
     }
 
@@ -174,58 +492,385 @@ static Entry *find_entry(Entry* entries, size_t capacity, const void *key,
   }
 }
 
+static void insert_entry(Entry *entries, size_t capacity, Entry entry) {
+  size_t index = entry.hash & capacity;
+
+  // Robin Hood: the entry takes the place of the first entry
+  // that is closer to its home, which then continues the search
+  for (size_t probe_length = 0;; ++probe_length) {
+    Entry *pentry = entries + index;
+
+    if (NULL == pentry->key) {
+      *pentry = entry;
+      return;
+    }
+
+    size_t entry_probe_length = PROBE_LENGTH(pentry, index, capacity);
+    if (entry_probe_length < probe_length) {
+      Entry displaced = *pentry;
+      *pentry = entry;
+      entry = displaced;
+      probe_length = entry_probe_length;
+    }
+
+    index = (index + 1) & capacity;
+  }
+}
+
+static void remove_entry(Entry *entries, size_t capacity, Entry *pentry) {
+  // backward shift: entries after the removed one move a step closer
+  // to their home bucket until an empty entry or an entry at its home
+  size_t index = pentry - entries;
+  for (;;) {
+    size_t next = (index + 1) & capacity;
+    Entry *pnext = entries + next;
+    if (NULL == pnext->key || 0 == PROBE_LENGTH(pnext, next, capacity)) break;
+
+    entries[index] = *pnext;
+    index = next;
+  }
+  entries[index].key = NULL;
+  entries[index].value = NULL;
+}
+
 static void adjust_capacity(Table *table, size_t capacity) {
   assert(NULL != table);
 
-  Entry *entries = a_allocate(sizeof(Entry) * (capacity + 1));
+  // a resize in progress is finished first, so the old array is empty
+  migrate(table, (size_t)-1);
 
-  for (size_t i = 0; i <= capacity; ++i) {
-    entries[i].key = NULL;
-    entries[i].value = NULL;
+  Entry *entries = take_cleared_entries(table, capacity);
+
+  if (table->capacity < 0) {
+    for (size_t i = 0; i < table->count; ++i) {
+      insert_entry(entries, capacity, table->inline_entries[i]);
+    }
   }
-  
   for (ssize_t i = 0; i <= table->capacity; ++i) {
     Entry *pentry = table->entries + i;
     if (NULL == pentry->key) continue;
 
-    Entry *dest = find_entry(entries, capacity, pentry->key, 
-                             table->hash_func, table->key_cmp_func);
-    dest->key = pentry->key;
-    dest->value = pentry->value;
+    insert_entry(entries, capacity, *pentry);
   }
 
-  a_free(table->entries);
+  allocator_free(table->p_allocator, table->entries);
   table->entries = entries;
   table->capacity = capacity;
-  table->tombstones_count = 0;
 }
 
+static void start_resize(Table *table, size_t capacity) {
+  assert(NULL != table);
+
+  migrate(table, (size_t)-1);
+
+  Entry *entries = take_cleared_entries(table, capacity);
+
+  table->old_entries = table->entries;
+  table->old_capacity = table->capacity;
+  table->old_count = table->count;
+  table->migrate_index = 0;
+  table->entries = entries;
+  table->capacity = capacity;
+}
+
+static void migrate(Table *table, size_t buckets_count) {
+  if (NULL == table->old_entries) return;
+
+  // removing an entry shifts the following ones back into the visited bucket,
+  // so the index advances over empty buckets only and no entry is left
+  // behind it, entries wrapped over the array end sit at its start
+  // and are moved first
+  for (size_t i = 0; i < buckets_count && 0 != table->old_count; ++i) {
+    assert(table->migrate_index <= (size_t)table->old_capacity);
+
+    Entry *pentry = table->old_entries + table->migrate_index;
+    if (NULL == pentry->key) {
+      ++table->migrate_index;
+      continue;
+    }
+
+    insert_entry(table->entries, table->capacity, *pentry);
+    remove_entry(table->old_entries, table->old_capacity, pentry);
+    --table->old_count;
+  }
+
+  if (0 != table->old_count) return;
+
+  allocator_free(table->p_allocator, table->old_entries);
+  table->old_entries = NULL;
+  table->old_capacity = -1;
+  table->migrate_index = 0;
+}
+
+static void clear_entries(Entry *entries, size_t from, size_t to) {
+  for (size_t i = from; i < to; ++i) {
+    entries[i].key = NULL;
+    entries[i].value = NULL;
+  }
+}
+
+static void prepare_resize(Table *table) {
+  if (table->capacity < 0 || NULL != table->old_entries) return;
+
+  if (NULL == table->next_entries) {
+    if ((table->capacity + 1) * TABLE_PREPARE_LOAD > table->count) return;
+
+    size_t capacity = GROW_CAPACITY(table->capacity + 1) - 1;
+    table->next_entries = allocator_allocate(table->p_allocator, sizeof(Entry) * (capacity + 1));
+    if (NULL == table->next_entries) {
+      logf_fatal("TABLE", 137, "allocation for table with capacity %lu failed!", capacity);
+    }
+    table->next_capacity = capacity;
+    table->next_cleared_index = 0;
+  }
+
+  size_t end = table->next_cleared_index + CLEAR_BUCKETS;
+  if (end > (size_t)table->next_capacity + 1) end = table->next_capacity + 1;
+  clear_entries(table->next_entries, table->next_cleared_index, end);
+  table->next_cleared_index = end;
+}
+
+static Entry *take_cleared_entries(Table *table, size_t capacity) {
+  Entry *entries = table->next_entries;
+  size_t cleared_count = table->next_cleared_index;
+  if (NULL != entries && (size_t)table->next_capacity != capacity) {
+    allocator_free(table->p_allocator, entries);
+    entries = NULL;
+  }
+  table->next_entries = NULL;
+  table->next_capacity = -1;
+  table->next_cleared_index = 0;
+
+  if (NULL == entries) {
+    entries = allocator_allocate(table->p_allocator, sizeof(Entry) * (capacity + 1));
+    if (NULL == entries) {
+      logf_fatal("TABLE", 137, "allocation for table with capacity %lu failed!", capacity);
+    }
+    cleared_count = 0;
+  }
+
+  clear_entries(entries, cleared_count, capacity + 1);
+  return entries;
+}
+
+
+void table_get_probe_stats(const Table *table, TableProbeStats *p_stats) {
+  assert(NULL != table);
+  assert(NULL != p_stats);
+
+  p_stats->max_probe_length = 0;
+  p_stats->mean_probe_length = 0.0;
+  p_stats->probe_length_variance = 0.0;
+  if (0 == table->count) return;
+
+  size_t sum = 0;
+  size_t sum_of_squares = 0;
+  const Entry *arrays[] = { table->entries, table->old_entries };
+  ssize_t capacities[] = { table->capacity, table->old_capacity };
+  for (size_t a = 0; a < 2; ++a) {
+    for (ssize_t i = 0; i <= capacities[a]; ++i) {
+      const Entry *pentry = arrays[a] + i;
+      if (NULL == pentry->key) continue;
+
+      size_t probe_length = PROBE_LENGTH(pentry, (size_t)i, (size_t)capacities[a]);
+      if (probe_length > p_stats->max_probe_length) p_stats->max_probe_length = probe_length;
+      sum += probe_length;
+      sum_of_squares += probe_length * probe_length;
+    }
+  }
+
+  double mean = (double)sum / table->count;
+  p_stats->mean_probe_length = mean;
+  p_stats->probe_length_variance = (double)sum_of_squares / table->count - mean * mean;
+}
+
+
+
+
+/// Secrets of the hash, odd 64 bit constants with mixed bits
+#define HASH_SECRET0 0xa0761d6478bd642full
+#define HASH_SECRET1 0xe7037ed1a0b428dbull
+
+#define LSBS 0x0101010101010101ull
+#define MSBS 0x8080808080808080ull
+
+/// Bytes that can be read at once without crossing a page boundary
+#define HASH_PAGE_SIZE 4096
+
+static uint64_t g_hash_seed;
+
+/// Multiplies two 64 bit values and folds the 128 bit product,
+///   every input bit affects the upper half of the result
+static inline uint64_t hash_mix(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+  __uint128_t product = (__uint128_t)a * b;
+  return (uint64_t)product ^ (uint64_t)(product >> 64);
+#else
+  uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+  uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+  uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo;
+  uint64_t lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+  uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+  uint64_t hi = hi_hi + (hi_lo >> 32) + (cross >> 32);
+  return ((cross << 32) | (uint32_t)lo_lo) ^ hi;
+#endif
+}
+
+/// hash_mix with both inputs folded back into the result, so an input
+///   that makes the product zero does not wipe out the other one
+///   and the seed carried in it
+static inline uint64_t hash_mix_keep(uint64_t a, uint64_t b) {
+  return hash_mix(a, b) ^ a ^ b;
+}
+
+static inline uint64_t load_u64(const char *p) {
+  uint64_t word;
+  memcpy(&word, p, sizeof(word));
+  return word;
+}
+
+static inline uint64_t load_u32(const char *p) {
+  uint32_t word;
+  memcpy(&word, p, sizeof(word));
+  return word;
+}
 
+/// Loads 1 to 8 bytes as if they were followed by zeros,
+///   overlapping loads cover every length without a loop
+static inline uint64_t load_partial(const char *p, size_t len) {
+  if (len >= 4) {
+    return load_u32(p) | load_u32(p + len - 4) << (8 * (len - 4));
+  }
+  return (uint64_t)(uint8_t)p[0]
+    | (uint64_t)(uint8_t)p[len / 2] << (8 * (len / 2))
+    | (uint64_t)(uint8_t)p[len - 1] << (8 * (len - 1));
+}
+
+static inline size_t hash_finish(uint64_t a, uint64_t b, size_t len, uint64_t seed) {
+  return hash_mix(HASH_SECRET1 ^ len, hash_mix_keep(a ^ HASH_SECRET1, b ^ seed));
+}
 
+size_t hash_bytes_seeded(const void *p_bytes, size_t len, size_t seed) {
+  assert(NULL != p_bytes || 0 == len);
 
-size_t hash_cstr_with_len(const char *str, size_t len) {
+  const char *p = p_bytes;
+  uint64_t state = seed ^ hash_mix(seed ^ HASH_SECRET0, HASH_SECRET1);
+
+  size_t left = len;
+  for (; left >= 16; left -= 16, p += 16) {
+    state = hash_mix_keep(load_u64(p) ^ HASH_SECRET1, load_u64(p + 8) ^ state);
+  }
+
+  uint64_t a = 0, b = 0;
+  if (left > 8) {
+    a = load_u64(p);
+    b = load_partial(p + 8, left - 8);
+  } else if (left > 0) {
+    a = load_partial(p, left);
+  }
+  return hash_finish(a, b, len, state);
+}
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+
+/// Keeps the first @len bytes of a word, zeroes the rest
+static inline uint64_t word_prefix(uint64_t word, size_t len) {
+  return 0 == len ? 0 : word & (~0ull >> (64 - 8 * len));
+}
+
+/// Loads the next 16 bytes of a C string, bytes after the terminator are zeroed
+///
+/// Both words are read at once when they do not cross a page boundary,
+///   so reading past the terminator never touches an unmapped page.
+/// @outparam p_a: first 8 bytes
+/// @outparam p_b: second 8 bytes
+/// @return size_t, number of string bytes loaded, 16 if there is no terminator
+#if defined(__has_attribute)
+#if __has_attribute(no_sanitize)
+__attribute__((no_sanitize("address")))
+#endif
+#endif
+static inline size_t load_cstr_block(const char *p, uint64_t *p_a, uint64_t *p_b) {
+  if (((uintptr_t)p & (HASH_PAGE_SIZE - 1)) > HASH_PAGE_SIZE - 16) {
+    uint64_t words[2] = { 0, 0 };
+    size_t len = 0;
+    for (; len < 16 && '\0' != p[len]; ++len) {
+      words[len / 8] |= (uint64_t)(uint8_t)p[len] << (8 * (len % 8));
+    }
+    *p_a = words[0];
+    *p_b = words[1];
+    return len;
+  }
+
+  // loaded here rather than by load_u64, which is checked by the sanitizer
+  uint64_t a, b;
+  memcpy(&a, p, sizeof(a));
+  memcpy(&b, p + 8, sizeof(b));
+
+  // the lowest set bit marks the first zero byte, bits above it may be false
+  uint64_t zero_a = (a - LSBS) & ~a & MSBS;
+  uint64_t zero_b = (b - LSBS) & ~b & MSBS;
+  if (0 == (zero_a | zero_b)) {
+    *p_a = a;
+    *p_b = b;
+    return 16;
+  }
+
+  if (0 != zero_a) {
+    size_t len = __builtin_ctzll(zero_a) / 8;
+    *p_a = word_prefix(a, len);
+    *p_b = 0;
+    return len;
+  }
+
+  size_t len = __builtin_ctzll(zero_b) / 8;
+  *p_a = a;
+  *p_b = word_prefix(b, len);
+  return 8 + len;
+}
+
+size_t hash_cstr_seeded(const char *str, size_t seed) {
   assert(NULL != str);
 
-  size_t hash = 2166136261lu;
+  const char *p = str;
+  uint64_t state = seed ^ hash_mix(seed ^ HASH_SECRET0, HASH_SECRET1);
+
+  // the same steps as hash_bytes_seeded, the length is found on the way
+  for (;;) {
+    uint64_t a, b;
+    size_t len = load_cstr_block(p, &a, &b);
+    if (16 != len) return hash_finish(a, b, (size_t)(p - str) + len, state);
 
-  for (size_t i = 0; i < len; ++i) {
-    hash ^= str[i];
-    hash *= 16777619;
+    state = hash_mix_keep(a ^ HASH_SECRET1, b ^ state);
+    p += 16;
   }
+}
+
+#else
+
+size_t hash_cstr_seeded(const char *str, size_t seed) {
+  assert(NULL != str);
+  return hash_bytes_seeded(str, strlen(str), seed);
+}
+
+#endif // !__ORDER_LITTLE_ENDIAN__
 
-  return hash;
+void hash_set_default_seed(size_t seed) {
+  g_hash_seed = seed;
 }
 
 size_t hash_cstr_default(const void *value) {
   assert(NULL != value);
   const char *str = (const char*)value;
-  return hash_cstr_with_len(str, strlen(str));
+  // vectorized strlen and the 16 byte steps outrun the single pass
+  // for all but the shortest keys
+  return hash_bytes_seeded(str, strlen(str), g_hash_seed);
 }
 
 size_t hash_string_view_default(const void *value) {
   assert(NULL != value);
   const StringView *sv = (const StringView*)value;
-  return hash_cstr_with_len(sv->p_begin, sv->length);
+  return hash_bytes_seeded(sv->p_begin, sv->length, g_hash_seed);
 }
 
 
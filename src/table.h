@@ -5,6 +5,8 @@
 #include <sys/types.h>
 #include <stdbool.h>
 
+#include "allocator.h"
+
 /// Represents an entry in a Table
 typedef struct {
   /// Key for finding entry in a Table
@@ -12,13 +14,32 @@ typedef struct {
 
   /// Value associated to the key
   void *value;
+
+  /// Hash of the key, cached so resizing does not call hash_func
+  ///   and probing calls key_cmp_func only when hashes are equal
+  size_t hash;
 } Entry;
 
 typedef size_t (*HashFunc)(const void* key);
 typedef bool (*KeyCmpFunc)(const void* lhs, const void *rhs);
 typedef void (*FreeKeyValFunc)(const void *key, void *value);
 
+/// Number of entries a table holds without allocating
+#define TABLE_INLINE_CAPACITY 8
+
 /// Represents a hash table based on open addresing approach
+/// Collisions are resolved by Robin Hood linear probing: an inserted entry
+///   takes the place of an entry that is closer to its home bucket.
+/// Deletion shifts following entries back, so there are no tombstones
+///   and probe lengths stay short under insert and delete churn.
+/// Up to TABLE_INLINE_CAPACITY entries are kept inside the table and scanned
+///   linearly, the entries array is allocated when there are more keys.
+/// In incremental resize mode growing allocates a bigger array only,
+///   entries are moved to it a few buckets at a time by following
+///   table_set and table_delete calls, lookups check both arrays meanwhile.
+///   The bigger array is allocated ahead of time once the table is half full
+///   and cleared a few buckets at a time by following table_set calls,
+///   so growing does not clear the whole array at once either.
 typedef struct {
   HashFunc hash_func;
   KeyCmpFunc key_cmp_func;
@@ -32,11 +53,41 @@ typedef struct {
   ///   for table look-up optimisation
   ssize_t capacity;
 
-  /// Number of tombstones elements in entries array
-  size_t tombstones_count;
-
-  /// Array of entries in hashtable
+  /// Array of entries in hashtable, NULL while entries are inline
   Entry *entries;
+
+  /// Entries of a table without the entries array (capacity is -1),
+  ///   the first count of them are taken
+  Entry inline_entries[TABLE_INLINE_CAPACITY];
+
+  /// Array entries are being moved from by incremental resize,
+  ///   NULL when no resize is in progress
+  Entry *old_entries;
+
+  /// Capacity of old_entries array, in the same form as capacity
+  ssize_t old_capacity;
+
+  /// Number of entries left in old_entries array
+  size_t old_count;
+
+  /// Buckets of old_entries array before this index are moved already
+  size_t migrate_index;
+
+  /// Array the next incremental resize will move entries to,
+  ///   NULL until the table is half full
+  Entry *next_entries;
+
+  /// Capacity of next_entries array, in the same form as capacity
+  ssize_t next_capacity;
+
+  /// Buckets of next_entries array before this index are cleared already
+  size_t next_cleared_index;
+
+  /// If true, growing does not move all entries at once
+  bool is_resize_incremental;
+
+  /// Allocator of the entries array, NULL for the global allocator
+  const Allocator *p_allocator;
 } Table;
 
 
@@ -52,6 +103,17 @@ void table_init(Table *table,
                 HashFunc hash_func, KeyCmpFunc key_cmp_func,
                 FreeKeyValFunc free_kv_func);
 
+/// Initializes the table to all zeros, the entries array will be allocated
+///   in @p_allocator (NULL for the global allocator)
+///
+/// @param p_allocator: allocator handle, it has to outlive the table
+/// @see table_init for the rest of parameters
+/// @return void
+void table_init_with_allocator(Table *table, 
+                               HashFunc hash_func, KeyCmpFunc key_cmp_func,
+                               FreeKeyValFunc free_kv_func,
+                               const Allocator *p_allocator);
+
 /// Frees underlying array of entries in the table 
 /// and initializes all fields in the table to zeros.
 ///
@@ -59,6 +121,16 @@ void table_init(Table *table,
 /// @return void
 void table_free(Table *table);
 
+/// Switches incremental resize mode of the table, which is off by default.
+/// It bounds the time of every table_set and table_delete call
+///   at the cost of slower lookups while a resize is in progress.
+/// Switching it off finishes the resize in progress.
+///
+/// @param table: pointer to the table
+/// @param is_incremental: true to spread resizes over following calls
+/// @return void
+void table_set_resize_incremental(Table *table, bool is_incremental);
+
 /// Inserts new value to the table by key,
 /// if key already exists, then overrides old value associated to that key
 ///
@@ -77,6 +149,35 @@ bool table_set(Table* table, const void *key, void *value);
 /// @return bool, true if value was found, false otherwise
 bool table_get(const Table* table, const void *key, void **value);
 
+/// Number of keys table_get_many and table_set_many hash and prefetch ahead
+#define TABLE_BATCH_SIZE 16
+
+/// Looks up for values of several keys at once.
+/// Keys are hashed and their buckets prefetched a batch ahead of the batch
+///   being looked up, so cache misses of different keys overlap instead
+///   of following each other. Keys of entries in home buckets with matching
+///   hashes are prefetched before they are compared.
+///
+/// @param table: pointer to the table to look up in
+/// @param keys: array of keys to look up
+/// @param count: number of keys
+/// @outparam values: array of count values, values of keys not found are untouched
+/// @outparam found: array of count flags set if the key was found, may be NULL
+/// @return size_t, number of keys found
+size_t table_get_many(const Table *table, const void *const *keys, size_t count,
+                      void **values, bool *found);
+
+/// Inserts or overrides values of several keys at once, see table_set.
+/// Keys are hashed and prefetched as in table_get_many.
+///
+/// @param table: pointer to table to insert values in
+/// @param keys: array of keys
+/// @param values: array of values associated to keys of the same index
+/// @param count: number of keys
+/// @return size_t, number of keys that were new
+size_t table_set_many(Table *table, const void *const *keys, void *const *values,
+                      size_t count);
+
 /// Deletes entry associated with the key in the table
 ///
 /// @param table: pointer to the table to delete from
@@ -84,7 +185,42 @@ bool table_get(const Table* table, const void *key, void **value);
 /// @return bool, true if entry was found and deleted, false otherwise
 bool table_delete(Table *table, const void *key);
 
-/// Inserts all entries from src to dest
+/// Distribution of distances of entries from their home buckets
+typedef struct {
+  size_t max_probe_length;
+  double mean_probe_length;
+  double probe_length_variance;
+} TableProbeStats;
+
+/// Computes probe length statistics over all entries of the table,
+///   it walks the whole entries array
+///
+/// @param table: pointer to the table to inspect
+/// @outparam p_stats: pointer to the statistics to fill
+/// @return void
+void table_get_probe_stats(const Table *table, TableProbeStats *p_stats);
+
+/// Grows the table once, so it holds @count keys without growing again
+///
+/// @param table: pointer to the table
+/// @param count: number of keys the table has to hold
+/// @return void
+void table_reserve(Table *table, size_t count);
+
+/// Inserts entries from an array, see table_set.
+/// The table grows at most once, for all of the entries at the start,
+///   so an empty table is filled with a single allocation.
+///
+/// @param table: pointer to the table to insert in
+/// @param entries: array of entries, their hash fields are not used
+/// @param count: number of entries
+/// @return size_t, number of keys that were new
+size_t table_build(Table *table, const Entry *entries, size_t count);
+
+/// Inserts all entries from src to dest.
+/// dest grows at most once, for the case no key of src is in dest,
+///   and when both tables have the same hash_func the hashes cached
+///   in src are used instead of hashing keys again.
 ///
 /// @param dest: destination table
 /// @param src: source table
@@ -93,7 +229,32 @@ void table_add_all(Table* dest, const Table *src);
 
 
 
+/// Hashes bytes with a seed, 16 bytes per step
+///
+/// @param p_bytes: pointer to the bytes to hash
+/// @param len: number of bytes
+/// @param seed: seed, hashes of the same bytes with different seeds are unrelated
+/// @return size_t, hash of the bytes
+size_t hash_bytes_seeded(const void *p_bytes, size_t len, size_t seed);
+
+/// Hashes a C string with a seed in a single pass, without calling strlen first,
+///   it is faster than strlen and hash_bytes_seeded for keys up to 8 bytes
+///
+/// @return size_t, the same hash as hash_bytes_seeded(str, strlen(str), seed)
+size_t hash_cstr_seeded(const char *str, size_t seed);
+
+/// Sets the seed hash_cstr_default and hash_string_view_default use, 0 by default
+/// A random seed set at startup keeps inputs that collide on purpose
+///   from flooding tables. Tables must be empty when the seed changes.
+///
+/// @param seed: new seed
+/// @return void
+void hash_set_default_seed(size_t seed);
+
+/// Default hash of C string keys, hash_bytes_seeded with the default seed
 size_t hash_cstr_default(const void *value);
+
+/// Default hash of StringView keys, equal to hash_cstr_default of the same characters
 size_t hash_string_view_default(const void *value);
 
 /// Default comparison function
@@ -0,0 +1,325 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "table.h"
+#include "string_view.h"
+#include "allocator.h"
+#include "logger.h"
+
+void init_allocator() {
+  size_t allocator_size = 4lu * 1024lu * 1024lu; // 4 MiB
+  if (!allocator_init(allocator_size)) {
+    abort();
+  }
+}
+
+LogSeverity g_log_severity = LOG_ALL;
+
+bool key_cmp_cstr(const void *lhs, const void *rhs) {
+  return 0 == strcmp(lhs, rhs);
+}
+
+#define KEYS_COUNT 1000
+
+static size_t g_freed_count;
+
+void free_kv_count(const void *key, void *value) {
+  (void)key;
+  (void)value;
+  ++g_freed_count;
+}
+
+void test_inline_entries(char (*keys)[16]) {
+  AllocatorStats before, after;
+  allocator_get_stats(&before);
+
+  Table table;
+  table_init(&table, hash_cstr_default, key_cmp_cstr, free_kv_count);
+  for (size_t i = 0; i < TABLE_INLINE_CAPACITY; ++i) {
+    assert(table_set(&table, keys[i], (void*)(i + 1)));
+  }
+  assert(!table_set(&table, keys[0], (void*)1));
+  assert(table_delete(&table, keys[1]));
+  assert(!table_delete(&table, keys[1]));
+  assert(table_set(&table, keys[1], (void*)2));
+
+  void *value = NULL;
+  for (size_t i = 0; i < TABLE_INLINE_CAPACITY; ++i) {
+    assert(table_get(&table, keys[i], &value));
+    assert(i + 1 == (size_t)value);
+  }
+  assert(!table_get(&table, keys[TABLE_INLINE_CAPACITY], &value));
+  assert(NULL == table.entries);
+
+  allocator_get_stats(&after);
+  assert(before.allocs_count == after.allocs_count);
+
+  // one more key moves the entries to an array
+  assert(table_set(&table, keys[TABLE_INLINE_CAPACITY], (void*)(TABLE_INLINE_CAPACITY + 1)));
+  assert(NULL != table.entries);
+  for (size_t i = 0; i <= TABLE_INLINE_CAPACITY; ++i) {
+    assert(table_get(&table, keys[i], &value));
+    assert(i + 1 == (size_t)value);
+  }
+
+  g_freed_count = 0;
+  table_free(&table);
+  assert(TABLE_INLINE_CAPACITY + 1 == g_freed_count);
+}
+
+void test_hash() {
+  // the string ends at a page end, so the single pass cstr hash
+  // has to avoid reading past it
+  static char page[2 * 4096] __attribute__((aligned(4096)));
+  char *buf = page + 4096 - 48;
+  for (size_t i = 0; i < 48; ++i) buf[i] = (char)('a' + i % 26);
+
+  for (size_t offset = 0; offset < 8; ++offset) {
+    for (size_t len = 0; offset + len < 48; ++len) {
+      char saved = buf[offset + len];
+      buf[offset + len] = '\0';
+      assert(hash_cstr_seeded(buf + offset, 42) == hash_bytes_seeded(buf + offset, len, 42));
+      buf[offset + len] = saved;
+    }
+  }
+  buf[47] = '\0';
+  assert(hash_cstr_seeded(buf + 40, 42) == hash_bytes_seeded(buf + 40, 7, 42));
+
+  assert(hash_cstr_seeded("key", 1) != hash_cstr_seeded("key", 2));
+  assert(hash_cstr_seeded("key", 1) != hash_cstr_seeded("kez", 1));
+  assert(hash_bytes_seeded("a\0", 2, 1) != hash_bytes_seeded("a", 1, 1));
+
+  // a word equal to the secret the hash xors it with zeroes the product,
+  // the rest of the key and the seed still have to count
+  uint64_t secret = 0xe7037ed1a0b428dbull;
+  char lhs[40], rhs[40];
+  memset(lhs, 'x', sizeof(lhs));
+  memcpy(lhs, &secret, sizeof(secret));
+  memcpy(rhs, lhs, sizeof(lhs));
+  rhs[8] = 'y';
+  for (size_t len = 9; len <= sizeof(lhs); len += 7) {
+    assert(hash_bytes_seeded(lhs, len, 1) != hash_bytes_seeded(rhs, len, 1));
+    assert(hash_bytes_seeded(lhs, len, 1) != hash_bytes_seeded(lhs, len, 2));
+    assert(hash_bytes_seeded(lhs, len, 1) - hash_bytes_seeded(rhs, len, 1)
+           != hash_bytes_seeded(lhs, len, 2) - hash_bytes_seeded(rhs, len, 2));
+  }
+
+  StringView sv = string_view_from_cstr("some/long/path/key");
+  assert(hash_cstr_default("some/long/path/key") == hash_string_view_default(&sv));
+}
+
+static size_t g_hash_count;
+
+size_t hash_cstr_counting(const void *value) {
+  ++g_hash_count;
+  return hash_cstr_default(value);
+}
+
+void test_bulk(char (*keys)[16]) {
+  static Entry entries[KEYS_COUNT];
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    entries[i] = (Entry){ .key = keys[i], .value = (void*)(i + 1) };
+  }
+
+  // reserved table does not grow while filled
+  Table table;
+  table_init(&table, hash_cstr_counting, key_cmp_cstr, NULL);
+  table_reserve(&table, TABLE_INLINE_CAPACITY);
+  assert(NULL == table.entries);
+  table_reserve(&table, KEYS_COUNT);
+  ssize_t capacity = table.capacity;
+  assert((capacity + 1) * 3 / 4 > KEYS_COUNT);
+  for (size_t i = 0; i < KEYS_COUNT; ++i) table_set(&table, keys[i], (void*)(i + 1));
+  assert(capacity == table.capacity);
+  table_reserve(&table, KEYS_COUNT / 2);
+  assert(capacity == table.capacity);
+  table_free(&table);
+
+  // building counts only new keys, duplicates override values
+  table_init(&table, hash_cstr_counting, key_cmp_cstr, NULL);
+  assert(KEYS_COUNT / 2 == table_build(&table, entries, KEYS_COUNT / 2));
+  assert(KEYS_COUNT / 2 == table_build(&table, entries, KEYS_COUNT));
+  assert(KEYS_COUNT == table.count);
+  void *value = NULL;
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    assert(table_get(&table, keys[i], &value));
+    assert(i + 1 == (size_t)value);
+  }
+
+  // merging tables of the same hash function does not hash keys again
+  Table copy;
+  table_init(&copy, hash_cstr_counting, key_cmp_cstr, NULL);
+  assert(TABLE_INLINE_CAPACITY == table_build(&copy, entries, TABLE_INLINE_CAPACITY));
+  g_hash_count = 0;
+  table_add_all(&copy, &table);
+  assert(0 == g_hash_count);
+  assert(KEYS_COUNT == copy.count);
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    assert(table_get(&copy, keys[i], &value));
+    assert(i + 1 == (size_t)value);
+  }
+  table_add_all(&copy, &copy);
+  assert(KEYS_COUNT == copy.count);
+  table_free(&copy);
+
+  // a few keys of a big table are added with a single allocation
+  Table sparse;
+  table_init(&sparse, hash_cstr_default, key_cmp_cstr, NULL);
+  table_reserve(&sparse, KEYS_COUNT);
+  table_build(&sparse, entries, 30);
+  table_init(&copy, hash_cstr_default, key_cmp_cstr, NULL);
+  table_build(&copy, entries + 30, 10);
+  AllocatorStats before, after;
+  allocator_get_stats(&before);
+  table_add_all(&copy, &sparse);
+  allocator_get_stats(&after);
+  assert(before.allocs_count + 1 == after.allocs_count);
+  assert(sparse.capacity == copy.capacity);
+  assert(40 == copy.count);
+  table_free(&copy);
+  table_free(&sparse);
+
+  table_init(&copy, hash_cstr_default, key_cmp_cstr, NULL);
+  table_add_all(&copy, &table);
+  assert(KEYS_COUNT == copy.count);
+  assert(table_get(&copy, keys[KEYS_COUNT - 1], &value));
+  table_free(&copy);
+
+  table_free(&table);
+}
+
+int main() {
+  init_allocator();
+  atexit(allocator_finalize);
+
+  test_hash();
+
+  static char keys[KEYS_COUNT][16];
+  for (size_t i = 0; i < KEYS_COUNT; ++i) snprintf(keys[i], sizeof(keys[i]), "key_%zu", i);
+
+  test_inline_entries(keys);
+  test_bulk(keys);
+
+  Table table;
+  table_init(&table, hash_cstr_default, key_cmp_cstr, NULL);
+
+  void *value = NULL;
+  assert(!table_get(&table, "key_0", &value));
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    assert(table_set(&table, keys[i], (void*)(i + 1)));
+  }
+  assert(!table_set(&table, keys[3], (void*)4));
+  assert(KEYS_COUNT == table.count);
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    assert(table_get(&table, keys[i], &value));
+    assert(i + 1 == (size_t)value);
+  }
+  assert(!table_get(&table, "missing", &value));
+
+  // churn: deleted keys leave no tombstones, so the table never grows
+  // and the remaining keys stay reachable
+  ssize_t capacity = table.capacity;
+  for (size_t round = 0; round < 10; ++round) {
+    for (size_t i = round % 2; i < KEYS_COUNT; i += 2) {
+      assert(table_delete(&table, keys[i]));
+      assert(!table_delete(&table, keys[i]));
+    }
+    for (size_t i = 0; i < KEYS_COUNT; ++i) {
+      assert((i % 2 != round % 2) == table_get(&table, keys[i], &value));
+    }
+    for (size_t i = round % 2; i < KEYS_COUNT; i += 2) {
+      assert(table_set(&table, keys[i], (void*)(i + 1)));
+    }
+  }
+  assert(capacity == table.capacity);
+  assert(KEYS_COUNT == table.count);
+
+  TableProbeStats stats;
+  table_get_probe_stats(&table, &stats);
+  assert(stats.mean_probe_length < 2.0);
+  assert(stats.max_probe_length < 32);
+
+  Table copy;
+  table_init(&copy, hash_cstr_default, key_cmp_cstr, NULL);
+  table_add_all(&copy, &table);
+  assert(KEYS_COUNT == copy.count);
+  table_free(&copy);
+
+  // batched operations, with a count that is not a multiple of the batch
+  static const void *batch_keys[KEYS_COUNT + 1];
+  static void *batch_values[KEYS_COUNT + 1];
+  static bool batch_found[KEYS_COUNT + 1];
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    batch_keys[i] = keys[i];
+    batch_values[i] = (void*)(i + 2);
+  }
+  batch_keys[KEYS_COUNT] = "missing";
+
+  table_init(&copy, hash_cstr_default, key_cmp_cstr, NULL);
+  assert(0 == table_get_many(&copy, batch_keys, KEYS_COUNT + 1, batch_values, batch_found));
+  assert(!batch_found[0]);
+  assert(KEYS_COUNT / 2 == table_set_many(&copy, batch_keys, batch_values, KEYS_COUNT / 2));
+  assert(KEYS_COUNT / 2 == table_set_many(&copy, batch_keys, batch_values, KEYS_COUNT));
+  assert(KEYS_COUNT == copy.count);
+  table_free(&copy);
+
+  for (size_t i = 0; i <= KEYS_COUNT; ++i) batch_values[i] = NULL;
+  assert(KEYS_COUNT == table_get_many(&table, batch_keys, KEYS_COUNT + 1, batch_values, batch_found));
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    assert(batch_found[i]);
+    assert(i + 1 == (size_t)batch_values[i]);
+  }
+  assert(!batch_found[KEYS_COUNT]);
+  assert(NULL == batch_values[KEYS_COUNT]);
+
+  table_free(&table);
+
+  // incremental resize: keys stay reachable while they are spread
+  // over both arrays, and the old array is drained before the next grow
+  Table incremental;
+  table_init(&incremental, hash_cstr_default, key_cmp_cstr, NULL);
+  table_set_resize_incremental(&incremental, true);
+  bool was_resizing = false;
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    // the next array is cleared by the time the table grows into it
+    if (incremental.capacity >= 0 && NULL == incremental.old_entries
+        && (incremental.capacity + 1) * .75 <= incremental.count + 1) {
+      assert(NULL != incremental.next_entries);
+      assert((size_t)incremental.next_capacity + 1 == incremental.next_cleared_index);
+    }
+    assert(table_set(&incremental, keys[i], (void*)(i + 1)));
+    was_resizing |= NULL != incremental.old_entries;
+    if (0 == i % 3 && i > 0) {
+      assert(table_delete(&incremental, keys[i - 1]));
+      assert(table_set(&incremental, keys[i - 1], (void*)i));
+    }
+    for (size_t j = 0; j <= i; j += 7) {
+      assert(table_get(&incremental, keys[j], &value));
+      assert(j + 1 == (size_t)value);
+    }
+  }
+  assert(was_resizing);
+  assert(KEYS_COUNT == incremental.count);
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    assert(table_get(&incremental, keys[i], &value));
+    assert(i + 1 == (size_t)value);
+  }
+
+  table_init(&copy, hash_cstr_default, key_cmp_cstr, NULL);
+  table_add_all(&copy, &incremental);
+  assert(KEYS_COUNT == copy.count);
+  table_free(&copy);
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    assert(table_delete(&incremental, keys[i]));
+  }
+  assert(0 == incremental.count);
+  assert(NULL == incremental.old_entries);
+
+  table_free(&incremental);
+  return 0;
+}
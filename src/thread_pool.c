@@ -0,0 +1,255 @@
+#include <assert.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "thread_pool.h"
+#include "allocator.h"
+#include "logger.h"
+
+#define TASKS_MIN_CAPACITY 16
+
+/// Ranges of parallel_for per thread, more ranges even out uneven work
+#define RANGES_PER_THREAD 4
+
+#define DEFAULT_GRAIN 4096
+
+/// Takes a queued task, pool->lock has to be held
+static bool task_pop(ThreadPool *pool, Task *p_task) {
+  if (0 == pool->tasks_count) return false;
+
+  *p_task = pool->tasks[pool->tasks_head];
+  pool->tasks_head = (pool->tasks_head + 1) % pool->tasks_capacity;
+  --pool->tasks_count;
+  return true;
+}
+
+/// Runs the task and reports it is done, pool->lock has to be held
+static void task_run(ThreadPool *pool, Task task) {
+  pthread_mutex_unlock(&pool->lock);
+  task.func(task.arg);
+  pthread_mutex_lock(&pool->lock);
+
+  if (0 == --pool->unfinished_count) pthread_cond_broadcast(&pool->is_done);
+}
+
+static void *worker_main(void *arg) {
+  ThreadPool *pool = arg;
+
+  pthread_mutex_lock(&pool->lock);
+  for (;;) {
+    Task task;
+    if (task_pop(pool, &task)) {
+      task_run(pool, task);
+    } else if (pool->is_stopping) {
+      break;
+    } else {
+      pthread_cond_wait(&pool->has_tasks, &pool->lock);
+    }
+  }
+  pthread_mutex_unlock(&pool->lock);
+
+  return NULL;
+}
+
+bool thread_pool_init(ThreadPool *pool, size_t workers_count) {
+  assert(NULL != pool);
+
+  if (THREAD_POOL_DEFAULT_WORKERS == workers_count) {
+    long cpus_count = sysconf(_SC_NPROCESSORS_ONLN);
+    workers_count = cpus_count > 1 ? (size_t)cpus_count - 1 : 0;
+  }
+
+  pool->workers_count = 0;
+  pool->tasks = NULL;
+  pool->tasks_capacity = 0;
+  pool->tasks_head = 0;
+  pool->tasks_count = 0;
+  pool->unfinished_count = 0;
+  pool->is_stopping = false;
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->has_tasks, NULL);
+  pthread_cond_init(&pool->is_done, NULL);
+
+  pool->threads = NULL;
+  if (0 == workers_count) return true;
+
+  pool->threads = a_allocate(sizeof(pthread_t) * workers_count);
+  if (NULL == pool->threads) {
+    thread_pool_free(pool);
+    return false;
+  }
+
+  for (size_t i = 0; i < workers_count; ++i) {
+    if (0 != pthread_create(&pool->threads[i], NULL, worker_main, pool)) {
+      log_error("THREAD_POOL", "failed to start a worker thread");
+      thread_pool_free(pool);
+      return false;
+    }
+    ++pool->workers_count;
+  }
+
+  return true;
+}
+
+void thread_pool_free(ThreadPool *pool) {
+  assert(NULL != pool);
+
+  thread_pool_wait(pool);
+
+  pthread_mutex_lock(&pool->lock);
+  pool->is_stopping = true;
+  pthread_cond_broadcast(&pool->has_tasks);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (size_t i = 0; i < pool->workers_count; ++i) pthread_join(pool->threads[i], NULL);
+
+  pthread_cond_destroy(&pool->is_done);
+  pthread_cond_destroy(&pool->has_tasks);
+  pthread_mutex_destroy(&pool->lock);
+
+  a_free(pool->threads);
+  a_free(pool->tasks);
+  pool->threads = NULL;
+  pool->workers_count = 0;
+  pool->tasks = NULL;
+  pool->tasks_capacity = 0;
+}
+
+size_t thread_pool_threads_count(const ThreadPool *pool) {
+  assert(NULL != pool);
+  return pool->workers_count + 1;
+}
+
+void thread_pool_submit(ThreadPool *pool, TaskFunc func, void *arg) {
+  assert(NULL != pool);
+  assert(NULL != func);
+
+  pthread_mutex_lock(&pool->lock);
+
+  if (pool->tasks_count == pool->tasks_capacity) {
+    size_t capacity = 0 == pool->tasks_capacity ? TASKS_MIN_CAPACITY : pool->tasks_capacity * 2;
+    Task *tasks = a_allocate(sizeof(Task) * capacity);
+    if (NULL == tasks) logf_fatal("THREAD_POOL", 137, "allocation for %lu tasks failed!", capacity);
+
+    // unwrap the ring so queued tasks start at 0
+    for (size_t i = 0; i < pool->tasks_count; ++i) {
+      tasks[i] = pool->tasks[(pool->tasks_head + i) % pool->tasks_capacity];
+    }
+    a_free(pool->tasks);
+    pool->tasks = tasks;
+    pool->tasks_capacity = capacity;
+    pool->tasks_head = 0;
+  }
+
+  pool->tasks[(pool->tasks_head + pool->tasks_count) % pool->tasks_capacity] = (Task){ func, arg };
+  ++pool->tasks_count;
+  ++pool->unfinished_count;
+
+  pthread_cond_signal(&pool->has_tasks);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+void thread_pool_wait(ThreadPool *pool) {
+  assert(NULL != pool);
+
+  pthread_mutex_lock(&pool->lock);
+  Task task;
+  while (task_pop(pool, &task)) task_run(pool, task);
+  while (0 != pool->unfinished_count) pthread_cond_wait(&pool->is_done, &pool->lock);
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/// Range of indices a task works on
+typedef struct {
+  size_t begin;
+  size_t end;
+  RangeFunc func;
+  RangeReduceFunc reduce_func;
+  void *ctx;
+  void *p_partial;
+} RangeTask;
+
+static void range_task_run(void *arg) {
+  RangeTask *p_task = arg;
+  p_task->func(p_task->ctx, p_task->begin, p_task->end);
+}
+
+static void range_task_reduce(void *arg) {
+  RangeTask *p_task = arg;
+  p_task->reduce_func(p_task->ctx, p_task->begin, p_task->end, p_task->p_partial);
+}
+
+/// Number of ranges [0, count) is split into
+static size_t ranges_count(const ThreadPool *pool, size_t count, size_t grain) {
+  if (0 == grain) grain = DEFAULT_GRAIN;
+
+  size_t max_count = (count + grain - 1) / grain;
+  size_t target_count = thread_pool_threads_count(pool) * RANGES_PER_THREAD;
+  return max_count < target_count ? max_count : target_count;
+}
+
+/// Allocates and submits @ranges tasks covering [0, count) evenly,
+///   partials of reduce tasks are @value_size bytes each in @partials
+static RangeTask *submit_ranges(ThreadPool *pool, size_t count, size_t ranges,
+                                TaskFunc task_func, RangeTask proto,
+                                char *partials, size_t value_size) {
+  RangeTask *tasks = a_allocate(sizeof(RangeTask) * ranges);
+  if (NULL == tasks) logf_fatal("THREAD_POOL", 137, "allocation for %lu ranges failed!", ranges);
+
+  for (size_t i = 0; i < ranges; ++i) {
+    tasks[i] = proto;
+    tasks[i].begin = count / ranges * i + (i < count % ranges ? i : count % ranges);
+    tasks[i].end = tasks[i].begin + count / ranges + (i < count % ranges);
+    if (NULL != partials) tasks[i].p_partial = partials + i * value_size;
+  }
+  for (size_t i = 0; i < ranges; ++i) thread_pool_submit(pool, task_func, tasks + i);
+
+  return tasks;
+}
+
+void thread_pool_parallel_for(ThreadPool *pool, size_t count, size_t grain,
+                              RangeFunc func, void *ctx) {
+  assert(NULL != pool);
+  assert(NULL != func);
+
+  size_t ranges = ranges_count(pool, count, grain);
+  if (ranges <= 1) {
+    if (0 != count) func(ctx, 0, count);
+    return;
+  }
+
+  RangeTask *tasks = submit_ranges(pool, count, ranges, range_task_run,
+                                   (RangeTask){ .func = func, .ctx = ctx }, NULL, 0);
+  thread_pool_wait(pool);
+  a_free(tasks);
+}
+
+void thread_pool_parallel_reduce(ThreadPool *pool, size_t count, size_t grain,
+                                 size_t value_size, const void *p_identity,
+                                 RangeReduceFunc reduce_func, CombineFunc combine_func,
+                                 void *ctx, void *p_result) {
+  assert(NULL != pool);
+  assert(NULL != reduce_func);
+  assert(NULL != combine_func);
+  assert(NULL != p_result);
+
+  size_t ranges = ranges_count(pool, count, grain);
+  if (0 == ranges) return;
+
+  char *partials = a_allocate(value_size * ranges);
+  if (NULL == partials) logf_fatal("THREAD_POOL", 137, "allocation for %lu partials failed!", ranges);
+  for (size_t i = 0; i < ranges; ++i) memcpy(partials + i * value_size, p_identity, value_size);
+
+  if (1 == ranges) {
+    reduce_func(ctx, 0, count, partials);
+  } else {
+    RangeTask *tasks = submit_ranges(pool, count, ranges, range_task_reduce,
+                                     (RangeTask){ .reduce_func = reduce_func, .ctx = ctx },
+                                     partials, value_size);
+    thread_pool_wait(pool);
+    a_free(tasks);
+  }
+
+  for (size_t i = 0; i < ranges; ++i) combine_func(ctx, p_result, partials + i * value_size);
+  a_free(partials);
+}
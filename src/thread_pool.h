@@ -0,0 +1,122 @@
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+typedef void (*TaskFunc)(void *arg);
+
+/// Called for a range [begin, end) of indices
+typedef void (*RangeFunc)(void *ctx, size_t begin, size_t end);
+
+/// Reduces a range [begin, end) of indices into @p_partial,
+///   which holds a copy of the identity value before the call
+typedef void (*RangeReduceFunc)(void *ctx, size_t begin, size_t end, void *p_partial);
+
+/// Combines @p_partial into @p_result
+typedef void (*CombineFunc)(void *ctx, void *p_result, const void *p_partial);
+
+typedef struct {
+  TaskFunc func;
+  void *arg;
+} Task;
+
+/// Fixed set of worker threads running tasks from a shared queue.
+///
+/// Tasks are submitted and waited for by the thread that owns the pool,
+///   thread_pool_wait runs queued tasks on the owner thread as well,
+///   so a pool without workers runs everything in thread_pool_wait.
+/// The queue is grown in the global allocator by the owner thread only,
+///   workers do not allocate.
+typedef struct {
+  pthread_t *threads;
+  size_t workers_count;
+
+  pthread_mutex_t lock;
+
+  /// Signaled when a task is queued or the pool is stopping
+  pthread_cond_t has_tasks;
+
+  /// Signaled when the last unfinished task is done
+  pthread_cond_t is_done;
+
+  /// Ring buffer of queued tasks
+  Task *tasks;
+  size_t tasks_capacity;
+  size_t tasks_head;
+  size_t tasks_count;
+
+  /// Number of tasks submitted and not finished yet
+  size_t unfinished_count;
+
+  bool is_stopping;
+} ThreadPool;
+
+
+/// Starts worker threads of the pool
+///
+/// @param pool: pointer to the pool to be initialized
+/// @param workers_count: number of worker threads besides the owner thread,
+///   THREAD_POOL_DEFAULT_WORKERS for one less than the number of online CPUs
+/// @return bool, true on success, false if a thread could not be started
+bool thread_pool_init(ThreadPool *pool, size_t workers_count);
+
+#define THREAD_POOL_DEFAULT_WORKERS ((size_t)-1)
+
+/// Waits for submitted tasks, stops worker threads and frees the queue
+///
+/// @param pool: pointer to the pool to be freed
+/// @return void
+void thread_pool_free(ThreadPool *pool);
+
+/// Returns the number of threads tasks run on, the owner thread included
+size_t thread_pool_threads_count(const ThreadPool *pool);
+
+/// Queues a task, it runs on a worker or on the owner thread in thread_pool_wait
+///
+/// @param pool: pointer to the pool
+/// @param func: function of the task
+/// @param arg: argument passed to func, it has to live until the task is done
+/// @return void
+void thread_pool_submit(ThreadPool *pool, TaskFunc func, void *arg);
+
+/// Runs queued tasks on the calling thread and waits until all submitted tasks are done
+///
+/// @param pool: pointer to the pool
+/// @return void
+void thread_pool_wait(ThreadPool *pool);
+
+/// Splits [0, count) into ranges of at least @grain indices
+///   and calls func for each of them in parallel, then waits for all of them
+///
+/// @param pool: pointer to the pool
+/// @param count: number of indices
+/// @param grain: minimal number of indices in a range, 0 for the default
+/// @param func: function called for each range
+/// @param ctx: context passed to func
+/// @return void
+void thread_pool_parallel_for(ThreadPool *pool, size_t count, size_t grain,
+                              RangeFunc func, void *ctx);
+
+/// Reduces [0, count) in parallel: each range is reduced by reduce_func
+///   into its own partial value, partials are combined into @p_result
+///   by combine_func on the calling thread in the order of ranges
+///
+/// @param pool: pointer to the pool
+/// @param count: number of indices
+/// @param grain: minimal number of indices in a range, 0 for the default
+/// @param value_size: size of the reduced value in bytes
+/// @param p_identity: value each partial starts with
+/// @param reduce_func: function reducing a range into a partial
+/// @param combine_func: function combining a partial into the result
+/// @param ctx: context passed to reduce_func and combine_func
+/// @outparam p_result: reduced value, it is combined with partials, so
+///   it has to be initialized, e.g. to the identity
+/// @return void
+void thread_pool_parallel_reduce(ThreadPool *pool, size_t count, size_t grain,
+                                 size_t value_size, const void *p_identity,
+                                 RangeReduceFunc reduce_func, CombineFunc combine_func,
+                                 void *ctx, void *p_result);
+
+#endif // !__THREAD_POOL_H__
@@ -0,0 +1,100 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "thread_pool.h"
+#include "allocator.h"
+#include "logger.h"
+
+void init_allocator() {
+  size_t allocator_size = 4lu * 1024lu * 1024lu; // 4 MiB
+  if (!allocator_init(allocator_size)) {
+    abort();
+  }
+}
+
+LogSeverity g_log_severity = LOG_ALL;
+
+#define TASKS_COUNT 1000
+
+void task_increment(void *arg) {
+  __atomic_fetch_add((size_t*)arg, 1, __ATOMIC_RELAXED);
+}
+
+typedef struct {
+  long long *items;
+  size_t *visits;
+} RangeCtx;
+
+void range_visit(void *ctx, size_t begin, size_t end) {
+  RangeCtx *p_ctx = ctx;
+  for (size_t i = begin; i < end; ++i) ++p_ctx->visits[i];
+}
+
+void range_sum(void *ctx, size_t begin, size_t end, void *p_partial) {
+  RangeCtx *p_ctx = ctx;
+  long long sum = 0;
+  for (size_t i = begin; i < end; ++i) sum += p_ctx->items[i];
+  *(long long*)p_partial += sum;
+}
+
+void combine_sum(void *ctx, void *p_result, const void *p_partial) {
+  (void)ctx;
+  *(long long*)p_result += *(const long long*)p_partial;
+}
+
+void test_pool(size_t workers_count) {
+  ThreadPool pool;
+  assert(thread_pool_init(&pool, workers_count));
+  assert(workers_count + 1 == thread_pool_threads_count(&pool));
+
+  // tasks outnumber the initial queue, so it grows
+  size_t counter = 0;
+  for (size_t i = 0; i < TASKS_COUNT; ++i) thread_pool_submit(&pool, task_increment, &counter);
+  thread_pool_wait(&pool);
+  assert(TASKS_COUNT == counter);
+
+  enum { ITEMS_COUNT = 100000 };
+  static long long items[ITEMS_COUNT];
+  static size_t visits[ITEMS_COUNT];
+  for (size_t i = 0; i < ITEMS_COUNT; ++i) {
+    items[i] = (long long)i;
+    visits[i] = 0;
+  }
+  RangeCtx ctx = { items, visits };
+
+  // every index is visited exactly once, whatever the grain
+  size_t grains[] = { 0, 1, 1000, ITEMS_COUNT * 2 };
+  for (size_t g = 0; g < sizeof(grains) / sizeof(grains[0]); ++g) {
+    thread_pool_parallel_for(&pool, ITEMS_COUNT, grains[g], range_visit, &ctx);
+    for (size_t i = 0; i < ITEMS_COUNT; ++i) assert(g + 1 == visits[i]);
+
+    long long identity = 0, sum = 0;
+    thread_pool_parallel_reduce(&pool, ITEMS_COUNT, grains[g], sizeof(long long), &identity,
+                                range_sum, combine_sum, &ctx, &sum);
+    assert((long long)ITEMS_COUNT * (ITEMS_COUNT - 1) / 2 == sum);
+  }
+
+  long long identity = 0, sum = 5;
+  thread_pool_parallel_reduce(&pool, 0, 0, sizeof(long long), &identity,
+                              range_sum, combine_sum, &ctx, &sum);
+  assert(5 == sum);
+  thread_pool_parallel_for(&pool, 0, 0, range_visit, &ctx);
+
+  // freeing waits for queued tasks
+  counter = 0;
+  for (size_t i = 0; i < TASKS_COUNT; ++i) thread_pool_submit(&pool, task_increment, &counter);
+  thread_pool_free(&pool);
+  assert(TASKS_COUNT == counter);
+}
+
+int main() {
+  init_allocator();
+  atexit(allocator_finalize);
+
+  test_pool(0);
+  test_pool(1);
+  test_pool(4);
+
+  return 0;
+}
@@ -0,0 +1,209 @@
+#ifndef __TYPED_TABLE_H__
+#define __TYPED_TABLE_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <sys/types.h>
+
+#include "allocator.h"
+#include "logger.h"
+#include "string_view.h"
+#include "table.h"
+
+/// Generator of hash tables specialized for a key and a value type.
+///
+/// TABLE_DEFINE(name, K, V, hash_func, eq_func) defines the table type `name`
+///   and static inline functions name##_init, name##_init_with_allocator,
+///   name##_free, name##_set, name##_get and name##_delete.
+/// Keys and values are stored in entries by value, hash_func and eq_func
+///   are called directly, so the compiler can inline them:
+///   size_t hash_func(K key), bool eq_func(K lhs, K rhs).
+/// Probing is the same as in Table: Robin Hood linear probing with the hash
+///   cached in each entry and backward shift deletion.
+///
+/// Example:
+///   TABLE_DEFINE(u64_table, uint64_t, void*, typed_table_hash_u64, typed_table_eq_u64)
+///   u64_table table;
+///   u64_table_init(&table);
+///   u64_table_set(&table, 42, p_value);
+
+#define TYPED_TABLE_MIN_CAPACITY 8
+
+/// Entries are grown when 3/4 of them are taken
+#define TYPED_TABLE_MAX_LOAD_NUMERATOR 3
+#define TYPED_TABLE_MAX_LOAD_DENOMINATOR 4
+
+/// Bit set in the hash of every taken entry, an empty entry has hash 0
+#define TYPED_TABLE_TAKEN ((size_t)1 << (sizeof(size_t) * 8 - 1))
+
+static inline size_t typed_table_hash_u64(uint64_t key) {
+  // finalizer of murmur3, every bit of the key affects the low bits
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdull;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ull;
+  key ^= key >> 33;
+  return (size_t)key;
+}
+
+static inline bool typed_table_eq_u64(uint64_t lhs, uint64_t rhs) {
+  return lhs == rhs;
+}
+
+static inline size_t typed_table_hash_string_view(StringView key) {
+  return hash_string_view_default(&key);
+}
+
+static inline bool typed_table_eq_string_view(StringView lhs, StringView rhs) {
+  return lhs.length == rhs.length && 0 == memcmp(lhs.p_begin, rhs.p_begin, lhs.length);
+}
+
+#define TABLE_DEFINE(name, K, V, hash_func, eq_func) \
+  typedef struct { \
+    K key; \
+    V value; \
+    /* hash of the key with TYPED_TABLE_TAKEN set, 0 if the entry is empty */ \
+    size_t hash; \
+  } name##_entry; \
+  \
+  typedef struct { \
+    /* number of keys in the table */ \
+    size_t count; \
+    /* capacity of entries array - 1, -1 if there is no array */ \
+    ssize_t capacity; \
+    name##_entry *entries; \
+    /* allocator of the entries array, NULL for the global allocator */ \
+    const Allocator *p_allocator; \
+  } name; \
+  \
+  static inline void name##_init_with_allocator(name *table, const Allocator *p_allocator) { \
+    assert(NULL != table); \
+    table->count = 0; \
+    table->capacity = -1; \
+    table->entries = NULL; \
+    table->p_allocator = p_allocator; \
+  } \
+  \
+  static inline void name##_init(name *table) { \
+    name##_init_with_allocator(table, NULL); \
+  } \
+  \
+  static inline void name##_free(name *table) { \
+    assert(NULL != table); \
+    allocator_free(table->p_allocator, table->entries); \
+    name##_init_with_allocator(table, NULL); \
+  } \
+  \
+  static inline size_t name##_hash(K key) { \
+    return hash_func(key) | TYPED_TABLE_TAKEN; \
+  } \
+  \
+  static inline name##_entry *name##_find_entry(const name *table, K key, size_t hash) { \
+    size_t capacity = (size_t)table->capacity; \
+    size_t index = hash & capacity; \
+    for (size_t probe_length = 0;; ++probe_length) { \
+      name##_entry *pentry = table->entries + index; \
+      if (0 == pentry->hash || ((index - pentry->hash) & capacity) < probe_length) { \
+        return NULL; \
+      } \
+      if (hash == pentry->hash && eq_func(key, pentry->key)) return pentry; \
+      index = (index + 1) & capacity; \
+    } \
+  } \
+  \
+  static inline void name##_insert_entry(name##_entry *entries, size_t capacity, \
+                                         name##_entry entry) { \
+    size_t index = entry.hash & capacity; \
+    for (size_t probe_length = 0;; ++probe_length) { \
+      name##_entry *pentry = entries + index; \
+      if (0 == pentry->hash) { \
+        *pentry = entry; \
+        return; \
+      } \
+      size_t entry_probe_length = (index - pentry->hash) & capacity; \
+      if (entry_probe_length < probe_length) { \
+        name##_entry displaced = *pentry; \
+        *pentry = entry; \
+        entry = displaced; \
+        probe_length = entry_probe_length; \
+      } \
+      index = (index + 1) & capacity; \
+    } \
+  } \
+  \
+  static inline void name##_adjust_capacity(name *table, size_t capacity) { \
+    name##_entry *entries = \
+      allocator_allocate(table->p_allocator, sizeof(name##_entry) * (capacity + 1)); \
+    if (NULL == entries) { \
+      logf_fatal("TYPED_TABLE", 137, "allocation for table with capacity %lu failed!", capacity); \
+    } \
+    for (size_t i = 0; i <= capacity; ++i) entries[i].hash = 0; \
+    for (ssize_t i = 0; i <= table->capacity; ++i) { \
+      if (0 != table->entries[i].hash) { \
+        name##_insert_entry(entries, capacity, table->entries[i]); \
+      } \
+    } \
+    allocator_free(table->p_allocator, table->entries); \
+    table->entries = entries; \
+    table->capacity = (ssize_t)capacity; \
+  } \
+  \
+  /* Inserts new value by key or overrides the value of an existing key */ \
+  /* @return bool, true if key is new, otherwise false */ \
+  static inline bool name##_set(name *table, K key, V value) { \
+    assert(NULL != table); \
+    size_t hash = name##_hash(key); \
+    if (0 != table->count) { \
+      name##_entry *pentry = name##_find_entry(table, key, hash); \
+      if (NULL != pentry) { \
+        pentry->value = value; \
+        return false; \
+      } \
+    } \
+    size_t capacity = (size_t)(table->capacity + 1); \
+    if (capacity * TYPED_TABLE_MAX_LOAD_NUMERATOR \
+        <= (table->count + 1) * TYPED_TABLE_MAX_LOAD_DENOMINATOR) { \
+      capacity = capacity < TYPED_TABLE_MIN_CAPACITY ? TYPED_TABLE_MIN_CAPACITY : capacity * 2; \
+      name##_adjust_capacity(table, capacity - 1); \
+    } \
+    name##_insert_entry(table->entries, (size_t)table->capacity, \
+                        (name##_entry){ .key = key, .value = value, .hash = hash }); \
+    ++table->count; \
+    return true; \
+  } \
+  \
+  /* @outparam p_value: found value (untouched if not found), may be NULL */ \
+  /* @return bool, true if value was found, false otherwise */ \
+  static inline bool name##_get(const name *table, K key, V *p_value) { \
+    assert(NULL != table); \
+    if (0 == table->count) return false; \
+    name##_entry *pentry = name##_find_entry(table, key, name##_hash(key)); \
+    if (NULL == pentry) return false; \
+    if (NULL != p_value) *p_value = pentry->value; \
+    return true; \
+  } \
+  \
+  /* @return bool, true if entry was found and deleted, false otherwise */ \
+  static inline bool name##_delete(name *table, K key) { \
+    assert(NULL != table); \
+    if (0 == table->count) return false; \
+    name##_entry *pentry = name##_find_entry(table, key, name##_hash(key)); \
+    if (NULL == pentry) return false; \
+    size_t capacity = (size_t)table->capacity; \
+    size_t index = (size_t)(pentry - table->entries); \
+    for (;;) { \
+      size_t next = (index + 1) & capacity; \
+      name##_entry *pnext = table->entries + next; \
+      if (0 == pnext->hash || 0 == ((next - pnext->hash) & capacity)) break; \
+      table->entries[index] = *pnext; \
+      index = next; \
+    } \
+    table->entries[index].hash = 0; \
+    --table->count; \
+    return true; \
+  }
+
+#endif // !__TYPED_TABLE_H__
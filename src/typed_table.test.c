@@ -0,0 +1,92 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "typed_table.h"
+#include "allocator.h"
+#include "logger.h"
+
+void init_allocator() {
+  size_t allocator_size = 4lu * 1024lu * 1024lu; // 4 MiB
+  if (!allocator_init(allocator_size)) {
+    abort();
+  }
+}
+
+LogSeverity g_log_severity = LOG_ALL;
+
+TABLE_DEFINE(u64_table, uint64_t, uint64_t, typed_table_hash_u64, typed_table_eq_u64)
+TABLE_DEFINE(sv_table, StringView, int, typed_table_hash_string_view, typed_table_eq_string_view)
+
+#define KEYS_COUNT 5000
+
+void test_u64() {
+  u64_table table;
+  u64_table_init(&table);
+
+  uint64_t value = 0;
+  assert(!u64_table_get(&table, 0, &value));
+  assert(!u64_table_delete(&table, 0));
+
+  // key 0 is an ordinary key, emptiness is kept in the hash
+  for (uint64_t i = 0; i < KEYS_COUNT; ++i) {
+    assert(u64_table_set(&table, i * 3, i));
+  }
+  assert(!u64_table_set(&table, 3, 100));
+  assert(KEYS_COUNT == table.count);
+
+  for (uint64_t i = 0; i < KEYS_COUNT; ++i) {
+    assert(u64_table_get(&table, i * 3, &value));
+    assert((1 == i ? 100 : i) == value);
+    assert(!u64_table_get(&table, i * 3 + 1, NULL));
+  }
+
+  for (uint64_t i = 0; i < KEYS_COUNT; i += 2) {
+    assert(u64_table_delete(&table, i * 3));
+    assert(!u64_table_delete(&table, i * 3));
+  }
+  assert(KEYS_COUNT / 2 == table.count);
+  for (uint64_t i = 0; i < KEYS_COUNT; ++i) {
+    assert((1 == i % 2) == u64_table_get(&table, i * 3, NULL));
+  }
+
+  u64_table_free(&table);
+  assert(0 == table.count);
+  assert(NULL == table.entries);
+}
+
+void test_string_view() {
+  static char keys[KEYS_COUNT][24];
+  for (size_t i = 0; i < KEYS_COUNT; ++i) snprintf(keys[i], sizeof(keys[i]), "path/to/key_%zu", i);
+
+  sv_table table;
+  sv_table_init(&table);
+
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    assert(sv_table_set(&table, string_view_from_cstr(keys[i]), (int)i));
+  }
+
+  // keys are compared by contents, not by address
+  char lookup[24];
+  int value = 0;
+  for (size_t i = 0; i < KEYS_COUNT; ++i) {
+    snprintf(lookup, sizeof(lookup), "path/to/key_%zu", i);
+    assert(sv_table_get(&table, string_view_from_cstr(lookup), &value));
+    assert((int)i == value);
+  }
+  assert(!sv_table_get(&table, string_view_from_cstr("path/to/key_"), &value));
+  assert(sv_table_get(&table, string_view_from_cstr_slice(keys[12], 0, 13), &value));
+  assert(1 == value);
+
+  sv_table_free(&table);
+}
+
+int main() {
+  init_allocator();
+  atexit(allocator_finalize);
+
+  test_u64();
+  test_string_view();
+
+  return 0;
+}
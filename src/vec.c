@@ -2,6 +2,19 @@
 
 #include "vec.h"
 
+/// Reallocates the vec to @capacity elements
+static void vec_reallocate(void **pp_vec, size_t el_size, size_t capacity) {
+  size_t prefix_size = vec_get_prefix_size(*pp_vec);
+  size_t old_cap = vec_get_header(*pp_vec)->capacity;
+  void *tmp = 
+    allocator_reallocate(vec_get_allocator(*pp_vec), vec_get_block(*pp_vec), 
+                         prefix_size + old_cap * el_size, 
+                         prefix_size + capacity * el_size);
+  if (NULL == tmp) logf_fatal("VEC", 137, "realocation for vector with new capacity %lu failed!", capacity); 
+  *pp_vec = (void*)((char*)tmp + prefix_size);
+  vec_get_header(*pp_vec)->capacity = capacity;
+}
+
 void vec_mb_expand(void **pp_vec, size_t el_size) {
   assert(pp_vec != NULL);
   assert(*pp_vec != NULL);
@@ -17,13 +30,35 @@ void vec_expand(void **pp_vec, size_t el_size) {
   assert(pp_vec != NULL);
   assert(*pp_vec != NULL);
 
+  vec_reallocate(pp_vec, el_size, vec_get_header(*pp_vec)->capacity * VEC_GROW_FACTOR);
+}
+
+void vec_grow_to(void **pp_vec, size_t el_size, size_t capacity) {
+  assert(pp_vec != NULL);
+  assert(*pp_vec != NULL);
+
+  if (capacity > vec_get_header(*pp_vec)->capacity) {
+    vec_reallocate(pp_vec, el_size, capacity);
+  }
+}
+
+void vec_ensure(void **pp_vec, size_t el_size, size_t count) {
+  assert(pp_vec != NULL);
+  assert(*pp_vec != NULL);
+
+  size_t capacity = vec_get_header(*pp_vec)->capacity;
+  if (count <= capacity) return;
+
+  capacity *= VEC_GROW_FACTOR;
+  vec_reallocate(pp_vec, el_size, capacity < count ? count : capacity);
+}
+
+void vec_shrink(void **pp_vec, size_t el_size) {
+  assert(pp_vec != NULL);
+  assert(*pp_vec != NULL);
+
+  // capacity stays greater than 0, as vec_alloc requires
   VecHeader *p_header = vec_get_header(*pp_vec);
-  size_t old_cap = p_header->capacity;
-  p_header->capacity *= VEC_GROW_FACTOR;
-  void *tmp = 
-    a_reallocate(p_header, 
-                 sizeof(VecHeader) + old_cap * el_size, 
-                 sizeof(VecHeader) + p_header->capacity * el_size);
-  if (NULL == tmp) logf_fatal("VEC", 137, "realocation for vector with new capacity %lu failed!", p_header->capacity); 
-  *pp_vec = (void*)((char*)tmp + sizeof(VecHeader));
+  size_t capacity = 0 == p_header->count ? 1 : p_header->count;
+  if (capacity < p_header->capacity) vec_reallocate(pp_vec, el_size, capacity);
 }
@@ -4,36 +4,72 @@
 #include <stdlib.h> // abort
 #include <string.h>
 #include <assert.h>
+#include <limits.h>
 
 #include "allocator.h"
 #include "logger.h"
 
 typedef struct {
   size_t count;
-  size_t capacity;
+  size_t capacity : sizeof(size_t) * CHAR_BIT - 1;
+
+  /// Set for vecs from vec_alloc_with with an allocator handle,
+  ///   the handle is then stored in a slot right before the header
+  size_t has_allocator : 1;
 } VecHeader;
 
+_Static_assert(2 * sizeof(size_t) == sizeof(VecHeader), "VecHeader has to stay two words");
+
+/// Size of the slot with the allocator handle, a whole header
+///   so that elements keep the alignment they have without it
+#define VEC_ALLOCATOR_SLOT_SIZE sizeof(VecHeader)
+
 #define VEC_GROW_FACTOR 2
 #define VEC_INITIAL_CAPACITY 8
 
 #define vec(T) T*
 
+/// Macros below take vecs as lvalues and evaluate them several times,
+///   other arguments are evaluated once, before the vec is changed.
+/// Their locals end with an underscore, so they do not shadow
+///   variables of the caller passed as arguments.
+
 #define vec_get_header(v) (((VecHeader*)(v)) - 1)
 
+/// Bytes allocated before the elements, the header and the allocator slot if any
+#define vec_get_prefix_size(v) \
+  (sizeof(VecHeader) + (vec_get_header((v))->has_allocator ? VEC_ALLOCATOR_SLOT_SIZE : 0))
+
+/// Start of the allocated block of the vec
+#define vec_get_block(v) ((void*)((char*)(v) - vec_get_prefix_size((v))))
+
+/// Allocator the vec lives in, NULL for the global allocator
+#define vec_get_allocator(v) \
+  (vec_get_header((v))->has_allocator ? *(const Allocator**)vec_get_block((v)) : NULL)
+
 #define vec_alloc(v) vec_alloc_reserved((v), VEC_INITIAL_CAPACITY)
 
-#define vec_alloc_reserved(v, cap) \
+#define vec_alloc_reserved(v, cap) vec_alloc_with((v), (cap), NULL)
+
+/// Allocates vec with capacity @cap in @allocator (const Allocator*),
+///   the allocator handle has to outlive the vec
+#define vec_alloc_with(v, cap, allocator) \
   do {\
-    size_t capacity = (cap);\
-    assert(capacity > 0 && "Capacity should be greater than 0.");\
-    (v) = a_allocate(sizeof(VecHeader) + capacity * sizeof(*(v))); \
-    VecHeader *header = (VecHeader*)(v);\
-    header->count = 0;\
-    header->capacity = capacity;\
-    (v) = (void*)((char*)v + sizeof(VecHeader));\
+    size_t capacity_ = (cap);\
+    const Allocator *p_allocator_ = (allocator);\
+    assert(capacity_ > 0 && "Capacity should be greater than 0.");\
+    size_t slot_size_ = NULL == p_allocator_ ? 0 : VEC_ALLOCATOR_SLOT_SIZE;\
+    char *p_block_ = allocator_allocate(p_allocator_, slot_size_ + sizeof(VecHeader) + capacity_ * sizeof(*(v)));\
+    if (NULL == p_block_) logf_fatal("VEC", 137, "allocation for vector with capacity %lu failed!", capacity_);\
+    if (NULL != p_allocator_) *(const Allocator**)p_block_ = p_allocator_;\
+    VecHeader *p_header_ = (VecHeader*)(p_block_ + slot_size_);\
+    p_header_->count = 0;\
+    p_header_->capacity = capacity_;\
+    p_header_->has_allocator = NULL != p_allocator_;\
+    (v) = (void*)(p_header_ + 1);\
   } while (0)
 
-#define vec_free(v) a_free(vec_get_header((v)))
+#define vec_free(v) allocator_free(vec_get_allocator((v)), vec_get_block((v)))
 
 
 #define vec_count(v) (vec_get_header((v))->count)
@@ -42,41 +78,104 @@ typedef struct {
 
 #define vec_maybe_expand(v) \
   do {\
-    if (vec_count(v) == vec_capacity(v)) {\
-      size_t old_cap = vec_capacity(v);\
-      vec_capacity(v) *= VEC_GROW_FACTOR;\
-      void *tmp = a_reallocate(vec_get_header(v), old_cap * sizeof(*(v)), sizeof(VecHeader) + vec_capacity(v) * sizeof(*(v)));\
-      if (NULL == tmp) log_fatal("VEC", "realocation for vector with new capacity %lu failed!", 137, vec_capacity(v)); \
-      v = (void*)((char*)tmp + sizeof(VecHeader));\
-    }\
+    if (vec_count(v) == vec_capacity(v)) vec_expand((void**)&(v), sizeof(*(v)));\
   } while(0)
 
 void vec_mb_expand(void **pp_vec, size_t el_size);
 
 void vec_expand(void **pp_vec, size_t el_size);
 
+/// Reallocates the vec to exactly @capacity elements if it has less
+void vec_grow_to(void **pp_vec, size_t el_size, size_t capacity);
+
+/// Makes room for @count elements, growing at least by VEC_GROW_FACTOR
+///   so that repeated calls reallocate amortized O(1) times
+void vec_ensure(void **pp_vec, size_t el_size, size_t count);
+
+/// Reallocates the vec to its count of elements (at least one)
+void vec_shrink(void **pp_vec, size_t el_size);
+
 #define vec_push(v, e) \
   do {\
-    vec_mb_expand((void**)&(v), sizeof(*(v)));\
+    if (vec_count((v)) == vec_capacity((v))) vec_expand((void**)&(v), sizeof(*(v)));\
     (v)[vec_count((v))++] = (e);\
   } while (0)
 
+/// Grows capacity of the vec to at least @n elements with a single reallocation
+#define vec_reserve(v, n) vec_grow_to((void**)&(v), sizeof(*(v)), (n))
+
+/// Sets count of the vec to @n, new elements are zeroed
+#define vec_resize(v, n) \
+  do {\
+    size_t new_count_ = (n);\
+    size_t old_count_ = vec_count((v));\
+    vec_ensure((void**)&(v), sizeof(*(v)), new_count_);\
+    if (new_count_ > old_count_) memset((v) + old_count_, 0, (new_count_ - old_count_) * sizeof(*(v)));\
+    vec_count((v)) = new_count_;\
+  } while (0)
+
+/// Appends @n elements copied from @ptr, which must not point into the vec
+#define vec_extend_from(v, ptr, n) \
+  do {\
+    const void *p_src_ = (ptr);\
+    size_t extend_count_ = (n);\
+    size_t old_count_ = vec_count((v));\
+    vec_ensure((void**)&(v), sizeof(*(v)), old_count_ + extend_count_);\
+    memcpy((v) + old_count_, p_src_, extend_count_ * sizeof(*(v)));\
+    vec_count((v)) = old_count_ + extend_count_;\
+  } while (0)
+
+/// Inserts @n elements copied from @ptr before the element at @index,
+///   @ptr must not point into the vec
+#define vec_insert_n(v, index, ptr, n) \
+  do {\
+    size_t insert_index_ = (index);\
+    const void *p_src_ = (ptr);\
+    size_t insert_count_ = (n);\
+    size_t old_count_ = vec_count((v));\
+    assert(insert_index_ <= old_count_);\
+    vec_ensure((void**)&(v), sizeof(*(v)), old_count_ + insert_count_);\
+    memmove((v) + insert_index_ + insert_count_, (v) + insert_index_,\
+            (old_count_ - insert_index_) * sizeof(*(v)));\
+    memcpy((v) + insert_index_, p_src_, insert_count_ * sizeof(*(v)));\
+    vec_count((v)) = old_count_ + insert_count_;\
+  } while (0)
+
+/// Removes @n elements starting at @index, the following elements move back
+#define vec_remove_range(v, index, n) \
+  do {\
+    size_t remove_index_ = (index);\
+    size_t remove_count_ = (n);\
+    size_t old_count_ = vec_count((v));\
+    assert(remove_index_ <= old_count_ && remove_count_ <= old_count_ - remove_index_);\
+    memmove((v) + remove_index_, (v) + remove_index_ + remove_count_,\
+            (old_count_ - remove_index_ - remove_count_) * sizeof(*(v)));\
+    vec_count((v)) = old_count_ - remove_count_;\
+  } while (0)
+
+/// Releases capacity of the vec beyond its count
+#define vec_shrink_to_fit(v) vec_shrink((void**)&(v), sizeof(*(v)))
+
 #define vec_pop(v) (--vec_count((v)))
 
-#define vec_back(v) (assert(0 != vec_count((v))), v + vec_count((v)) - 1)
+#define vec_back(v) (assert(0 != vec_count((v))), (v) + vec_count((v)) - 1)
 
 #define vec_at(v, i) ((v) + (i))
 
 #define vec_for_each(v, iter, body)\
   do {\
-    size_t count = vec_count(v);\
-    for (size_t iter = 0; iter < count; ++iter) body;\
+    size_t count_ = vec_count((v));\
+    for (size_t iter = 0; iter < count_; ++iter) body;\
   } while (0)
 
+/// Appends all elements of @v2 to @v1, @v2 may be @v1
 #define vec_append(v1, v2)\
   do {\
-    size_t count = vec_count((v2));\
-    for (size_t i = 0; i < count; ++i) vec_push((v1), (v2)[count]);\
+    size_t append_count_ = vec_count((v2));\
+    size_t old_count_ = vec_count((v1));\
+    vec_ensure((void**)&(v1), sizeof(*(v1)), old_count_ + append_count_);\
+    memcpy((v1) + old_count_, (v2), append_count_ * sizeof(*(v1)));\
+    vec_count((v1)) = old_count_ + append_count_;\
   } while (0)
 
 #endif // !__VEC_H__
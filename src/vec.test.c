@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 #include "vec.h"
@@ -15,10 +16,164 @@ void init_allocator() {
 
 LogSeverity g_log_severity = LOG_ALL;
 
+void test_bulk() {
+  enum { BUFFER_COUNT = 1000 };
+  static int buffer[BUFFER_COUNT];
+  for (int i = 0; i < BUFFER_COUNT; ++i) buffer[i] = i;
+
+  vec(int) v;
+  vec_alloc(v);
+
+  // one reallocation for the whole buffer
+  AllocatorStats before, after;
+  allocator_get_stats(&before);
+  vec_extend_from(v, buffer, BUFFER_COUNT);
+  allocator_get_stats(&after);
+  assert(before.reallocs_count + 1 == after.reallocs_count);
+  assert(BUFFER_COUNT == vec_count(v));
+  assert(0 == memcmp(v, buffer, sizeof(buffer)));
+
+  vec_extend_from(v, buffer, 0);
+  assert(BUFFER_COUNT == vec_count(v));
+
+  vec_remove_range(v, 10, 980);
+  assert(20 == vec_count(v));
+  for (int i = 0; i < 10; ++i) {
+    assert(i == v[i]);
+    assert(990 + i == v[10 + i]);
+  }
+
+  vec_insert_n(v, 10, buffer + 10, 5);
+  assert(25 == vec_count(v));
+  for (int i = 0; i < 15; ++i) assert(i == v[i]);
+  assert(990 == v[15]);
+
+  vec_insert_n(v, 0, buffer + 100, 2);
+  vec_insert_n(v, vec_count(v), buffer + 200, 1);
+  assert(28 == vec_count(v));
+  assert(100 == v[0] && 101 == v[1] && 0 == v[2]);
+  assert(200 == *vec_back(v));
+
+  vec_remove_range(v, 0, 2);
+  vec_remove_range(v, vec_count(v) - 1, 1);
+  vec_remove_range(v, 5, 0);
+  assert(25 == vec_count(v));
+  assert(0 == v[0]);
+
+  // shrinking keeps elements, resizing zeroes the new ones
+  vec_resize(v, 10);
+  assert(10 == vec_count(v));
+  vec_shrink_to_fit(v);
+  assert(10 == vec_capacity(v));
+  vec_resize(v, 40);
+  assert(40 == vec_count(v));
+  for (int i = 0; i < 10; ++i) assert(i == v[i]);
+  for (int i = 10; i < 40; ++i) assert(0 == v[i]);
+
+  vec_reserve(v, 1000);
+  assert(1000 == vec_capacity(v));
+  vec_reserve(v, 10);
+  assert(1000 == vec_capacity(v));
+
+  vec_resize(v, 0);
+  vec_shrink_to_fit(v);
+  assert(1 == vec_capacity(v));
+  vec_push(v, 7);
+  vec_push(v, 8);
+  assert(2 == vec_count(v));
+
+  // appending a vec to itself doubles it
+  vec_append(v, v);
+  assert(4 == vec_count(v));
+  assert(7 == v[2] && 8 == v[3]);
+
+  vec(int) other;
+  vec_alloc(other);
+  vec_append(other, v);
+  assert(4 == vec_count(other));
+  assert(0 == memcmp(other, v, 4 * sizeof(int)));
+
+  vec_free(other);
+  vec_free(v);
+}
+
+void test_allocator_handle() {
+  // only vecs with an allocator handle pay for storing it
+  vec(int) v;
+  vec_alloc(v);
+  assert(vec_get_block(v) == (void*)vec_get_header(v));
+  assert(NULL == vec_get_allocator(v));
+  vec_free(v);
+
+  Arena arena;
+  arena_init(&arena, 0);
+  Allocator allocator = allocator_from_arena(&arena);
+
+  vec_alloc_with(v, 1, &allocator);
+  assert(&allocator == vec_get_allocator(v));
+  assert(0 == ((size_t)v - (size_t)vec_get_block(v)) % sizeof(VecHeader));
+  for (int i = 0; i < 1000; ++i) vec_push(v, i);
+  int first[10] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+  vec_extend_from(v, first, 10);
+  vec_shrink_to_fit(v);
+  assert(1010 == vec_capacity(v));
+  assert(&allocator == vec_get_allocator(v));
+  assert(arena_owns(&arena, vec_get_block(v)));
+  for (int i = 0; i < 1000; ++i) assert(i == v[i]);
+  for (int i = 0; i < 10; ++i) assert(i == v[1000 + i]);
+  vec_free(v);
+
+  arena_finalize(&arena);
+}
+
+void test_macro_arguments() {
+  // arguments named like the locals the macros used to declare
+  size_t capacity = 4;
+  const Allocator *p_allocator = NULL;
+  vec(int) v;
+  vec_alloc_with(v, capacity, p_allocator);
+  assert(4 == vec_capacity(v));
+
+  size_t new_count = 3;
+  vec_resize(v, new_count);
+  assert(3 == vec_count(v));
+
+  int old_count[4] = { 1, 2, 3, 4 };
+  size_t extend_count = 4;
+  vec_extend_from(v, old_count, extend_count);
+  assert(7 == vec_count(v));
+  assert(4 == v[6]);
+
+  size_t insert_index = 1, insert_count = 2;
+  vec_insert_n(v, insert_index, old_count + insert_count, insert_count);
+  assert(9 == vec_count(v));
+  assert(3 == v[1] && 4 == v[2] && 0 == v[3]);
+
+  size_t remove_index = 0, remove_count = 3;
+  vec_remove_range(v, remove_index, remove_count);
+  assert(6 == vec_count(v));
+
+  size_t count = 0;
+  vec_for_each(v, i, count += v[i]);
+  assert(10 == count);
+
+  vec(int) append_count;
+  vec_alloc(append_count);
+  vec_push(append_count, 5);
+  vec_append(v, append_count);
+  assert(7 == vec_count(v) && 5 == *vec_back(v));
+
+  vec_free(append_count);
+  vec_free(v);
+}
+
 int main() {
   init_allocator();
   atexit(allocator_finalize);
 
+  test_allocator_handle();
+  test_macro_arguments();
+
   vec(int) v;
   vec_alloc(v);
 
@@ -51,7 +206,7 @@ int main() {
   vec_push(v, 90);
 
   #define print_vector_entry(index, val) printf("[%lu] %d\n", index, val)
-  vec_for_each(v, print_vector_entry);
+  vec_for_each(v, i, print_vector_entry(i, v[i]));
 
   assert(9 == vec_count(v));
   assert(90 == *vec_back(v));
@@ -86,6 +241,8 @@ int main() {
 
   vec_free(v);
 
+  test_bulk();
+
   return 0;
 }
 
@@ -0,0 +1,412 @@
+#ifndef __VEC_ALGO_H__
+#define __VEC_ALGO_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#include "allocator.h"
+#include "logger.h"
+#include "thread_pool.h"
+#include "vec.h"
+
+/// Generators of algorithms over arrays and vecs specialized for an element type.
+///
+/// VEC_ALGO_DEFINE(name, T, less_func) defines static inline functions
+///   name##_sort, name##_is_sorted, name##_lower_bound, name##_upper_bound,
+///   name##_unique, name##_parallel_sort and their name##_*_vec variants.
+///   less_func is called directly, so the compiler can inline it:
+///   bool less_func(T lhs, T rhs), a strict weak ordering of elements.
+///
+/// VEC_RADIX_SORT_DEFINE(name, T, key_func) defines name##_radix_sort and
+///   name##_radix_sort_vec, sorting elements by an unsigned integer key:
+///   uint64_t key_func(T e), see vec_algo_key_i64 for signed keys.
+///
+/// Example:
+///   VEC_ALGO_DEFINE(int_algo, int, vec_algo_less_int)
+///   vec(int) v;
+///   ...
+///   int_algo_sort_vec(v);
+///   size_t index = int_algo_lower_bound(v, vec_count(v), 42);
+
+/// Ranges up to this size are sorted by insertion sort
+#define VEC_ALGO_INSERTION_THRESHOLD 16
+
+/// Ranges over this size take the pivot as a median of three medians
+#define VEC_ALGO_NINTHER_THRESHOLD 128
+
+/// Arrays up to this size are sorted on the calling thread by parallel sort
+#define VEC_ALGO_PARALLEL_THRESHOLD (1u << 16)
+
+/// Merge tasks per thread in each round of parallel sort
+#define VEC_ALGO_MERGE_TASKS_PER_THREAD 2
+
+/// Arrays up to this size are sorted by insertion sort in radix sort
+#define VEC_ALGO_RADIX_THRESHOLD 64
+
+static inline bool vec_algo_less_int(int lhs, int rhs) { return lhs < rhs; }
+static inline bool vec_algo_less_i64(int64_t lhs, int64_t rhs) { return lhs < rhs; }
+static inline bool vec_algo_less_u64(uint64_t lhs, uint64_t rhs) { return lhs < rhs; }
+static inline bool vec_algo_less_double(double lhs, double rhs) { return lhs < rhs; }
+
+/// Radix keys preserving the order of signed integers
+static inline uint64_t vec_algo_key_i64(int64_t key) { return (uint64_t)key ^ ((uint64_t)1 << 63); }
+static inline uint64_t vec_algo_key_int(int key) { return (uint32_t)key ^ ((uint32_t)1 << 31); }
+static inline uint64_t vec_algo_key_u64(uint64_t key) { return key; }
+
+/// Floor of log2 of @n > 0
+static inline size_t vec_algo_log2(size_t n) {
+  return sizeof(unsigned long long) * 8 - 1 - __builtin_clzll(n);
+}
+
+#define VEC_ALGO_DEFINE(name, T, less_func) \
+  static inline void name##_swap(T *lhs, T *rhs) { \
+    T tmp = *lhs; \
+    *lhs = *rhs; \
+    *rhs = tmp; \
+  } \
+  \
+  static inline void name##_insertion_sort(T *items, size_t count) { \
+    for (size_t i = 1; i < count; ++i) { \
+      T item = items[i]; \
+      size_t j = i; \
+      for (; j > 0 && less_func(item, items[j - 1]); --j) items[j] = items[j - 1]; \
+      items[j] = item; \
+    } \
+  } \
+  \
+  static inline void name##_sift_down(T *items, size_t count, size_t index) { \
+    T item = items[index]; \
+    for (;;) { \
+      size_t child = index * 2 + 1; \
+      if (child >= count) break; \
+      if (child + 1 < count && less_func(items[child], items[child + 1])) ++child; \
+      if (!less_func(item, items[child])) break; \
+      items[index] = items[child]; \
+      index = child; \
+    } \
+    items[index] = item; \
+  } \
+  \
+  static inline void name##_heap_sort(T *items, size_t count) { \
+    for (size_t i = count / 2; i > 0; --i) name##_sift_down(items, count, i - 1); \
+    for (size_t i = count; i > 1; --i) { \
+      name##_swap(items, items + i - 1); \
+      name##_sift_down(items, i - 1, 0); \
+    } \
+  } \
+  \
+  /* Moves the median of items[a], items[b], items[c] to items[b] */ \
+  static inline void name##_median3(T *items, size_t a, size_t b, size_t c) { \
+    if (less_func(items[b], items[a])) name##_swap(items + a, items + b); \
+    if (less_func(items[c], items[b])) { \
+      name##_swap(items + b, items + c); \
+      if (less_func(items[b], items[a])) name##_swap(items + a, items + b); \
+    } \
+  } \
+  \
+  /* Partitions items around a pivot, elements equal to the pivot may end up */ \
+  /* on both sides, so runs of equal elements are split evenly */ \
+  /* @return size_t, index of the first element of the right part */ \
+  static inline size_t name##_partition(T *items, size_t count) { \
+    size_t mid = count / 2; \
+    if (count > VEC_ALGO_NINTHER_THRESHOLD) { \
+      size_t step = count / 8; \
+      name##_median3(items, 0, step, step * 2); \
+      name##_median3(items, mid - step, mid, mid + step); \
+      name##_median3(items, count - 1 - step * 2, count - 1 - step, count - 1); \
+      name##_median3(items, step, mid, count - 1 - step); \
+    } else { \
+      name##_median3(items, 0, mid, count - 1); \
+    } \
+    name##_swap(items, items + mid); \
+    T pivot = items[0]; \
+    \
+    size_t i = 0, j = count; \
+    for (;;) { \
+      do ++i; while (less_func(items[i], pivot)); \
+      do --j; while (less_func(pivot, items[j])); \
+      if (i >= j) break; \
+      name##_swap(items + i, items + j); \
+    } \
+    name##_swap(items, items + j); \
+    return j + 1; \
+  } \
+  \
+  static inline void name##_introsort(T *items, size_t count, size_t depth_limit) { \
+    while (count > VEC_ALGO_INSERTION_THRESHOLD) { \
+      if (0 == depth_limit--) { \
+        name##_heap_sort(items, count); \
+        return; \
+      } \
+      size_t split = name##_partition(items, count); \
+      /* recursing into the smaller part bounds the stack by log2(count) */ \
+      if (split < count - split) { \
+        name##_introsort(items, split - 1, depth_limit); \
+        items += split; \
+        count -= split; \
+      } else { \
+        name##_introsort(items + split, count - split, depth_limit); \
+        count = split - 1; \
+      } \
+    } \
+    name##_insertion_sort(items, count); \
+  } \
+  \
+  /* Sorts @count items in place, not stable, O(count * log(count)) worst case */ \
+  static inline void name##_sort(T *items, size_t count) { \
+    if (count < 2) return; \
+    name##_introsort(items, count, 2 * vec_algo_log2(count)); \
+  } \
+  \
+  static inline bool name##_is_sorted(const T *items, size_t count) { \
+    for (size_t i = 1; i < count; ++i) { \
+      if (less_func(items[i], items[i - 1])) return false; \
+    } \
+    return true; \
+  } \
+  \
+  /* @return size_t, index of the first item not less than @key in sorted items */ \
+  static inline size_t name##_lower_bound(const T *items, size_t count, T key) { \
+    size_t begin = 0; \
+    while (count > 0) { \
+      size_t half = count / 2; \
+      if (less_func(items[begin + half], key)) { \
+        begin += half + 1; \
+        count -= half + 1; \
+      } else { \
+        count = half; \
+      } \
+    } \
+    return begin; \
+  } \
+  \
+  /* @return size_t, index of the first item greater than @key in sorted items */ \
+  static inline size_t name##_upper_bound(const T *items, size_t count, T key) { \
+    size_t begin = 0; \
+    while (count > 0) { \
+      size_t half = count / 2; \
+      if (!less_func(key, items[begin + half])) { \
+        begin += half + 1; \
+        count -= half + 1; \
+      } else { \
+        count = half; \
+      } \
+    } \
+    return begin; \
+  } \
+  \
+  /* Keeps the first of each run of equal adjacent items, the rest are moved */ \
+  /* to the front in order */ \
+  /* @return size_t, number of items left */ \
+  static inline size_t name##_unique(T *items, size_t count) { \
+    if (0 == count) return 0; \
+    size_t last = 0; \
+    for (size_t i = 1; i < count; ++i) { \
+      /* items are sorted or equal ones are adjacent, so !less means equal */ \
+      if (less_func(items[last], items[i]) || less_func(items[i], items[last])) { \
+        items[++last] = items[i]; \
+      } \
+    } \
+    return last + 1; \
+  } \
+  \
+  /* Number of items of @a that precede the first @k items of merged @a and @b, */ \
+  /* equal items of @a precede those of @b */ \
+  static inline size_t name##_merge_split(size_t k, const T *a, size_t a_count, \
+                                          const T *b, size_t b_count) { \
+    size_t lo = k > b_count ? k - b_count : 0; \
+    size_t hi = k < a_count ? k : a_count; \
+    while (lo < hi) { \
+      size_t mid = lo + (hi - lo) / 2; \
+      size_t j = k - mid; \
+      if (0 == j || less_func(b[j - 1], a[mid])) hi = mid; \
+      else lo = mid + 1; \
+    } \
+    return lo; \
+  } \
+  \
+  typedef struct { \
+    const T *a; \
+    size_t a_count; \
+    const T *b; \
+    size_t b_count; \
+    /* merged items [begin, end) are written to out + begin */ \
+    T *out; \
+    size_t begin; \
+    size_t end; \
+  } name##_merge_task; \
+  \
+  static inline void name##_merge_task_run(void *arg) { \
+    name##_merge_task *p_task = arg; \
+    const T *a = p_task->a, *b = p_task->b; \
+    size_t i = name##_merge_split(p_task->begin, a, p_task->a_count, b, p_task->b_count); \
+    size_t i_end = name##_merge_split(p_task->end, a, p_task->a_count, b, p_task->b_count); \
+    size_t j = p_task->begin - i; \
+    size_t j_end = p_task->end - i_end; \
+    T *out = p_task->out + p_task->begin; \
+    while (i < i_end && j < j_end) { \
+      if (less_func(b[j], a[i])) *out++ = b[j++]; \
+      else *out++ = a[i++]; \
+    } \
+    memcpy(out, a + i, (i_end - i) * sizeof(T)); \
+    out += i_end - i; \
+    memcpy(out, b + j, (j_end - j) * sizeof(T)); \
+  } \
+  \
+  typedef struct { \
+    T *items; \
+    size_t begin; \
+    size_t end; \
+  } name##_sort_task; \
+  \
+  static inline void name##_sort_task_run(void *arg) { \
+    name##_sort_task *p_task = arg; \
+    name##_sort(p_task->items + p_task->begin, p_task->end - p_task->begin); \
+  } \
+  \
+  /* Sorts @count items on threads of @pool: runs of items are sorted in */ \
+  /* parallel, then merged pairwise, each merge split over several tasks. */ \
+  /* Merging needs a buffer of @count items allocated in @p_allocator */ \
+  /* (NULL for the global allocator), use ALLOCATOR_THREAD_SAFE if tasks */ \
+  /* of the pool allocate themselves. */ \
+  static inline void name##_parallel_sort(ThreadPool *pool, T *items, size_t count, \
+                                          const Allocator *p_allocator) { \
+    assert(NULL != pool); \
+    size_t threads_count = thread_pool_threads_count(pool); \
+    if (count <= VEC_ALGO_PARALLEL_THRESHOLD || 1 == threads_count) { \
+      name##_sort(items, count); \
+      return; \
+    } \
+    \
+    /* a power of two of runs, so every round halves them */ \
+    size_t runs_count = (size_t)1 << vec_algo_log2(threads_count * 2 - 1); \
+    size_t merge_tasks_count = threads_count * VEC_ALGO_MERGE_TASKS_PER_THREAD; \
+    size_t tasks_count = runs_count > merge_tasks_count ? runs_count : merge_tasks_count; \
+    \
+    T *buffer = allocator_allocate(p_allocator, count * sizeof(T)); \
+    name##_merge_task *merge_tasks = \
+      allocator_allocate(p_allocator, tasks_count * sizeof(name##_merge_task)); \
+    name##_sort_task *sort_tasks = \
+      allocator_allocate(p_allocator, runs_count * sizeof(name##_sort_task)); \
+    if (NULL == buffer || NULL == merge_tasks || NULL == sort_tasks) { \
+      logf_fatal("VEC_ALGO", 137, "allocation for parallel sort of %lu items failed!", count); \
+    } \
+    \
+    for (size_t i = 0; i < runs_count; ++i) { \
+      sort_tasks[i] = (name##_sort_task){ items, count * i / runs_count, \
+                                          count * (i + 1) / runs_count }; \
+      thread_pool_submit(pool, name##_sort_task_run, sort_tasks + i); \
+    } \
+    thread_pool_wait(pool); \
+    \
+    T *src = items, *dst = buffer; \
+    for (size_t run_size = 1; run_size < runs_count; run_size *= 2) { \
+      size_t pairs_count = runs_count / (run_size * 2); \
+      size_t parts_count = merge_tasks_count / pairs_count; \
+      if (0 == parts_count) parts_count = 1; \
+      \
+      name##_merge_task *p_task = merge_tasks; \
+      for (size_t pair = 0; pair < pairs_count; ++pair) { \
+        size_t begin = count * (pair * run_size * 2) / runs_count; \
+        size_t mid = count * (pair * run_size * 2 + run_size) / runs_count; \
+        size_t end = count * (pair * run_size * 2 + run_size * 2) / runs_count; \
+        for (size_t part = 0; part < parts_count; ++part, ++p_task) { \
+          *p_task = (name##_merge_task){ \
+            .a = src + begin, .a_count = mid - begin, \
+            .b = src + mid, .b_count = end - mid, \
+            .out = dst + begin, \
+            .begin = (end - begin) * part / parts_count, \
+            .end = (end - begin) * (part + 1) / parts_count, \
+          }; \
+          thread_pool_submit(pool, name##_merge_task_run, p_task); \
+        } \
+      } \
+      thread_pool_wait(pool); \
+      \
+      T *tmp = src; \
+      src = dst; \
+      dst = tmp; \
+    } \
+    \
+    if (src != items) memcpy(items, src, count * sizeof(T)); \
+    \
+    allocator_free(p_allocator, sort_tasks); \
+    allocator_free(p_allocator, merge_tasks); \
+    allocator_free(p_allocator, buffer); \
+  } \
+  \
+  static inline void name##_sort_vec(T *v) { \
+    name##_sort(v, vec_count(v)); \
+  } \
+  \
+  /* Removes repeated adjacent items from the vec */ \
+  static inline void name##_unique_vec(T *v) { \
+    vec_count(v) = name##_unique(v, vec_count(v)); \
+  } \
+  \
+  /* Sorts the vec in parallel, the buffer is allocated in the vec's allocator */ \
+  static inline void name##_parallel_sort_vec(ThreadPool *pool, T *v) { \
+    name##_parallel_sort(pool, v, vec_count(v), vec_get_allocator(v)); \
+  }
+
+#define VEC_RADIX_SORT_DEFINE(name, T, key_func) \
+  /* Sorts @count items by key_func in place, stable, O(count * key bytes). */ \
+  /* Least significant byte goes first, bytes all items share are skipped. */ \
+  /* A buffer of @count items is allocated in @p_allocator (NULL for global). */ \
+  static inline void name##_radix_sort(T *items, size_t count, const Allocator *p_allocator) { \
+    if (count <= VEC_ALGO_RADIX_THRESHOLD) { \
+      for (size_t i = 1; i < count; ++i) { \
+        T item = items[i]; \
+        uint64_t key = key_func(item); \
+        size_t j = i; \
+        for (; j > 0 && key < key_func(items[j - 1]); --j) items[j] = items[j - 1]; \
+        items[j] = item; \
+      } \
+      return; \
+    } \
+    \
+    /* histograms of all bytes are counted in one pass */ \
+    size_t counts[8][256]; \
+    memset(counts, 0, sizeof(counts)); \
+    for (size_t i = 0; i < count; ++i) { \
+      uint64_t key = key_func(items[i]); \
+      for (size_t byte = 0; byte < 8; ++byte) ++counts[byte][(key >> (byte * 8)) & 0xff]; \
+    } \
+    \
+    T *buffer = allocator_allocate(p_allocator, count * sizeof(T)); \
+    if (NULL == buffer) { \
+      logf_fatal("VEC_ALGO", 137, "allocation for radix sort of %lu items failed!", count); \
+    } \
+    \
+    T *src = items, *dst = buffer; \
+    for (size_t byte = 0; byte < 8; ++byte) { \
+      size_t *byte_counts = counts[byte]; \
+      if (count == byte_counts[(key_func(items[0]) >> (byte * 8)) & 0xff]) continue; \
+      \
+      size_t offset = 0; \
+      for (size_t digit = 0; digit < 256; ++digit) { \
+        size_t digit_count = byte_counts[digit]; \
+        byte_counts[digit] = offset; \
+        offset += digit_count; \
+      } \
+      for (size_t i = 0; i < count; ++i) { \
+        dst[byte_counts[(key_func(src[i]) >> (byte * 8)) & 0xff]++] = src[i]; \
+      } \
+      \
+      T *tmp = src; \
+      src = dst; \
+      dst = tmp; \
+    } \
+    \
+    if (src != items) memcpy(items, src, count * sizeof(T)); \
+    allocator_free(p_allocator, buffer); \
+  } \
+  \
+  static inline void name##_radix_sort_vec(T *v) { \
+    name##_radix_sort(v, vec_count(v), vec_get_allocator(v)); \
+  }
+
+#endif // !__VEC_ALGO_H__
@@ -0,0 +1,174 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "vec_algo.h"
+#include "allocator.h"
+#include "logger.h"
+
+void init_allocator() {
+  size_t allocator_size = 4lu * 1024lu * 1024lu; // 4 MiB
+  if (!allocator_init(allocator_size)) {
+    abort();
+  }
+}
+
+LogSeverity g_log_severity = LOG_ALL;
+
+typedef struct {
+  int key;
+  int order;
+} Pair;
+
+static inline bool pair_less(Pair lhs, Pair rhs) { return lhs.key < rhs.key; }
+static inline uint64_t pair_key(Pair pair) { return vec_algo_key_int(pair.key); }
+
+VEC_ALGO_DEFINE(int_algo, int, vec_algo_less_int)
+VEC_ALGO_DEFINE(pair_algo, Pair, pair_less)
+VEC_RADIX_SORT_DEFINE(i64_radix, int64_t, vec_algo_key_i64)
+VEC_RADIX_SORT_DEFINE(pair_radix, Pair, pair_key)
+
+static uint64_t g_random_state = 88172645463325252ull;
+
+static uint64_t random_next() {
+  g_random_state ^= g_random_state << 13;
+  g_random_state ^= g_random_state >> 7;
+  g_random_state ^= g_random_state << 17;
+  return g_random_state;
+}
+
+/// Fills @items by one of the patterns sorting algorithms have trouble with
+static void fill(int *items, size_t count, int pattern) {
+  for (size_t i = 0; i < count; ++i) {
+    switch (pattern) {
+    case 0: items[i] = (int)random_next(); break;
+    case 1: items[i] = (int)i; break;
+    case 2: items[i] = (int)(count - i); break;
+    case 3: items[i] = 7; break;
+    case 4: items[i] = (int)(random_next() % 4); break;
+    case 5: items[i] = (int)(i % 2 ? i : count - i); break; // organ pipe
+    }
+  }
+}
+
+#define PATTERNS_COUNT 6
+
+static long long sum_of(const int *items, size_t count) {
+  long long sum = 0;
+  for (size_t i = 0; i < count; ++i) sum += items[i];
+  return sum;
+}
+
+void test_sort() {
+  size_t counts[] = { 0, 1, 2, 3, 16, 17, 100, 129, 1000, 50000 };
+  for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+    size_t count = counts[c];
+    vec(int) v;
+    vec_alloc(v);
+    vec_resize(v, count);
+    for (int pattern = 0; pattern < PATTERNS_COUNT; ++pattern) {
+      fill(v, count, pattern);
+      long long sum = sum_of(v, count);
+      int_algo_sort_vec(v);
+      assert(int_algo_is_sorted(v, count));
+      assert(sum == sum_of(v, count));
+    }
+    vec_free(v);
+  }
+}
+
+void test_search() {
+  int items[] = { 1, 3, 3, 3, 5, 8, 8, 13 };
+  size_t count = sizeof(items) / sizeof(items[0]);
+
+  assert(0 == int_algo_lower_bound(items, count, 0));
+  assert(0 == int_algo_lower_bound(items, count, 1));
+  assert(1 == int_algo_upper_bound(items, count, 1));
+  assert(1 == int_algo_lower_bound(items, count, 3));
+  assert(4 == int_algo_upper_bound(items, count, 3));
+  assert(4 == int_algo_lower_bound(items, count, 4));
+  assert(4 == int_algo_upper_bound(items, count, 4));
+  assert(7 == int_algo_upper_bound(items, count, 8));
+  assert(count == int_algo_lower_bound(items, count, 14));
+  assert(0 == int_algo_lower_bound(items, 0, 3));
+
+  vec(int) v;
+  vec_alloc(v);
+  vec_extend_from(v, items, count);
+  int_algo_unique_vec(v);
+  int expected[] = { 1, 3, 5, 8, 13 };
+  assert(5 == vec_count(v));
+  assert(0 == memcmp(v, expected, sizeof(expected)));
+  int_algo_unique_vec(v);
+  assert(5 == vec_count(v));
+  vec_resize(v, 0);
+  int_algo_unique_vec(v);
+  assert(0 == vec_count(v));
+  vec_free(v);
+}
+
+void test_radix_sort() {
+  size_t counts[] = { 0, 1, 64, 65, 10000 };
+  for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+    size_t count = counts[c];
+
+    vec(int64_t) v;
+    vec_alloc(v);
+    vec_resize(v, count);
+    for (size_t i = 0; i < count; ++i) v[i] = (int64_t)random_next() >> (i % 40);
+    i64_radix_radix_sort_vec(v);
+    for (size_t i = 1; i < count; ++i) assert(v[i - 1] <= v[i]);
+    vec_free(v);
+
+    // radix sort is stable
+    vec(Pair) pairs;
+    vec_alloc(pairs);
+    for (size_t i = 0; i < count; ++i) {
+      vec_push(pairs, ((Pair){ (int)(random_next() % 100) - 50, (int)i }));
+    }
+    pair_radix_radix_sort_vec(pairs);
+    for (size_t i = 1; i < count; ++i) {
+      assert(pairs[i - 1].key <= pairs[i].key);
+      if (pairs[i - 1].key == pairs[i].key) assert(pairs[i - 1].order < pairs[i].order);
+    }
+    vec_free(pairs);
+  }
+}
+
+void test_parallel_sort() {
+  size_t workers[] = { 0, 1, 2, 4 };
+  for (size_t w = 0; w < sizeof(workers) / sizeof(workers[0]); ++w) {
+    ThreadPool pool;
+    assert(thread_pool_init(&pool, workers[w]));
+
+    size_t counts[] = { 1000, VEC_ALGO_PARALLEL_THRESHOLD + 1, 200003 };
+    for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+      size_t count = counts[c];
+      vec(int) v;
+      vec_alloc(v);
+      vec_resize(v, count);
+      for (int pattern = 0; pattern < PATTERNS_COUNT; ++pattern) {
+        fill(v, count, pattern);
+        long long sum = sum_of(v, count);
+        int_algo_parallel_sort_vec(&pool, v);
+        assert(int_algo_is_sorted(v, count));
+        assert(sum == sum_of(v, count));
+      }
+      vec_free(v);
+    }
+
+    thread_pool_free(&pool);
+  }
+}
+
+int main() {
+  init_allocator();
+  atexit(allocator_finalize);
+
+  test_sort();
+  test_search();
+  test_radix_sort();
+  test_parallel_sort();
+
+  return 0;
+}
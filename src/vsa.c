@@ -2,6 +2,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <stdbool.h>
 
 #include <stdio.h>
 #include <sys/types.h>
@@ -12,21 +13,80 @@ typedef struct {
   size_t size;
 } VsaHeader;
 
+/// Links of a free block, stored in the block itself
+typedef struct {
+  VsaHeader *p_next;
+  VsaHeader *p_prev;
+} VsaFreeLinks;
+
+/// Header of a region of memory managed by the Vsa,
+///   blocks of the region follow it
+typedef struct VsaRegion {
+  struct VsaRegion *p_next;
+
+  /// Memory and size the region was added with
+  void *mem;
+  size_t mem_size;
+
+  /// Region was requested by map_func and is returned by unmap_func
+  ///   once all of its memory is free
+  bool is_mapped;
+} VsaRegion;
+
 #define WORD_SIZE (sizeof(size_t))
 #define WORD_BIT_SIZE (WORD_SIZE * CHAR_BIT)
 
-#define BLOCK_IS_FREE(header) (!((header)->size >> (WORD_BIT_SIZE - 1)))
+_Static_assert(0 == sizeof(VsaRegion) % sizeof(size_t), "VsaRegion should be word sized");
+
+/// Bytes of a region that are not available for blocks:
+///   region header, first block header, sentinel and alignment slack
+#define REGION_OVERHEAD (sizeof(VsaRegion) + sizeof(VsaHeader) * 2 + WORD_SIZE)
+
+/// Every block has to be able to hold free list links and a footer once it is freed
+#define BLOCK_MIN_SIZE VSA_BLOCK_MIN_SIZE
+_Static_assert(VSA_BLOCK_MIN_SIZE >= sizeof(VsaFreeLinks) + WORD_SIZE, 
+               "VSA_BLOCK_MIN_SIZE cannot hold free block links and footer");
+
+/// Flags of a taken block change when its neighbour is freed or allocated,
+///   that word is accessed atomically so the owner of the block may call
+///   vsa_usable_size while another thread works on the Vsa
+#if defined(__GNUC__)
+#define HEADER_LOAD(header) __atomic_load_n(&(header)->size, __ATOMIC_RELAXED)
+#define HEADER_STORE(header, value) __atomic_store_n(&(header)->size, (value), __ATOMIC_RELAXED)
+#else
+#define HEADER_LOAD(header) ((header)->size)
+#define HEADER_STORE(header, value) ((header)->size = (value))
+#endif
+
+#define HEADER_TAKEN_BIT (1LU << (WORD_BIT_SIZE - 1))
+#define HEADER_PREV_FREE_BIT (1LU << (WORD_BIT_SIZE - 2))
+/// Set on the first block of a region, the flag moves with merges and splits
+#define HEADER_FIRST_BIT (1LU << (WORD_BIT_SIZE - 3))
+#define HEADER_FLAGS (HEADER_TAKEN_BIT | HEADER_PREV_FREE_BIT | HEADER_FIRST_BIT)
+
+#define BLOCK_IS_FREE(header) (!((header)->size & HEADER_TAKEN_BIT))
+#define BLOCK_IS_PREV_FREE(header) (!!((header)->size & HEADER_PREV_FREE_BIT))
+#define BLOCK_IS_FIRST(header) (!!((header)->size & HEADER_FIRST_BIT))
+#define BLOCK_GET_REGION(header) (((VsaRegion*)(header)) - 1)
+#define REGION_GET_FIRST_HEADER(region) ((VsaHeader*)((region) + 1))
 #define BLOCK_GET_HEADER(block) (((VsaHeader*)(block)) - 1)
 
-#define HEADER_GET_SIZE(header) (((header)->size & ~(1LU << (WORD_BIT_SIZE - 1))))
-#define HEADER_SET_FREE(header) (((header)->size &= ~(1LU << (WORD_BIT_SIZE - 1))))
-#define HEADER_SET_TAKEN(header) (((header)->size |= (1LU << (WORD_BIT_SIZE - 1))))
+#define HEADER_GET_SIZE(header) (((header)->size & ~HEADER_FLAGS))
+#define HEADER_SET_FREE(header) (((header)->size &= ~HEADER_TAKEN_BIT))
+#define HEADER_SET_TAKEN(header) (((header)->size |= HEADER_TAKEN_BIT))
+#define HEADER_SET_PREV_FREE(header) HEADER_STORE((header), HEADER_LOAD((header)) | HEADER_PREV_FREE_BIT)
+#define HEADER_SET_PREV_TAKEN(header) HEADER_STORE((header), HEADER_LOAD((header)) & ~HEADER_PREV_FREE_BIT)
 #define HEADER_GET_BLOCK(header) ((void*)((header) + 1))
+#define HEADER_GET_LINKS(header) ((VsaFreeLinks*)HEADER_GET_BLOCK(header))
+
+/// Boundary tag: the size of a free block is repeated in its last word,
+///   so the block after it can find its header
+#define HEADER_GET_FOOTER(header) (((size_t*)header_get_next(header)) - 1)
 
 
 static size_t size_align(size_t size) {
-  if (0 == size) return WORD_SIZE;
-  
+  if (size < BLOCK_MIN_SIZE) return BLOCK_MIN_SIZE;
+
   int mod = size % WORD_SIZE;
   int diff = WORD_SIZE - mod;
   return 0 == mod ? size : size + diff;
@@ -42,73 +102,306 @@ static VsaHeader *header_get_next(const VsaHeader *p_header) {
   return (VsaHeader*)((char*)p_header + HEADER_GET_SIZE(p_header) + sizeof(VsaHeader));
 }
 
-static void header_try_defrag(VsaHeader *p_header) {
-  assert(NULL != p_header);
+/// Returns the block before @p_header, valid only if that block is free
+static VsaHeader *header_get_prev(const VsaHeader *p_header) {
+  assert(BLOCK_IS_PREV_FREE(p_header));
+  size_t prev_size = ((const size_t*)p_header)[-1];
+  return (VsaHeader*)((char*)p_header - prev_size - sizeof(VsaHeader));
+}
+
+/// Marks block as free and writes its boundary tag
+static void block_mark_free(VsaHeader *p_header) {
+  HEADER_SET_FREE(p_header);
+  *HEADER_GET_FOOTER(p_header) = HEADER_GET_SIZE(p_header);
+  HEADER_SET_PREV_FREE(header_get_next(p_header));
+}
+
+static void block_mark_taken(VsaHeader *p_header) {
+  HEADER_SET_TAKEN(p_header);
+  HEADER_SET_PREV_TAKEN(header_get_next(p_header));
+}
+
+
+/// Index of the most significant set bit
+static int bit_fls(size_t word) {
+  assert(0 != word);
+#if defined(__GNUC__)
+  return (int)WORD_BIT_SIZE - 1 - __builtin_clzl(word);
+#else
+  int bit = 0;
+  while (word >>= 1) ++bit;
+  return bit;
+#endif
+}
+
+/// Index of the least significant set bit
+static int bit_ffs(size_t word) {
+  assert(0 != word);
+#if defined(__GNUC__)
+  return __builtin_ctzl(word);
+#else
+  int bit = 0;
+  while (!(word & 1)) { word >>= 1; ++bit; }
+  return bit;
+#endif
+}
+
+/// Computes free list indices of the class @size belongs to
+static void mapping_insert(size_t size, int *p_fl, int *p_sl) {
+  if (size < VSA_SMALL_BLOCK_SIZE) {
+    *p_fl = 0;
+    *p_sl = (int)(size / (VSA_SMALL_BLOCK_SIZE / VSA_SL_INDEX_COUNT));
+  } else {
+    int fl = bit_fls(size);
+    *p_sl = (int)(size >> (fl - VSA_SL_INDEX_COUNT_LOG2)) ^ VSA_SL_INDEX_COUNT;
+    *p_fl = fl - (VSA_FL_INDEX_SHIFT - 1);
+  }
+}
+
+/// Computes free list indices of the smallest class
+///   where every block is at least @size bytes
+static void mapping_search(size_t size, int *p_fl, int *p_sl) {
+  if (size >= VSA_SMALL_BLOCK_SIZE) {
+    size += ((size_t)1 << (bit_fls(size) - VSA_SL_INDEX_COUNT_LOG2)) - 1;
+  }
+  mapping_insert(size, p_fl, p_sl);
+}
+
+static void free_list_insert(Vsa *p_vsa, VsaHeader *p_header) {
+  int fl, sl;
+  mapping_insert(HEADER_GET_SIZE(p_header), &fl, &sl);
+
+  VsaHeader *p_head = p_vsa->free_lists[fl][sl];
+  VsaFreeLinks *p_links = HEADER_GET_LINKS(p_header);
+  p_links->p_prev = NULL;
+  p_links->p_next = p_head;
+  if (NULL != p_head) HEADER_GET_LINKS(p_head)->p_prev = p_header;
 
-  if (!BLOCK_IS_FREE(p_header) || 0 == p_header->size) return;
+  p_vsa->free_lists[fl][sl] = p_header;
+  p_vsa->fl_bitmap |= (size_t)1 << fl;
+  p_vsa->sl_bitmap[fl] |= 1u << sl;
+
+  p_vsa->free_bytes += HEADER_GET_SIZE(p_header);
+  ++p_vsa->free_blocks_count;
+}
+
+static void free_list_remove(Vsa *p_vsa, VsaHeader *p_header) {
+  int fl, sl;
+  mapping_insert(HEADER_GET_SIZE(p_header), &fl, &sl);
+
+  VsaFreeLinks *p_links = HEADER_GET_LINKS(p_header);
+  if (NULL != p_links->p_next) HEADER_GET_LINKS(p_links->p_next)->p_prev = p_links->p_prev;
+
+  if (NULL != p_links->p_prev) {
+    HEADER_GET_LINKS(p_links->p_prev)->p_next = p_links->p_next;
+  } else {
+    p_vsa->free_lists[fl][sl] = p_links->p_next;
+    if (NULL == p_links->p_next) {
+      p_vsa->sl_bitmap[fl] &= ~(1u << sl);
+      if (0 == p_vsa->sl_bitmap[fl]) p_vsa->fl_bitmap &= ~((size_t)1 << fl);
+    }
+  }
+
+  p_vsa->free_bytes -= HEADER_GET_SIZE(p_header);
+  --p_vsa->free_blocks_count;
+}
 
+/// Finds and unlinks a free block of at least @bytes,
+/// @return VsaHeader*, NULL if there is no such block
+static VsaHeader *free_list_take(Vsa *p_vsa, size_t bytes) {
+  if (bytes >= VSA_BLOCK_SIZE_MAX) return NULL;
+
+  int fl, sl;
+  mapping_search(bytes, &fl, &sl);
+  if (fl >= VSA_FL_INDEX_COUNT) return NULL;
+
+  uint32_t sl_map = p_vsa->sl_bitmap[fl] & (~0u << sl);
+  if (0 == sl_map) {
+    size_t fl_map = p_vsa->fl_bitmap & (~(size_t)0 << (fl + 1));
+    if (0 == fl_map) return NULL;
+
+    fl = bit_ffs(fl_map);
+    sl_map = p_vsa->sl_bitmap[fl];
+  }
+  sl = bit_ffs(sl_map);
+
+  VsaHeader *p_header = p_vsa->free_lists[fl][sl];
+  assert(NULL != p_header);
+  assert(HEADER_GET_SIZE(p_header) >= bytes);
+  free_list_remove(p_vsa, p_header);
+  return p_header;
+}
+
+/// Merges a free block with both of its neighbours if they are free as well,
+///   the merged block is not in any free list
+/// @return VsaHeader*, header of the merged block
+static VsaHeader *block_merge(Vsa *p_vsa, VsaHeader *p_header) {
   VsaHeader *p_next = header_get_next(p_header);
-  while (BLOCK_IS_FREE(p_next) && p_next->size) {
-    p_header->size += p_next->size + sizeof(VsaHeader);
-    p_next = header_get_next(p_next);
+  if (BLOCK_IS_FREE(p_next)) {
+    free_list_remove(p_vsa, p_next);
+    p_header->size += HEADER_GET_SIZE(p_next) + sizeof(VsaHeader);
+  }
+
+  if (BLOCK_IS_PREV_FREE(p_header)) {
+    VsaHeader *p_prev = header_get_prev(p_header);
+    assert(BLOCK_IS_FREE(p_prev));
+    free_list_remove(p_vsa, p_prev);
+    p_prev->size += HEADER_GET_SIZE(p_header) + sizeof(VsaHeader);
+    p_header = p_prev;
   }
+
+  return p_header;
 }
 
+/// Cuts the tail of the block beyond @bytes off into a new free block,
+///   if the tail is big enough to hold one,
+///   the tail is merged with the next block if that one is free
+static void block_trim(Vsa *p_vsa, VsaHeader *p_header, size_t bytes) {
+  size_t size = HEADER_GET_SIZE(p_header);
+  if (size < bytes + sizeof(VsaHeader) + BLOCK_MIN_SIZE) return;
+
+  p_header->size = (p_header->size - size) | bytes;
+
+  VsaHeader *p_rest = header_get_next(p_header);
+  p_rest->size = size - bytes - sizeof(VsaHeader);
+  p_rest = block_merge(p_vsa, p_rest);
+  block_mark_free(p_rest);
+  free_list_insert(p_vsa, p_rest);
+}
 
-Vsa *vsa_init(void *mem, size_t mem_size) {
+
+/// Formats @mem as a region of one free block and links it to the Vsa
+static void region_add(Vsa *p_vsa, void *mem, size_t mem_size, bool is_mapped) {
   assert(NULL != mem);
-  assert(mem_size > sizeof(VsaHeader) * 2);
+  assert(mem_size >= REGION_OVERHEAD + BLOCK_MIN_SIZE);
 
   void *aligned_mem = memory_align(mem);
+  size_t aligned_size = mem_size - ((char*)aligned_mem - (char*)mem);
+  aligned_size -= aligned_size % WORD_SIZE;
+
+  VsaRegion *p_region = aligned_mem;
+  p_region->mem = mem;
+  p_region->mem_size = mem_size;
+  p_region->is_mapped = is_mapped;
+  p_region->p_next = p_vsa->regions;
+  p_vsa->regions = p_region;
+
+  VsaHeader *p_header = REGION_GET_FIRST_HEADER(p_region);
+  p_header->size = aligned_size - sizeof(VsaRegion) - sizeof(VsaHeader) * 2;
+  assert(p_header->size < VSA_BLOCK_SIZE_MAX);
+
+  // taken sentinel of zero size terminates the region
+  VsaHeader *p_sentinel = header_get_next(p_header);
+  p_sentinel->size = 0;
+  HEADER_SET_TAKEN(p_sentinel);
+
+  p_header->size |= HEADER_FIRST_BIT;
+  block_mark_free(p_header);
+  free_list_insert(p_vsa, p_header);
+}
 
-  // align size 
-  {
-    mem_size -= ((char*)aligned_mem - (char*)mem);
+static void region_remove(Vsa *p_vsa, VsaRegion *p_region) {
+  VsaRegion **pp_region = (VsaRegion**)&p_vsa->regions;
+  while (*pp_region != p_region) pp_region = &(*pp_region)->p_next;
+  *pp_region = p_region->p_next;
 
-    int mod = mem_size % WORD_SIZE;
-    int diff = WORD_SIZE - mod;
-    mem_size = 0 == mod ? mem_size : mem_size - diff;
-  }
+  free_list_remove(p_vsa, REGION_GET_FIRST_HEADER(p_region));
+}
 
-  mem = aligned_mem;
+static bool region_is_idle(const VsaRegion *p_region) {
+  const VsaHeader *p_header = REGION_GET_FIRST_HEADER(p_region);
+  return BLOCK_IS_FREE(p_header) && 0 == HEADER_GET_SIZE(header_get_next(p_header));
+}
 
-  VsaHeader *p_header = (VsaHeader*)mem;
-  p_header->size = mem_size - sizeof(VsaHeader) * 2;
+/// Maps a new region that can hold a free block of @bytes
+/// @return bool, false if there are no region functions or mapping failed
+static bool vsa_grow(Vsa *p_vsa, size_t bytes) {
+  if (NULL == p_vsa->map_func) return false;
+
+  // rounding up by the second level class granularity
+  // lets the mapping search find the new block
+  size_t min_size = bytes + (bytes >> VSA_SL_INDEX_COUNT_LOG2) + REGION_OVERHEAD;
+  size_t mem_size = 0;
+  void *mem = p_vsa->map_func(p_vsa->region_ctx, min_size, &mem_size);
+  if (NULL == mem) return false;
+
+  assert(mem_size >= min_size);
+  region_add(p_vsa, mem, mem_size, true);
+  return true;
+}
 
-  p_header = header_get_next(p_header);
-  p_header->size = 0;
+/// Called when a free block spans a whole region.
+/// One idle mapped region is kept to avoid mapping and unmapping
+///   on every allocation that does not fit in the rest of the Vsa,
+///   others are unmapped.
+static void region_release_idle(Vsa *p_vsa, VsaRegion *p_region) {
+  if (!p_region->is_mapped) return;
+
+  VsaRegion *p_spare = p_vsa->p_spare_region;
+  if (NULL == p_spare || p_spare == p_region || !region_is_idle(p_spare)) {
+    p_vsa->p_spare_region = p_region;
+    return;
+  }
 
-  return mem;
+  region_remove(p_vsa, p_region);
+  p_vsa->unmap_func(p_vsa->region_ctx, p_region->mem, p_region->mem_size);
 }
 
 
-void *vsa_alloc(Vsa *p_vsa, size_t bytes) {
+void vsa_init(Vsa *p_vsa, void *mem, size_t mem_size) {
   assert(NULL != p_vsa);
+  assert(NULL != mem);
+  assert(mem_size >= REGION_OVERHEAD + BLOCK_MIN_SIZE);
 
-  bytes = size_align(bytes);
+  memset(p_vsa, 0, sizeof(*p_vsa));
+  region_add(p_vsa, mem, mem_size, false);
+}
 
-  VsaHeader *p_header = (VsaHeader*)p_vsa;
+void vsa_add_region(Vsa *p_vsa, void *mem, size_t mem_size) {
+  assert(NULL != p_vsa);
+  region_add(p_vsa, mem, mem_size, false);
+}
 
-  header_try_defrag(p_header);
-  while(HEADER_GET_SIZE(p_header) < bytes || !BLOCK_IS_FREE(p_header)) {
-    if (0 == HEADER_GET_SIZE(p_header)) {
-      return NULL;
-    }
+void vsa_set_region_funcs(Vsa *p_vsa, VsaMapFunc map_func, VsaUnmapFunc unmap_func,
+                          void *ctx) {
+  assert(NULL != p_vsa);
+  assert((NULL == map_func) == (NULL == unmap_func));
+  p_vsa->map_func = map_func;
+  p_vsa->unmap_func = unmap_func;
+  p_vsa->region_ctx = ctx;
+}
+
+void vsa_finalize(Vsa *p_vsa) {
+  assert(NULL != p_vsa);
 
-    p_header = header_get_next(p_header);
-    header_try_defrag(p_header);
+  VsaRegion *p_region = p_vsa->regions;
+  while (NULL != p_region) {
+    VsaRegion *p_next = p_region->p_next;
+    if (p_region->is_mapped) {
+      p_vsa->unmap_func(p_vsa->region_ctx, p_region->mem, p_region->mem_size);
+    }
+    p_region = p_next;
   }
 
-  ssize_t next_size = p_header->size - bytes - sizeof(VsaHeader);
-  if (next_size >= (ssize_t)WORD_SIZE) {
-    VsaHeader *p_next = NULL;
-    p_header->size = bytes;
-    p_next = header_get_next(p_header);
-    p_next->size = next_size;
+  memset(p_vsa, 0, sizeof(*p_vsa));
+}
+
 
+void *vsa_alloc(Vsa *p_vsa, size_t bytes) {
+  assert(NULL != p_vsa);
+
+  bytes = size_align(bytes);
+
+  VsaHeader *p_header = free_list_take(p_vsa, bytes);
+  if (NULL == p_header) {
+    if (!vsa_grow(p_vsa, bytes)) return NULL;
+    p_header = free_list_take(p_vsa, bytes);
+    assert(NULL != p_header);
   }
 
-  HEADER_SET_TAKEN(p_header);
+  block_trim(p_vsa, p_header, bytes);
+
+  block_mark_taken(p_header);
   return HEADER_GET_BLOCK(p_header);
 }
 
@@ -117,6 +410,8 @@ void *vsa_alloc(Vsa *p_vsa, size_t bytes) {
 void *vsa_calloc(Vsa *p_vsa, size_t nmemb, size_t memb_size) {
   assert(NULL != p_vsa);
 
+  if (0 != memb_size && nmemb > (size_t)-1 / memb_size) return NULL;
+
   size_t bytes = size_align(nmemb * memb_size);
   char *allocated = (char*)vsa_alloc(p_vsa, bytes);
 
@@ -127,39 +422,182 @@ void *vsa_calloc(Vsa *p_vsa, size_t nmemb, size_t memb_size) {
   return allocated;
 }
 
+void *vsa_alloc_aligned(Vsa *p_vsa, size_t bytes, size_t alignment) {
+  assert(NULL != p_vsa);
+  assert(0 != alignment && 0 == (alignment & (alignment - 1)) 
+         && "Alignment should be a power of two.");
+
+  if (alignment <= WORD_SIZE) return vsa_alloc(p_vsa, bytes);
+
+  bytes = size_align(bytes);
+
+  // a gap before the aligned address becomes a free block,
+  // so it is either empty or big enough to hold one
+  size_t gap_min = sizeof(VsaHeader) + BLOCK_MIN_SIZE;
+  if (bytes > VSA_BLOCK_SIZE_MAX - alignment - gap_min) return NULL;
+
+  VsaHeader *p_header = free_list_take(p_vsa, bytes + alignment + gap_min);
+  if (NULL == p_header) {
+    if (!vsa_grow(p_vsa, bytes + alignment + gap_min)) return NULL;
+    p_header = free_list_take(p_vsa, bytes + alignment + gap_min);
+    assert(NULL != p_header);
+  }
+
+  char *block = HEADER_GET_BLOCK(p_header);
+  char *aligned = (char*)(((size_t)block + alignment - 1) & ~(alignment - 1));
+  if (aligned != block && (size_t)(aligned - block) < gap_min) {
+    aligned = (char*)(((size_t)block + gap_min + alignment - 1) & ~(alignment - 1));
+  }
+
+  size_t gap = aligned - block;
+  if (0 != gap) {
+    VsaHeader *p_aligned = BLOCK_GET_HEADER(aligned);
+    p_aligned->size = HEADER_GET_SIZE(p_header) - gap;
+    p_header->size = (p_header->size - HEADER_GET_SIZE(p_header)) | (gap - sizeof(VsaHeader));
+    block_mark_free(p_header);
+    free_list_insert(p_vsa, p_header);
+    p_header = p_aligned;
+  }
+
+  block_trim(p_vsa, p_header, bytes);
+
+  block_mark_taken(p_header);
+  return HEADER_GET_BLOCK(p_header);
+}
+
+/// Shrinks the taken block or grows it into the next block if it is free
+/// @return bool, false if the block cannot be resized in place
+static bool block_resize(Vsa *p_vsa, VsaHeader *p_header, size_t bytes) {
+  size_t size = HEADER_GET_SIZE(p_header);
+
+  if (bytes <= size) {
+    block_trim(p_vsa, p_header, bytes);
+    return true;
+  }
+
+  VsaHeader *p_next = header_get_next(p_header);
+  if (BLOCK_IS_FREE(p_next) 
+      && size + sizeof(VsaHeader) + HEADER_GET_SIZE(p_next) >= bytes) {
+    free_list_remove(p_vsa, p_next);
+    p_header->size += HEADER_GET_SIZE(p_next) + sizeof(VsaHeader);
+    block_mark_taken(p_header);
+    block_trim(p_vsa, p_header, bytes);
+    return true;
+  }
+
+  return false;
+}
+
 void *vsa_realloc(Vsa *p_vsa, void *ptr, size_t bytes) {
+  return vsa_realloc_aligned(p_vsa, ptr, bytes, WORD_SIZE);
+}
+
+void *vsa_realloc_aligned(Vsa *p_vsa, void *ptr, size_t bytes, size_t alignment) {
   assert(NULL != p_vsa);
 
   if (0 == bytes) {
-    vsa_free(ptr);
-    return ptr;
+    vsa_free(p_vsa, ptr);
+    return NULL;
   }
 
-  size_t ptr_size = HEADER_GET_SIZE(BLOCK_GET_HEADER(ptr));
+  if (NULL == ptr) return vsa_alloc_aligned(p_vsa, bytes, alignment);
+
+  assert(0 == (size_t)ptr % alignment);
+  bytes = size_align(bytes);
 
-  // TODO: maybe free ptr here,
-  // because it is impossible to do another allocation
-  // and data will be preserved, but block will be marked as free,
-  // so new allocation may return the same defragmented block
-  // if there is enough memory
-  void *allocated = vsa_alloc(p_vsa, bytes);
+  VsaHeader *p_header = BLOCK_GET_HEADER(ptr);
+  assert(!BLOCK_IS_FREE(p_header));
+  size_t ptr_size = HEADER_GET_SIZE(p_header);
+
+  if (block_resize(p_vsa, p_header, bytes)) {
+    ++p_vsa->reallocs_in_place;
+    return ptr;
+  }
+
+  void *allocated = vsa_alloc_aligned(p_vsa, bytes, alignment);
   if (NULL == allocated) {
     return NULL;
   }
 
-  if (NULL != ptr) {
-    memcpy(allocated, ptr, ptr_size);
-    vsa_free(ptr);
-  }
+  memcpy(allocated, ptr, ptr_size);
+  vsa_free(p_vsa, ptr);
+  ++p_vsa->reallocs_moved;
 
   return allocated;
 }
 
 
-void vsa_free(void *ptr) {
+void vsa_free(Vsa *p_vsa, void *ptr) {
+  assert(NULL != p_vsa);
+
   if (NULL == ptr) return;
-  assert(!BLOCK_IS_FREE(BLOCK_GET_HEADER(ptr)));
-  HEADER_SET_FREE(BLOCK_GET_HEADER(ptr));
+
+  VsaHeader *p_header = BLOCK_GET_HEADER(ptr);
+  assert(!BLOCK_IS_FREE(p_header));
+  HEADER_SET_FREE(p_header);
+
+  p_header = block_merge(p_vsa, p_header);
+  block_mark_free(p_header);
+  free_list_insert(p_vsa, p_header);
+
+  if (BLOCK_IS_FIRST(p_header) && 0 == HEADER_GET_SIZE(header_get_next(p_header))) {
+    region_release_idle(p_vsa, BLOCK_GET_REGION(p_header));
+  }
+}
+
+
+void vsa_walk_free_blocks(const Vsa *p_vsa, VsaFreeBlockFunc func, void *ctx) {
+  assert(NULL != p_vsa);
+  assert(NULL != func);
+
+  for (int fl = 0; fl < VSA_FL_INDEX_COUNT; ++fl) {
+    if (0 == (p_vsa->fl_bitmap & ((size_t)1 << fl))) continue;
+
+    for (int sl = 0; sl < VSA_SL_INDEX_COUNT; ++sl) {
+      const VsaHeader *p_header = p_vsa->free_lists[fl][sl];
+      for (; NULL != p_header; p_header = HEADER_GET_LINKS(p_header)->p_next) {
+        // links and boundary tag of the block are not passed to func
+        func(ctx, 
+             (char*)HEADER_GET_BLOCK(p_header) + sizeof(VsaFreeLinks), 
+             HEADER_GET_SIZE(p_header) - sizeof(VsaFreeLinks) - WORD_SIZE);
+      }
+    }
+  }
+}
+
+
+size_t vsa_usable_size(const void *ptr) {
+  assert(NULL != ptr);
+  const VsaHeader *p_header = BLOCK_GET_HEADER(ptr);
+  size_t size = HEADER_LOAD(p_header);
+  assert(size & HEADER_TAKEN_BIT);
+  return size & ~HEADER_FLAGS;
+}
+
+
+void vsa_get_fragmentation(const Vsa *p_vsa, VsaFragmentation *p_frag) {
+  assert(NULL != p_vsa);
+  assert(NULL != p_frag);
+
+  p_frag->free_bytes = p_vsa->free_bytes;
+  p_frag->free_blocks_count = p_vsa->free_blocks_count;
+  p_frag->largest_free_block = 0;
+
+  // the largest block is in the highest non empty class,
+  // blocks in one class differ in size, so the class list is scanned
+  if (0 != p_vsa->fl_bitmap) {
+    int fl = bit_fls(p_vsa->fl_bitmap);
+    int sl = bit_fls(p_vsa->sl_bitmap[fl]);
+    const VsaHeader *p_header = p_vsa->free_lists[fl][sl];
+    for (; NULL != p_header; p_header = HEADER_GET_LINKS(p_header)->p_next) {
+      size_t size = HEADER_GET_SIZE(p_header);
+      if (size > p_frag->largest_free_block) p_frag->largest_free_block = size;
+    }
+  }
+
+  p_frag->fragmentation = 0 == p_frag->free_bytes
+    ? 0.0
+    : 1.0 - (double)p_frag->largest_free_block / (double)p_frag->free_bytes;
 }
 
 
@@ -167,17 +605,21 @@ void vsa_dump(const Vsa *p_vsa, DumpPrinter printer, const char *vsa_name) {
   assert(NULL != p_vsa);
   assert(NULL != printer);
 
-  const VsaHeader *p_header = (const VsaHeader *)p_vsa;
   printer("VSA", "%s DUMP\n", vsa_name);
 
-  while (0 != HEADER_GET_SIZE(p_header)) {
-    printer("VSA", "block (%s)\t[%p], size: %lu\n", 
-             BLOCK_IS_FREE(p_header) ? "free" : "taken", 
-             HEADER_GET_BLOCK(p_header), 
-             HEADER_GET_SIZE(p_header));
+  for (const VsaRegion *p_region = p_vsa->regions; NULL != p_region; p_region = p_region->p_next) {
+    if (p_region->is_mapped) {
+      printer("VSA", "mapped region [%p], size: %lu\n", p_region->mem, p_region->mem_size);
+    }
+
+    const VsaHeader *p_header = REGION_GET_FIRST_HEADER(p_region);
+    while (0 != HEADER_GET_SIZE(p_header)) {
+      printer("VSA", "block (%s)\t[%p], size: %lu\n", 
+               BLOCK_IS_FREE(p_header) ? "free" : "taken", 
+               HEADER_GET_BLOCK(p_header), 
+               HEADER_GET_SIZE(p_header));
 
-    p_header = header_get_next(p_header);
+      p_header = header_get_next(p_header);
+    }
   }
 }
-
-
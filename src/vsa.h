@@ -2,33 +2,148 @@
 #define __vsa_H__
 
 #include <stddef.h>
+#include <stdint.h>
 
 
+/// Number of second level free lists per first level class (log2)
+#define VSA_SL_INDEX_COUNT_LOG2 4
+#define VSA_SL_INDEX_COUNT (1 << VSA_SL_INDEX_COUNT_LOG2)
+
+/// Blocks must be smaller than 2^VSA_FL_INDEX_MAX bytes
+#if SIZE_MAX > 0xFFFFFFFFu
+#define VSA_FL_INDEX_MAX 40
+#else
+#define VSA_FL_INDEX_MAX 30
+#endif
+
+/// First level classes below VSA_SMALL_BLOCK_SIZE are folded into class 0
+#define VSA_FL_INDEX_SHIFT (VSA_SL_INDEX_COUNT_LOG2 + 3)
+#define VSA_FL_INDEX_COUNT (VSA_FL_INDEX_MAX - VSA_FL_INDEX_SHIFT + 1)
+
+/// Smallest block, it has to hold free list links and a boundary tag once freed
+#define VSA_BLOCK_MIN_SIZE (3 * sizeof(size_t))
+
+#define VSA_SMALL_BLOCK_SIZE ((size_t)1 << VSA_FL_INDEX_SHIFT)
+#define VSA_BLOCK_SIZE_MAX ((size_t)1 << VSA_FL_INDEX_MAX)
+
+
+/// Requests a region of at least @min_size bytes for the Vsa to grow,
+///   stores actual size of the region in @p_size
+/// @return void*, NULL if there is no more memory
+typedef void *(*VsaMapFunc)(void *ctx, size_t min_size, size_t *p_size);
+
+/// Gives back a region requested by VsaMapFunc
+typedef void (*VsaUnmapFunc)(void *ctx, void *mem, size_t size);
+
 /// Variable size allocator
-typedef void Vsa;
+/// Free blocks are kept in segregated free lists indexed by a two level
+///   bitmap (TLSF), so finding a fitting block does not walk the heap.
+/// Memory is managed in regions, the Vsa grows by requesting new regions
+///   from map_func when it is out of memory.
+typedef struct {
+  /// List of regions the Vsa manages, the newest first
+  void *regions;
+
+  VsaMapFunc map_func;
+  VsaUnmapFunc unmap_func;
+  void *region_ctx;
+
+  /// Mapped region that is kept while it is idle
+  void *p_spare_region;
+
+  /// Bit i is set if any list in free_lists[i] is not empty
+  size_t fl_bitmap;
+
+  /// Bit j of sl_bitmap[i] is set if free_lists[i][j] is not empty
+  uint32_t sl_bitmap[VSA_FL_INDEX_COUNT];
+
+  /// Heads of the free lists, indexed by first and second level class
+  void *free_lists[VSA_FL_INDEX_COUNT][VSA_SL_INDEX_COUNT];
+
+  /// Sum of sizes of all free blocks
+  size_t free_bytes;
 
+  /// Number of free blocks
+  size_t free_blocks_count;
 
-/// Initializes memory for Vsa, alignes @mem and @mem_size by word.
-Vsa *vsa_init(void *mem, size_t mem_size);
+  /// Number of reallocations that resized the block in place
+  size_t reallocs_in_place;
+
+  /// Number of reallocations that moved data to a new block
+  size_t reallocs_moved;
+} Vsa;
+
+/// Snapshot of how free memory of a Vsa is split
+typedef struct {
+  size_t free_bytes;
+  size_t free_blocks_count;
+  size_t largest_free_block;
+
+  /// 1 - largest_free_block / free_bytes,
+  ///   0 if all free memory is one block, approaches 1 as it is scattered
+  double fragmentation;
+} VsaFragmentation;
+
+
+/// Initializes @p_vsa to manage @mem, alignes @mem and @mem_size by word.
+void vsa_init(Vsa *p_vsa, void *mem, size_t mem_size);
+
+/// Adds @mem as another region to the Vsa, it is never given back.
+void vsa_add_region(Vsa *p_vsa, void *mem, size_t mem_size);
+
+/// Lets the Vsa grow: when no free block fits an allocation,
+///   a new region is requested from @map_func.
+/// Once all memory of such a region is free, it is given back to @unmap_func,
+///   except one idle region that is kept as a spare.
+/// Pass NULL functions to disable growing.
+void vsa_set_region_funcs(Vsa *p_vsa, VsaMapFunc map_func, VsaUnmapFunc unmap_func,
+                          void *ctx);
+
+/// Gives back all regions requested from map_func,
+///   the Vsa has to be initialized again to be used.
+void vsa_finalize(Vsa *p_vsa);
 
 /// Allocates @bytes in the Vsa, required number of bytes will be word alligned.
 void *vsa_alloc(Vsa *p_vsa, size_t bytes);
 
+/// Allocates @bytes in the Vsa at an address that is a multiple of @alignment.
+/// @alignment has to be a power of two, the block is freed by vsa_free.
+void *vsa_alloc_aligned(Vsa *p_vsa, size_t bytes, size_t alignment);
+
 
 /// Reallocates bytes in the Vsa, required number of bytes will be word alligned.
-/// It will return pointer to the new location and copy all the data from @ptr
-///   to that location.
-/// If @bytes is 0, call has the same effect as call to vsa_free(ptr).
+/// Shrinking and growing into a free block that follows @ptr is done in place,
+///   otherwise it will return pointer to the new location
+///   and copy all the data from @ptr to that location.
+/// If @bytes is 0, call has the same effect as call to vsa_free(ptr) and returns NULL.
 /// If @ptr is NULL call has the same effect as call to vsa_alloc(bytes).
 void *vsa_realloc(Vsa *p_vsa, void *ptr, size_t bytes);
 
+/// Reallocates block allocated by vsa_alloc_aligned with the same @alignment,
+///   the result is alligned by @alignment.
+/// @see vsa_realloc
+void *vsa_realloc_aligned(Vsa *p_vsa, void *ptr, size_t bytes, size_t alignment);
+
 
 /// Allocates bytes in the Vsa, required number of bytes will be word alligned.
 /// Zero initializes allocated memory.
 void *vsa_calloc(Vsa *p_vsa, size_t nmemb, size_t memb_size);
 
-/// Frees memory pointed by @ptr
-void vsa_free(void *ptr);
+/// Frees memory pointed by @ptr, merges it with free neighbour blocks
+void vsa_free(Vsa *p_vsa, void *ptr);
+
+/// Returns the number of bytes usable in the block pointed by @ptr,
+///   it is at least the number of bytes the block was allocated with
+size_t vsa_usable_size(const void *ptr);
+
+/// Reports free memory and how fragmented it is
+void vsa_get_fragmentation(const Vsa *p_vsa, VsaFragmentation *p_frag);
+
+typedef void (*VsaFreeBlockFunc)(void *ctx, void *mem, size_t size);
+
+/// Calls @func for memory of every free block that the Vsa does not use
+///   for its bookkeeping, e.g. to give unused pages back to the system.
+void vsa_walk_free_blocks(const Vsa *p_vsa, VsaFreeBlockFunc func, void *ctx);
 
 typedef void (*DumpPrinter)(const char *caller_name, const char *fmt, ...);
 
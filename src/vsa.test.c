@@ -13,7 +13,9 @@ void test(char *mem, size_t mem_size, const char *name) {
     mem[i] = i + 1;
   }
 
-  Vsa *test_vsa = vsa_init(mem, mem_size);
+  Vsa vsa;
+  Vsa *test_vsa = &vsa;
+  vsa_init(test_vsa, mem, mem_size);
 
   vsa_dump(test_vsa, &logf_info, "test_vsa after init");
 
@@ -37,19 +39,19 @@ void test(char *mem, size_t mem_size, const char *name) {
     ptrs[i] = vsa_alloc(test_vsa, i);
   }
   for (int i = 0; i < 10; ++i) {
-    vsa_free(ptrs[i]);
+    vsa_free(test_vsa, ptrs[i]);
   }
 
   vsa_dump(test_vsa, &logf_info, "test arena after 10 alloc + free");
 
-  vsa_free(vsa_alloc(test_vsa, 1));
-  vsa_dump(test_vsa, &logf_info, "test arena alloc + free 1, should defragment all blocks");
+  vsa_free(test_vsa, vsa_alloc(test_vsa, 1));
+  vsa_dump(test_vsa, &logf_info, "test arena alloc + free 1, all blocks are merged on free");
 
   for (int i = 0; i < 5; ++i) {
     ptrs[i] = vsa_alloc(test_vsa, i);
   }
   for (int i = 1; i < 5; ++i) {
-    vsa_free(ptrs[i]);
+    vsa_free(test_vsa, ptrs[i]);
   }
 
   vsa_dump(test_vsa, &logf_info, "test arena after 5 alloc + 4 free (from 1)");
@@ -59,13 +61,15 @@ void test(char *mem, size_t mem_size, const char *name) {
 
   ptr = vsa_realloc(test_vsa, ptr, 7);
   vsa_dump(test_vsa, &logf_info, "test arena realloc ptrs[0] to 7");
-  vsa_free(ptr);
+  vsa_free(test_vsa, ptr);
 }
 
 void test2(char *mem, size_t mem_size, const char *name) {
   logf_info("\n======== | TEST2 | ========", "(%s)\n", name);
 
-  Vsa *test_vsa = vsa_init(mem, mem_size);
+  Vsa vsa;
+  Vsa *test_vsa = &vsa;
+  vsa_init(test_vsa, mem, mem_size);
   vsa_dump(test_vsa, &logf_info, "test_vsa after init");
 
   void *ptr = vsa_alloc(test_vsa, 8);
@@ -77,14 +81,176 @@ void test2(char *mem, size_t mem_size, const char *name) {
   ptr = vsa_realloc(test_vsa, ptr, 2);
   vsa_dump(test_vsa, &logf_info, "test_vsa after realloc ptr to 2");
 
-  vsa_free(ptr);
+  vsa_free(test_vsa, ptr);
 
   ptr = vsa_alloc(test_vsa, 8);
   vsa_dump(test_vsa, &logf_info, "test_vsa after free and then alloc 8");
 }
 
+void test_coalescing(char *mem, size_t mem_size, const char *name) {
+  logf_info("\n======== | TEST COALESCING | ========", "(%s)\n", name);
+
+  Vsa vsa;
+  Vsa *test_vsa = &vsa;
+  vsa_init(test_vsa, mem, mem_size);
+
+  VsaFragmentation frag;
+  vsa_get_fragmentation(test_vsa, &frag);
+  assert(1 == frag.free_blocks_count);
+  assert(frag.largest_free_block == frag.free_bytes);
+  size_t initial_free = frag.free_bytes;
+
+  void *a = vsa_alloc(test_vsa, 32);
+  void *b = vsa_alloc(test_vsa, 32);
+  void *c = vsa_alloc(test_vsa, 32);
+  void *d = vsa_alloc(test_vsa, 32);
+
+  // a and c are separated by taken blocks
+  vsa_free(test_vsa, a);
+  vsa_free(test_vsa, c);
+  vsa_get_fragmentation(test_vsa, &frag);
+  assert(3 == frag.free_blocks_count);
+  assert(frag.fragmentation > 0.0);
+  vsa_dump(test_vsa, &logf_info, "test_vsa after freeing 1st and 3rd of 4 blocks");
+
+  // b merges with both a (before it) and c (after it)
+  vsa_free(test_vsa, b);
+  vsa_get_fragmentation(test_vsa, &frag);
+  assert(2 == frag.free_blocks_count);
+  vsa_dump(test_vsa, &logf_info, "test_vsa after freeing 2nd block");
+
+  vsa_free(test_vsa, d);
+  vsa_get_fragmentation(test_vsa, &frag);
+  assert(1 == frag.free_blocks_count);
+  assert(initial_free == frag.free_bytes);
+  assert(0.0 == frag.fragmentation);
+  vsa_dump(test_vsa, &logf_info, "test_vsa after freeing all blocks");
+}
+
+void test_realloc_in_place(char *mem, size_t mem_size, const char *name) {
+  logf_info("\n======== | TEST REALLOC IN PLACE | ========", "(%s)\n", name);
+
+  Vsa vsa;
+  Vsa *test_vsa = &vsa;
+  vsa_init(test_vsa, mem, mem_size);
+
+  int *arr = vsa_alloc(test_vsa, 4 * sizeof(int));
+  for (int i = 0; i < 4; ++i) arr[i] = i;
+
+  // the rest of the heap follows arr, so it grows in place
+  int *grown = vsa_realloc(test_vsa, arr, 64 * sizeof(int));
+  assert(grown == arr);
+  assert(1 == test_vsa->reallocs_in_place);
+
+  // shrinking gives the tail back to the free block after it
+  int *shrunk = vsa_realloc(test_vsa, grown, 8 * sizeof(int));
+  assert(shrunk == arr);
+  assert(2 == test_vsa->reallocs_in_place);
+  vsa_dump(test_vsa, &logf_info, "test_vsa after growing and shrinking in place");
+
+  // a taken block after arr forces a move
+  void *blocker = vsa_alloc(test_vsa, 8);
+  int *moved = vsa_realloc(test_vsa, shrunk, 16 * sizeof(int));
+  assert(moved != arr);
+  assert(1 == test_vsa->reallocs_moved);
+  for (int i = 0; i < 4; ++i) assert(i == moved[i]);
+  vsa_dump(test_vsa, &logf_info, "test_vsa after moving realloc");
+
+  vsa_free(test_vsa, blocker);
+  vsa_free(test_vsa, moved);
+
+  VsaFragmentation frag;
+  vsa_get_fragmentation(test_vsa, &frag);
+  assert(1 == frag.free_blocks_count);
+}
+
+void test_aligned(char *mem, size_t mem_size, const char *name) {
+  logf_info("\n======== | TEST ALIGNED | ========", "(%s)\n", name);
+
+  Vsa vsa;
+  Vsa *test_vsa = &vsa;
+  vsa_init(test_vsa, mem, mem_size);
+
+  void *unaligned = vsa_alloc(test_vsa, 8);
+
+  size_t alignments[] = {16, 32, 64, 128};
+  void *ptrs[sizeof(alignments) / sizeof(*alignments)];
+  for (size_t i = 0; i < sizeof(alignments) / sizeof(*alignments); ++i) {
+    ptrs[i] = vsa_alloc_aligned(test_vsa, 40, alignments[i]);
+    assert(NULL != ptrs[i]);
+    assert(0 == (size_t)ptrs[i] % alignments[i]);
+  }
+  vsa_dump(test_vsa, &logf_info, "test_vsa after aligned allocations");
+
+  void *grown = vsa_realloc_aligned(test_vsa, ptrs[3], 100, 128);
+  assert(NULL != grown);
+  assert(0 == (size_t)grown % 128);
+  ptrs[3] = grown;
+
+  vsa_free(test_vsa, unaligned);
+  for (size_t i = 0; i < sizeof(alignments) / sizeof(*alignments); ++i) {
+    vsa_free(test_vsa, ptrs[i]);
+  }
+
+  VsaFragmentation frag;
+  vsa_get_fragmentation(test_vsa, &frag);
+  assert(1 == frag.free_blocks_count);
+}
+
+typedef struct {
+  int mapped_count;
+  int unmapped_count;
+} RegionCounts;
+
+static void *test_map(void *ctx, size_t min_size, size_t *p_size) {
+  ++((RegionCounts*)ctx)->mapped_count;
+  *p_size = min_size;
+  return malloc(min_size);
+}
+
+static void test_unmap(void *ctx, void *mem, size_t size) {
+  (void)size;
+  ++((RegionCounts*)ctx)->unmapped_count;
+  free(mem);
+}
+
+void test_regions(char *mem, size_t mem_size, const char *name) {
+  logf_info("\n======== | TEST REGIONS | ========", "(%s)\n", name);
+
+  RegionCounts counts = {0};
+  Vsa vsa;
+  Vsa *test_vsa = &vsa;
+  vsa_init(test_vsa, mem, mem_size);
+
+  // without region functions the Vsa does not grow
+  assert(NULL == vsa_alloc(test_vsa, mem_size));
+
+  vsa_set_region_funcs(test_vsa, test_map, test_unmap, &counts);
+  void *big = vsa_alloc(test_vsa, mem_size);
+  void *bigger = vsa_alloc(test_vsa, 2 * mem_size);
+  void *aligned = vsa_alloc_aligned(test_vsa, mem_size, 256);
+  assert(NULL != big && NULL != bigger && NULL != aligned);
+  assert(0 == (size_t)aligned % 256);
+  assert(3 == counts.mapped_count);
+  vsa_dump(test_vsa, &logf_info, "test_vsa after growing by 3 regions");
+
+  // first idle region is kept as a spare, the next ones are unmapped
+  vsa_free(test_vsa, big);
+  vsa_free(test_vsa, bigger);
+  vsa_free(test_vsa, aligned);
+  assert(2 == counts.unmapped_count);
+
+  // the spare region is reused
+  big = vsa_alloc(test_vsa, mem_size);
+  assert(3 == counts.mapped_count);
+  vsa_free(test_vsa, big);
+
+  vsa_finalize(test_vsa);
+  assert(counts.mapped_count == counts.unmapped_count);
+}
+
 #define MEM_SIZE 1020
-#define MEM_SIZE_SMALL 40
+#define MEM_SIZE_SMALL 88
 
 LogSeverity g_log_severity = LOG_ALL;
 
@@ -98,6 +264,17 @@ int main() {
   test2(mem, MEM_SIZE_SMALL, "with static memory small size");
   test2(mem_heap, MEM_SIZE_SMALL, "with heap memory small size");
 
+  test_coalescing(mem + 1, MEM_SIZE - 1, "with static memory");
+  test_coalescing(mem_heap, MEM_SIZE, "with heap memory");
+
+  test_realloc_in_place(mem + 1, MEM_SIZE - 1, "with static memory");
+  test_realloc_in_place(mem_heap, MEM_SIZE, "with heap memory");
+
+  test_aligned(mem + 1, MEM_SIZE - 1, "with static memory");
+  test_aligned(mem_heap, MEM_SIZE, "with heap memory");
+
+  test_regions(mem + 1, MEM_SIZE - 1, "with static memory");
+
   free(mem_heap);
   return 0;
 }